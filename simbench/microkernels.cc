@@ -0,0 +1,489 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Wilson W.L. Fung
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "simbench.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+// Each kernel stresses one part of the timing model: the ALU pipelines,
+// the SIMT stack, shared memory bank conflicts, coalesced global loads
+// through L1/L2/DRAM, global atomics, the texture cache and CTA barriers.
+// The PTX follows what nvcc emits for sm_13 so the simulator's parser and
+// functional model see familiar code.
+
+const char *simbench_ptx =
+   "   .version 1.4\n"
+   "   .target sm_13\n"
+   "\n"
+   "   .tex .u32 simbench_tex;\n"
+   "\n"
+   "// shared prologue: %r1 = tid, %r3 = ntid, %r4 = global thread id,\n"
+   "// %r5 = iters, %r6 = loop counter, %r20 = &out[gid]\n"
+   "\n"
+   "   .entry simbench_alu (\n"
+   "      .param .u32 p_out,\n"
+   "      .param .u32 p_in,\n"
+   "      .param .u32 p_n,\n"
+   "      .param .u32 p_iters)\n"
+   "   {\n"
+   "   .reg .u32 %r<24>;\n"
+   "   .reg .f32 %f<8>;\n"
+   "   .reg .pred %p<4>;\n"
+   "   mov.u32             %r1, %tid.x;\n"
+   "   mov.u32             %r2, %ctaid.x;\n"
+   "   mov.u32             %r3, %ntid.x;\n"
+   "   mad.lo.u32          %r4, %r2, %r3, %r1;\n"
+   "   ld.param.u32        %r5, [p_iters];\n"
+   "   ld.param.u32        %r20, [p_out];\n"
+   "   shl.b32             %r21, %r4, 2;\n"
+   "   add.u32             %r20, %r20, %r21;\n"
+   "   mov.u32             %r6, 0;\n"
+   "   cvt.rn.f32.u32      %f1, %r4;\n"
+   "   mov.f32             %f2, 0f3F800000;\n"
+   "   mov.u32             %r7, %r4;\n"
+   "$Lt_alu_loop:\n"
+   "   mad.f32             %f2, %f2, 0f3F7FBE77, %f1;\n"
+   "   mul.f32             %f3, %f2, 0f3A83126F;\n"
+   "   sub.f32             %f2, %f2, %f3;\n"
+   "   mul.lo.u32          %r8, %r7, 1664525;\n"
+   "   add.u32             %r7, %r8, 1013904223;\n"
+   "   xor.b32             %r7, %r7, %r4;\n"
+   "   add.u32             %r6, %r6, 1;\n"
+   "   setp.lt.u32         %p1, %r6, %r5;\n"
+   "   @%p1 bra            $Lt_alu_loop;\n"
+   "   cvt.rzi.u32.f32     %r9, %f2;\n"
+   "   add.u32             %r9, %r9, %r7;\n"
+   "   st.global.u32       [%r20], %r9;\n"
+   "   exit;\n"
+   "   }\n"
+   "\n"
+   "   .entry simbench_divergent (\n"
+   "      .param .u32 p_out,\n"
+   "      .param .u32 p_in,\n"
+   "      .param .u32 p_n,\n"
+   "      .param .u32 p_iters)\n"
+   "   {\n"
+   "   .reg .u32 %r<24>;\n"
+   "   .reg .pred %p<4>;\n"
+   "   mov.u32             %r1, %tid.x;\n"
+   "   mov.u32             %r2, %ctaid.x;\n"
+   "   mov.u32             %r3, %ntid.x;\n"
+   "   mad.lo.u32          %r4, %r2, %r3, %r1;\n"
+   "   ld.param.u32        %r5, [p_iters];\n"
+   "   ld.param.u32        %r20, [p_out];\n"
+   "   shl.b32             %r21, %r4, 2;\n"
+   "   add.u32             %r20, %r20, %r21;\n"
+   "   mov.u32             %r6, 0;\n"
+   "   and.b32             %r7, %r1, 31;\n"
+   "   add.u32             %r5, %r5, %r7;\n"
+   "   mov.u32             %r8, %r4;\n"
+   "$Lt_div_loop:\n"
+   "   add.u32             %r9, %r8, %r6;\n"
+   "   and.b32             %r10, %r9, 3;\n"
+   "   setp.eq.u32         %p1, %r10, 0;\n"
+   "   @%p1 bra            $Lt_div_case0;\n"
+   "   setp.eq.u32         %p2, %r10, 1;\n"
+   "   @%p2 bra            $Lt_div_case1;\n"
+   "   xor.b32             %r8, %r8, %r9;\n"
+   "   shr.u32             %r11, %r8, 3;\n"
+   "   add.u32             %r8, %r8, %r11;\n"
+   "   bra                 $Lt_div_next;\n"
+   "$Lt_div_case0:\n"
+   "   mul.lo.u32          %r8, %r8, 3;\n"
+   "   add.u32             %r8, %r8, 7;\n"
+   "   bra                 $Lt_div_next;\n"
+   "$Lt_div_case1:\n"
+   "   shl.b32             %r11, %r8, 1;\n"
+   "   sub.u32             %r8, %r11, %r9;\n"
+   "$Lt_div_next:\n"
+   "   add.u32             %r6, %r6, 1;\n"
+   "   setp.lt.u32         %p3, %r6, %r5;\n"
+   "   @%p3 bra            $Lt_div_loop;\n"
+   "   st.global.u32       [%r20], %r8;\n"
+   "   exit;\n"
+   "   }\n"
+   "\n"
+   "   .entry simbench_shared_conflict (\n"
+   "      .param .u32 p_out,\n"
+   "      .param .u32 p_in,\n"
+   "      .param .u32 p_n,\n"
+   "      .param .u32 p_iters)\n"
+   "   {\n"
+   "   .reg .u32 %r<24>;\n"
+   "   .reg .pred %p<4>;\n"
+   "   .shared .u32 simbench_smem_conflict[2048];\n"
+   "   mov.u32             %r1, %tid.x;\n"
+   "   mov.u32             %r2, %ctaid.x;\n"
+   "   mov.u32             %r3, %ntid.x;\n"
+   "   mad.lo.u32          %r4, %r2, %r3, %r1;\n"
+   "   ld.param.u32        %r5, [p_iters];\n"
+   "   ld.param.u32        %r20, [p_out];\n"
+   "   shl.b32             %r21, %r4, 2;\n"
+   "   add.u32             %r20, %r20, %r21;\n"
+   "   mov.u32             %r6, 0;\n"
+   "// each thread owns 8 words, 32 bytes apart: 8-way bank conflicts\n"
+   "   mov.u32             %r7, simbench_smem_conflict;\n"
+   "   shl.b32             %r8, %r1, 5;\n"
+   "   add.u32             %r7, %r7, %r8;\n"
+   "   mov.u32             %r9, 0;\n"
+   "   st.shared.u32       [%r7+0], %r9;\n"
+   "   st.shared.u32       [%r7+4], %r9;\n"
+   "   st.shared.u32       [%r7+8], %r9;\n"
+   "   st.shared.u32       [%r7+12], %r9;\n"
+   "   st.shared.u32       [%r7+16], %r9;\n"
+   "   st.shared.u32       [%r7+20], %r9;\n"
+   "   st.shared.u32       [%r7+24], %r9;\n"
+   "   st.shared.u32       [%r7+28], %r9;\n"
+   "$Lt_shc_loop:\n"
+   "   and.b32             %r10, %r6, 7;\n"
+   "   shl.b32             %r10, %r10, 2;\n"
+   "   add.u32             %r11, %r7, %r10;\n"
+   "   ld.shared.u32       %r12, [%r11];\n"
+   "   add.u32             %r9, %r9, %r12;\n"
+   "   add.u32             %r12, %r12, %r1;\n"
+   "   st.shared.u32       [%r11], %r12;\n"
+   "   add.u32             %r6, %r6, 1;\n"
+   "   setp.lt.u32         %p1, %r6, %r5;\n"
+   "   @%p1 bra            $Lt_shc_loop;\n"
+   "   st.global.u32       [%r20], %r9;\n"
+   "   exit;\n"
+   "   }\n"
+   "\n"
+   "   .entry simbench_stream (\n"
+   "      .param .u32 p_out,\n"
+   "      .param .u32 p_in,\n"
+   "      .param .u32 p_n,\n"
+   "      .param .u32 p_iters)\n"
+   "   {\n"
+   "   .reg .u32 %r<24>;\n"
+   "   .reg .pred %p<4>;\n"
+   "   mov.u32             %r1, %tid.x;\n"
+   "   mov.u32             %r2, %ctaid.x;\n"
+   "   mov.u32             %r3, %ntid.x;\n"
+   "   mad.lo.u32          %r4, %r2, %r3, %r1;\n"
+   "   ld.param.u32        %r5, [p_iters];\n"
+   "   ld.param.u32        %r20, [p_out];\n"
+   "   shl.b32             %r21, %r4, 2;\n"
+   "   add.u32             %r20, %r20, %r21;\n"
+   "   mov.u32             %r6, 0;\n"
+   "   ld.param.u32        %r7, [p_in];\n"
+   "   ld.param.u32        %r8, [p_n];\n"
+   "   sub.u32             %r8, %r8, 1;\n"
+   "   mov.u32             %r9, %nctaid.x;\n"
+   "   mul.lo.u32          %r9, %r9, %r3;\n"
+   "   mov.u32             %r10, %r4;\n"
+   "   mov.u32             %r11, 0;\n"
+   "$Lt_str_loop:\n"
+   "   and.b32             %r12, %r10, %r8;\n"
+   "   shl.b32             %r12, %r12, 2;\n"
+   "   add.u32             %r12, %r7, %r12;\n"
+   "   ld.global.u32       %r13, [%r12];\n"
+   "   add.u32             %r11, %r11, %r13;\n"
+   "   add.u32             %r10, %r10, %r9;\n"
+   "   add.u32             %r6, %r6, 1;\n"
+   "   setp.lt.u32         %p1, %r6, %r5;\n"
+   "   @%p1 bra            $Lt_str_loop;\n"
+   "   st.global.u32       [%r20], %r11;\n"
+   "   exit;\n"
+   "   }\n"
+   "\n"
+   "   .entry simbench_atomic (\n"
+   "      .param .u32 p_out,\n"
+   "      .param .u32 p_in,\n"
+   "      .param .u32 p_n,\n"
+   "      .param .u32 p_iters)\n"
+   "   {\n"
+   "   .reg .u32 %r<24>;\n"
+   "   .reg .pred %p<4>;\n"
+   "   mov.u32             %r1, %tid.x;\n"
+   "   mov.u32             %r2, %ctaid.x;\n"
+   "   mov.u32             %r3, %ntid.x;\n"
+   "   mad.lo.u32          %r4, %r2, %r3, %r1;\n"
+   "   ld.param.u32        %r5, [p_iters];\n"
+   "   mov.u32             %r6, 0;\n"
+   "   ld.param.u32        %r7, [p_out];\n"
+   "   and.b32             %r8, %r4, 63;\n"
+   "   shl.b32             %r8, %r8, 2;\n"
+   "   add.u32             %r8, %r7, %r8;\n"
+   "$Lt_atom_loop:\n"
+   "   atom.global.add.u32 %r9, [%r8], 1;\n"
+   "   add.u32             %r6, %r6, 1;\n"
+   "   setp.lt.u32         %p1, %r6, %r5;\n"
+   "   @%p1 bra            $Lt_atom_loop;\n"
+   "   exit;\n"
+   "   }\n"
+   "\n"
+   "   .entry simbench_texture (\n"
+   "      .param .u32 p_out,\n"
+   "      .param .u32 p_in,\n"
+   "      .param .u32 p_n,\n"
+   "      .param .u32 p_iters)\n"
+   "   {\n"
+   "   .reg .u32 %r<24>;\n"
+   "   .reg .pred %p<4>;\n"
+   "   mov.u32             %r1, %tid.x;\n"
+   "   mov.u32             %r2, %ctaid.x;\n"
+   "   mov.u32             %r3, %ntid.x;\n"
+   "   mad.lo.u32          %r4, %r2, %r3, %r1;\n"
+   "   ld.param.u32        %r5, [p_iters];\n"
+   "   ld.param.u32        %r20, [p_out];\n"
+   "   shl.b32             %r21, %r4, 2;\n"
+   "   add.u32             %r20, %r20, %r21;\n"
+   "   mov.u32             %r6, 0;\n"
+   "   ld.param.u32        %r8, [p_n];\n"
+   "   sub.u32             %r8, %r8, 1;\n"
+   "   mul.lo.u32          %r10, %r4, 7;\n"
+   "   mov.u32             %r11, 0;\n"
+   "   mov.u32             %r13, 0;\n"
+   "$Lt_tex_loop:\n"
+   "   and.b32             %r12, %r10, %r8;\n"
+   "   tex.1d.v4.u32.s32   {%r14,%r15,%r16,%r17},[simbench_tex,{%r12,%r13,%r13,%r13}];\n"
+   "   add.u32             %r11, %r11, %r14;\n"
+   "   add.u32             %r10, %r10, 131;\n"
+   "   add.u32             %r6, %r6, 1;\n"
+   "   setp.lt.u32         %p1, %r6, %r5;\n"
+   "   @%p1 bra            $Lt_tex_loop;\n"
+   "   st.global.u32       [%r20], %r11;\n"
+   "   exit;\n"
+   "   }\n"
+   "\n"
+   "   .entry simbench_barrier (\n"
+   "      .param .u32 p_out,\n"
+   "      .param .u32 p_in,\n"
+   "      .param .u32 p_n,\n"
+   "      .param .u32 p_iters)\n"
+   "   {\n"
+   "   .reg .u32 %r<24>;\n"
+   "   .reg .pred %p<4>;\n"
+   "   .shared .u32 simbench_smem_barrier[1024];\n"
+   "   mov.u32             %r1, %tid.x;\n"
+   "   mov.u32             %r2, %ctaid.x;\n"
+   "   mov.u32             %r3, %ntid.x;\n"
+   "   mad.lo.u32          %r4, %r2, %r3, %r1;\n"
+   "   ld.param.u32        %r5, [p_iters];\n"
+   "   ld.param.u32        %r20, [p_out];\n"
+   "   shl.b32             %r21, %r4, 2;\n"
+   "   add.u32             %r20, %r20, %r21;\n"
+   "   mov.u32             %r6, 0;\n"
+   "   mov.u32             %r7, simbench_smem_barrier;\n"
+   "   shl.b32             %r8, %r1, 2;\n"
+   "   add.u32             %r8, %r7, %r8;\n"
+   "   add.u32             %r9, %r1, 1;\n"
+   "   sub.u32             %r10, %r3, 1;\n"
+   "   and.b32             %r9, %r9, %r10;\n"
+   "   shl.b32             %r9, %r9, 2;\n"
+   "   add.u32             %r9, %r7, %r9;\n"
+   "   mov.u32             %r11, %r4;\n"
+   "$Lt_bar_loop:\n"
+   "   st.shared.u32       [%r8], %r11;\n"
+   "   bar.sync            0;\n"
+   "   ld.shared.u32       %r12, [%r9];\n"
+   "   add.u32             %r11, %r11, %r12;\n"
+   "   bar.sync            0;\n"
+   "   add.u32             %r6, %r6, 1;\n"
+   "   setp.lt.u32         %p1, %r6, %r5;\n"
+   "   @%p1 bra            $Lt_bar_loop;\n"
+   "   st.global.u32       [%r20], %r11;\n"
+   "   exit;\n"
+   "   }\n";
+
+static float f32_bits( unsigned bits )
+{
+   float f;
+   memcpy(&f, &bits, sizeof(f));
+   return f;
+}
+
+// the float recurrence uses the same single precision operations (mad.f32 is
+// a*b+c rounded twice, as the simulator evaluates it)
+static bool check_alu( const unsigned *out, unsigned threads, unsigned cta_size,
+                       unsigned n, unsigned iters )
+{
+   const float decay = f32_bits(0x3F7FBE77);
+   const float leak = f32_bits(0x3A83126F);
+   for( unsigned gid=0; gid < threads; gid++ ) {
+      float f1 = (float)gid, f2 = 1.0f;
+      unsigned x = gid;
+      for( unsigned i=0; i < iters; i++ ) {
+         f2 = f2 * decay + f1;
+         float f3 = f2 * leak;
+         f2 = f2 - f3;
+         x = (x*1664525 + 1013904223) ^ gid;
+      }
+      if( out[gid] != (unsigned)f2 + x )
+         return false;
+   }
+   return true;
+}
+
+// thread t adds t to word i%8 of its own words on iteration i
+static bool check_shared_conflict( const unsigned *out, unsigned threads, unsigned cta_size,
+                                   unsigned n, unsigned iters )
+{
+   for( unsigned gid=0; gid < threads; gid++ ) {
+      unsigned tid = gid % cta_size;
+      unsigned sum = 0;
+      for( unsigned i=0; i < iters; i++ )
+         sum += (i/8) * tid;
+      if( out[gid] != sum )
+         return false;
+   }
+   return true;
+}
+
+static bool check_divergent( const unsigned *out, unsigned threads, unsigned cta_size,
+                             unsigned n, unsigned iters )
+{
+   for( unsigned gid=0; gid < threads; gid++ ) {
+      unsigned x = gid;
+      unsigned trips = iters + ((gid % cta_size) & 31);
+      for( unsigned i=0; i < trips; i++ ) {
+         unsigned y = x + i;
+         switch( y & 3 ) {
+         case 0: x = x*3 + 7; break;
+         case 1: x = (x << 1) - y; break;
+         default: x ^= y; x += x >> 3; break;
+         }
+      }
+      if( out[gid] != x )
+         return false;
+   }
+   return true;
+}
+
+static bool check_stream( const unsigned *out, unsigned threads, unsigned cta_size,
+                          unsigned n, unsigned iters )
+{
+   for( unsigned gid=0; gid < threads; gid++ ) {
+      unsigned sum = 0;
+      for( unsigned i=0; i < iters; i++ )
+         sum += (gid + i*threads) & (n-1);
+      if( out[gid] != sum )
+         return false;
+   }
+   return true;
+}
+
+static bool check_atomic( const unsigned *out, unsigned threads, unsigned cta_size,
+                          unsigned n, unsigned iters )
+{
+   unsigned long long sum = 0;
+   for( unsigned i=0; i < 64; i++ )
+      sum += out[i];
+   return sum == (unsigned long long)threads * iters;
+}
+
+static bool check_texture( const unsigned *out, unsigned threads, unsigned cta_size,
+                           unsigned n, unsigned iters )
+{
+   for( unsigned gid=0; gid < threads; gid++ ) {
+      unsigned sum = 0;
+      for( unsigned i=0; i < iters; i++ )
+         sum += (gid*7 + i*131) & (n-1);
+      if( out[gid] != sum )
+         return false;
+   }
+   return true;
+}
+
+// every iteration each thread adds the value of its right neighbour in the CTA
+static bool check_barrier( const unsigned *out, unsigned threads, unsigned cta_size,
+                           unsigned n, unsigned iters )
+{
+   unsigned *v = new unsigned[2*cta_size];
+   bool ok = true;
+   for( unsigned cta=0; ok && cta < threads/cta_size; cta++ ) {
+      unsigned *cur = v, *next = v + cta_size;
+      for( unsigned t=0; t < cta_size; t++ )
+         cur[t] = cta*cta_size + t;
+      for( unsigned i=0; i < iters; i++ ) {
+         for( unsigned t=0; t < cta_size; t++ )
+            next[t] = cur[t] + cur[(t+1) % cta_size];
+         unsigned *tmp = cur; cur = next; next = tmp;
+      }
+      for( unsigned t=0; t < cta_size; t++ )
+         ok = ok && out[cta*cta_size + t] == cur[t];
+   }
+   delete[] v;
+   return ok;
+}
+
+const simbench_kernel simbench_kernels[] = {
+   // name             entry                       regs  smem  cta  ctas/core iters  check
+   { "alu",            "simbench_alu",              16,    0, 256, 2, 256, check_alu },
+   { "divergent",      "simbench_divergent",        16,    0, 256, 2,  64, check_divergent },
+   { "shared_conflict","simbench_shared_conflict",  16, 8192, 256, 2, 128, check_shared_conflict },
+   { "stream",         "simbench_stream",           16,    0, 256, 2,  64, check_stream },
+   { "atomic",         "simbench_atomic",           12,    0, 256, 2,  16, check_atomic },
+   { "texture",        "simbench_texture",          20,    0, 256, 2,  64, check_texture },
+   { "barrier",        "simbench_barrier",          16, 4096, 256, 2,  64, check_barrier },
+};
+
+const unsigned simbench_num_kernels = sizeof(simbench_kernels)/sizeof(simbench_kernels[0]);
+
+bool simbench_check_table( FILE *err )
+{
+   static const char *params[] = { "p_out", "p_in", "p_n", "p_iters" };
+   bool ok = true;
+   for( unsigned k=0; k < simbench_num_kernels; k++ ) {
+      const simbench_kernel &kernel = simbench_kernels[k];
+      for( unsigned j=0; j < k; j++ ) {
+         if( !strcmp(kernel.name, simbench_kernels[j].name) || !strcmp(kernel.entry, simbench_kernels[j].entry) ) {
+            fprintf(err, "simbench: kernel %s is listed twice\n", kernel.name);
+            ok = false;
+         }
+      }
+      if( !kernel.cta_size || kernel.cta_size % 32 || !kernel.ctas_per_core || !kernel.iterations ) {
+         fprintf(err, "simbench: kernel %s has an empty launch or a partial warp\n", kernel.name);
+         ok = false;
+      }
+      std::string decl = std::string(".entry ") + kernel.entry + " (";
+      const char *entry = strstr(simbench_ptx, decl.c_str());
+      if( !entry || strstr(entry + 1, decl.c_str()) ) {
+         fprintf(err, "simbench: kernel %s needs exactly one %s...) in simbench_ptx\n", kernel.name, decl.c_str());
+         ok = false;
+         continue;
+      }
+      // the launch passes (out, in, n, iters) in this order
+      const char *end = strchr(entry, ')');
+      const char *p = entry + decl.size();
+      for( unsigned i=0; i < 4; i++ ) {
+         std::string param = std::string(".param .u32 ") + params[i];
+         p = strstr(p, param.c_str());
+         if( !p || p > end ) {
+            fprintf(err, "simbench: %s does not take (p_out, p_in, p_n, p_iters)\n", kernel.entry);
+            ok = false;
+            break;
+         }
+         p += param.size();
+      }
+   }
+   return ok;
+}
@@ -0,0 +1,341 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Wilson W.L. Fung
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// simbench: measures how fast the simulator itself runs. The microkernels in
+// microkernels.cc are launched on each shipped configuration, one child
+// process per configuration (the simulator is initialized once per process),
+// and the simulated KIPS (thousand thread instructions per host second) and
+// simulated cycles per host second are reported for every kernel.
+//
+//    simbench [-configs <dir>] [-config <name>]... [-kernel <name>]...
+//             [-scale <n>] [-repeat <n>] [-check]
+//
+// The simulator output of each configuration goes to simbench_<config>.log in
+// the current directory. The exit status is non-zero when a kernel computes a
+// wrong result or a configuration fails to run.
+//
+// -check only parses simbench_ptx under each configuration and looks up
+// every kernel's entry, without launching anything; run it first whenever
+// microkernels.cc changes.
+//
+// There is no baseline comparison yet: the numbers only mean something
+// against a baseline recorded on the machine that runs the comparison, and
+// none has been recorded.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "../src/abstract_hardware_model.h"
+#include "../src/gpgpusim_entrypoint.h"
+#include "../src/cuda-sim/cuda-sim.h"
+#include "../src/cuda-sim/ptx_ir.h"
+#include "../src/cuda-sim/ptx_loader.h"
+#include "../src/gpgpu-sim/gpu-sim.h"
+#include "simbench.h"
+
+#define SIMBENCH_INPUT_WORDS (1<<20)
+
+static const char *default_configs[] = { "GTX480", "TeslaC2050", "QuadroFX5600", "QuadroFX5800" };
+
+// kernels found while parsing simbench_ptx (this is the API layer's hook,
+// see libcuda and libopencl)
+static std::map<std::string,function_info*> g_simbench_functions;
+
+void register_ptx_function( const char *name, function_info *impl )
+{
+   g_simbench_functions[name] = impl;
+}
+
+void ptxinfo_addinfo()
+{
+   // kernel resource usage comes from simbench_kernels[], ptxas is never run
+}
+
+struct simbench_result {
+   std::string config;
+   std::string kernel;
+   unsigned long long cycles;
+   unsigned long long insn;
+   double seconds;
+   int check; // 1 = correct, 0 = wrong, -1 = not checked
+
+   double kips() const { return insn / seconds / 1000.0; }
+   double cycles_per_sec() const { return cycles / seconds; }
+};
+
+static double wall_seconds()
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC,&ts);
+   return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static bool selected( const std::vector<std::string> &names, const char *name )
+{
+   if( names.empty() )
+      return true;
+   for( unsigned i=0; i < names.size(); i++ )
+      if( names[i] == name )
+         return true;
+   return false;
+}
+
+// runs in the child process after chdir() to the configuration directory;
+// writes one line per kernel to fout
+static void run_config( FILE *fout, const std::vector<std::string> &kernels, unsigned scale, unsigned repeat,
+                        bool check_only )
+{
+   gpgpu_sim *gpu = gpgpu_ptx_sim_init_perf();
+   start_sim_thread(2);
+   gpgpu_ptx_sim_load_ptx_from_string(simbench_ptx, 1);
+   if( check_only ) {
+      bool ok = true;
+      for( unsigned k=0; k < simbench_num_kernels; k++ ) {
+         if( g_simbench_functions.find(simbench_kernels[k].entry) == g_simbench_functions.end() ) {
+            fprintf(stderr, "simbench: no PTX entry %s\n", simbench_kernels[k].entry);
+            ok = false;
+         }
+      }
+      fflush(stdout);
+      _exit(ok? 0 : 1);
+   }
+
+   unsigned num_cores = gpu->get_config().num_shader();
+   unsigned max_threads = 64;
+   for( unsigned k=0; k < simbench_num_kernels; k++ ) {
+      const simbench_kernel &kernel = simbench_kernels[k];
+      unsigned threads = kernel.ctas_per_core * num_cores * kernel.cta_size;
+      if( threads > max_threads )
+         max_threads = threads;
+   }
+   size_t out_bytes = max_threads * sizeof(unsigned);
+   unsigned *host_out = new unsigned[max_threads];
+   unsigned *host_in = new unsigned[SIMBENCH_INPUT_WORDS];
+   for( unsigned i=0; i < SIMBENCH_INPUT_WORDS; i++ )
+      host_in[i] = i;
+   size_t out = (size_t)gpu->gpu_malloc(out_bytes);
+   size_t in = (size_t)gpu->gpu_malloc(SIMBENCH_INPUT_WORDS*sizeof(unsigned));
+   gpu->memcpy_to_gpu(in, host_in, SIMBENCH_INPUT_WORDS*sizeof(unsigned));
+
+   static struct textureReference texref;
+   static struct cudaArray array;
+   memset(&texref, 0, sizeof(texref));
+   texref.filterMode = cudaFilterModePoint;
+   texref.addressMode[0] = cudaAddressModeClamp;
+   texref.channelDesc.x = 32;
+   texref.channelDesc.f = cudaChannelFormatKindUnsigned;
+   array.devPtr = (void*)in;
+   array.devPtr32 = (int)in;
+   array.desc = texref.channelDesc;
+   array.width = SIMBENCH_INPUT_WORDS;
+   array.height = 1;
+   array.size = SIMBENCH_INPUT_WORDS*sizeof(unsigned);
+   array.dimensions = 1;
+   gpu->gpgpu_ptx_sim_bindNameToTexture("simbench_tex", &texref, 1, cudaReadModeElementType, 0);
+   gpu->gpgpu_ptx_sim_bindTextureToArray(&texref, &array);
+
+   for( unsigned k=0; k < simbench_num_kernels; k++ ) {
+      const simbench_kernel &kernel = simbench_kernels[k];
+      if( !selected(kernels,kernel.name) )
+         continue;
+      std::map<std::string,function_info*>::iterator f = g_simbench_functions.find(kernel.entry);
+      if( f == g_simbench_functions.end() ) {
+         fprintf(stderr, "simbench: no PTX entry %s\n", kernel.entry);
+         exit(1);
+      }
+      struct gpgpu_ptx_sim_kernel_info info;
+      memset(&info, 0, sizeof(info));
+      info.regs = kernel.regs;
+      info.smem = kernel.smem;
+      f->second->set_kernel_info(info);
+
+      unsigned iters = kernel.iterations * scale;
+      unsigned n = SIMBENCH_INPUT_WORDS;
+      dim3 grid_dim = { kernel.ctas_per_core * num_cores, 1, 1 };
+      dim3 block_dim = { kernel.cta_size, 1, 1 };
+      unsigned threads = grid_dim.x * block_dim.x;
+      unsigned out32 = out, in32 = in;
+
+      simbench_result best;
+      best.seconds = 0;
+      best.check = -1;
+      for( unsigned r=0; r < repeat; r++ ) {
+         gpu->gpu_memset(out, 0, out_bytes);
+         gpgpu_ptx_sim_arg_list_t args;
+         args.push_front(gpgpu_ptx_sim_arg(&out32, sizeof(unsigned), 0));
+         args.push_front(gpgpu_ptx_sim_arg(&in32, sizeof(unsigned), 0));
+         args.push_front(gpgpu_ptx_sim_arg(&n, sizeof(unsigned), 0));
+         args.push_front(gpgpu_ptx_sim_arg(&iters, sizeof(unsigned), 0));
+         kernel_info_t *grid = gpgpu_opencl_ptx_sim_init_grid(f->second, args, grid_dim, block_dim, gpu);
+
+         unsigned long long cycles = gpu_tot_sim_cycle;
+         unsigned long long insn = gpu->gpu_tot_sim_insn;
+         double start = wall_seconds();
+         gpgpu_opencl_ptx_sim_main_perf(grid);
+         double seconds = wall_seconds() - start;
+         if( r == 0 || seconds < best.seconds ) {
+            best.cycles = gpu_tot_sim_cycle - cycles;
+            best.insn = gpu->gpu_tot_sim_insn - insn;
+            best.seconds = seconds;
+         }
+         if( kernel.check ) {
+            gpu->memcpy_from_gpu(host_out, out, out_bytes);
+            bool ok = kernel.check(host_out, threads, kernel.cta_size, n, iters);
+            best.check = (best.check != 0 && ok)? 1 : 0;
+         }
+      }
+      fprintf(fout, "%s %llu %llu %.6f %d\n", kernel.name, best.cycles, best.insn, best.seconds, best.check);
+      fflush(fout);
+   }
+   delete[] host_out;
+   delete[] host_in;
+}
+
+static bool run_config_process( const std::string &configs_dir, const std::string &config,
+                                const std::vector<std::string> &kernels, unsigned scale, unsigned repeat,
+                                bool check_only, std::vector<simbench_result> &results )
+{
+   char cwd[4096];
+   if( !getcwd(cwd, sizeof(cwd)) ) {
+      perror("simbench: getcwd");
+      return false;
+   }
+   std::string log = std::string(cwd) + "/simbench_" + config + ".log";
+   std::string dir = configs_dir + "/" + config;
+   int fds[2];
+   if( pipe(fds) != 0 ) {
+      perror("simbench: pipe");
+      return false;
+   }
+   fflush(stdout);
+   pid_t pid = fork();
+   if( pid < 0 ) {
+      perror("simbench: fork");
+      return false;
+   }
+   if( pid == 0 ) {
+      close(fds[0]);
+      int fd = open(log.c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
+      if( fd < 0 || dup2(fd, 1) < 0 ) {
+         fprintf(stderr, "simbench: cannot write %s\n", log.c_str());
+         _exit(1);
+      }
+      close(fd);
+      if( chdir(dir.c_str()) != 0 ) {
+         fprintf(stderr, "simbench: no configuration directory %s\n", dir.c_str());
+         _exit(1);
+      }
+      FILE *fout = fdopen(fds[1], "w");
+      run_config(fout, kernels, scale, repeat, check_only);
+      fclose(fout);
+      fflush(stdout);
+      _exit(0);
+   }
+   close(fds[1]);
+   FILE *fin = fdopen(fds[0], "r");
+   char name[256];
+   simbench_result r;
+   r.config = config;
+   while( fscanf(fin, "%255s %llu %llu %lf %d", name, &r.cycles, &r.insn, &r.seconds, &r.check) == 5 ) {
+      r.kernel = name;
+      results.push_back(r);
+   }
+   fclose(fin);
+   int status;
+   waitpid(pid, &status, 0);
+   if( !WIFEXITED(status) || WEXITSTATUS(status) != 0 ) {
+      printf("simbench: %s failed, see %s\n", config.c_str(), log.c_str());
+      return false;
+   }
+   return true;
+}
+
+static int usage()
+{
+   fprintf(stderr, "usage: simbench [-configs <dir>] [-config <name>]... [-kernel <name>]... [-scale <n>] [-repeat <n>]\n"
+                   "                [-check]\n");
+   return 2;
+}
+
+int main( int argc, char **argv )
+{
+   std::string configs_dir = getenv("GPGPUSIM_ROOT")? std::string(getenv("GPGPUSIM_ROOT")) + "/configs" : "configs";
+   std::vector<std::string> configs, kernels;
+   unsigned scale = 1, repeat = 1;
+   bool check_only = false;
+   for( int i=1; i < argc; i++ ) {
+      if( !strcmp(argv[i],"-check") ) {
+         check_only = true;
+         continue;
+      }
+      if( i+1 >= argc )
+         return usage();
+      if( !strcmp(argv[i],"-configs") ) configs_dir = argv[++i];
+      else if( !strcmp(argv[i],"-config") ) configs.push_back(argv[++i]);
+      else if( !strcmp(argv[i],"-kernel") ) kernels.push_back(argv[++i]);
+      else if( !strcmp(argv[i],"-scale") ) scale = atoi(argv[++i]);
+      else if( !strcmp(argv[i],"-repeat") ) repeat = atoi(argv[++i]);
+      else return usage();
+   }
+   if( !scale || !repeat )
+      return usage();
+   if( configs.empty() )
+      configs.assign(default_configs, default_configs + sizeof(default_configs)/sizeof(default_configs[0]));
+
+   if( !simbench_check_table(stderr) )
+      return 1;
+
+   bool failed = false;
+   std::vector<simbench_result> results;
+   for( unsigned c=0; c < configs.size(); c++ ) {
+      bool ok = run_config_process(configs_dir, configs[c], kernels, scale, repeat, check_only, results);
+      if( check_only )
+         printf("%-14s %u kernels %s\n", configs[c].c_str(), simbench_num_kernels, ok? "parsed" : "FAILED");
+      failed |= !ok;
+   }
+   if( check_only )
+      return failed? 1 : 0;
+
+   printf("%-14s %-16s %12s %12s %9s %10s %12s  %s\n", "config", "kernel", "cycles", "insn", "host(s)",
+          "KIPS", "cycles/sec", "result");
+   for( unsigned i=0; i < results.size(); i++ ) {
+      const simbench_result &r = results[i];
+      const char *verdict = (r.check == 0)? "WRONG RESULT" : (r.check == 1)? "ok" : "not checked";
+      failed |= (r.check == 0);
+      printf("%-14s %-16s %12llu %12llu %9.2f %10.1f %12.1f  %s\n", r.config.c_str(), r.kernel.c_str(),
+             r.cycles, r.insn, r.seconds, r.kips(), r.cycles_per_sec(), verdict);
+   }
+   return failed? 1 : 0;
+}
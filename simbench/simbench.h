@@ -0,0 +1,65 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Wilson W.L. Fung
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef SIMBENCH_H
+#define SIMBENCH_H
+
+#include <stdio.h>
+
+// Simulator throughput benchmark: hand written PTX microkernels that are
+// loaded and launched through the simulator's internal kernel interface, so
+// neither nvcc nor a GPU is needed.
+//
+// Every kernel has the parameters (out, in, n, iters): out has one word per
+// thread (at least 64), in holds n words with in[k] = k (n is a power of
+// two, also bound to the 1D texture simbench_tex) and iters is the trip
+// count of the kernel's main loop.
+
+struct simbench_kernel {
+   const char *name;
+   const char *entry;          // .entry in simbench_ptx
+   unsigned regs;              // per thread, stands in for ptxas -v
+   unsigned smem;              // bytes of .shared per CTA
+   unsigned cta_size;
+   unsigned ctas_per_core;     // grid = ctas_per_core * number of cores
+   unsigned iterations;
+
+   // host reference check of out[]; NULL if the result is not checked
+   bool (*check)( const unsigned *out, unsigned threads, unsigned cta_size,
+                  unsigned n, unsigned iters );
+};
+
+extern const char *simbench_ptx;
+extern const simbench_kernel simbench_kernels[];
+extern const unsigned simbench_num_kernels;
+
+// checks simbench_kernels[] against the text of simbench_ptx (one .entry per
+// kernel, taking the four parameters in launch order) without running the
+// PTX parser; reports problems to err
+bool simbench_check_table( FILE *err );
+
+#endif
@@ -364,54 +364,47 @@ void warp_inst_t::memory_coalescing_arch_13( bool is_write, mem_access_type acce
     }
     unsigned subwarp_size = m_config->warp_size / warp_parts;
 
+    unsigned data_size_coales = data_size;
+    unsigned num_accesses = 1;
+
+    if( space.get_type() == local_space || space.get_type() == param_space_local ) {
+       // Local memory accesses >4B were split into 4B chunks
+       if(data_size >= 4) {
+          data_size_coales = 4;
+          num_accesses = data_size/4;
+       }
+       // Otherwise keep the same data_size for sub-4B access to local memory
+    }
+
+    assert(num_accesses <= MAX_ACCESSES_PER_INSN_PER_THREAD);
+
+    subwarp_coalescer coalescer;
     for( unsigned subwarp=0; subwarp <  warp_parts; subwarp++ ) {
-        std::map<new_addr_type,transaction_info> subwarp_transactions;
+        coalescer.reset();
 
         // step 1: find all transactions generated by this subwarp
         for( unsigned thread=subwarp*subwarp_size; thread<subwarp_size*(subwarp+1); thread++ ) {
             if( !active(thread) )
                 continue;
 
-            unsigned data_size_coales = data_size;
-            unsigned num_accesses = 1;
-
-            if( space.get_type() == local_space || space.get_type() == param_space_local ) {
-               // Local memory accesses >4B were split into 4B chunks
-               if(data_size >= 4) {
-                  data_size_coales = 4;
-                  num_accesses = data_size/4;
-               }
-               // Otherwise keep the same data_size for sub-4B access to local memory
-            }
-
-
-            assert(num_accesses <= MAX_ACCESSES_PER_INSN_PER_THREAD);
-
             for(unsigned access=0; access<num_accesses; access++) {
                 new_addr_type addr = m_per_scalar_thread[thread].memreqaddr[access];
-                unsigned block_address = line_size_based_tag_func(addr,segment_size);
-                unsigned chunk = (addr&127)/32; // which 32-byte chunk within in a 128-byte chunk does this thread access?
-                transaction_info &info = subwarp_transactions[block_address];
 
                 // can only write to one segment
-                assert(block_address == line_size_based_tag_func(addr+data_size_coales-1,segment_size));
+                assert(line_size_based_tag_func(addr,segment_size) == line_size_based_tag_func(addr+data_size_coales-1,segment_size));
 
-                info.chunks.set(chunk);
-                info.active.set(thread);
-                unsigned idx = (addr&127);
-                for( unsigned i=0; i < data_size_coales; i++ )
-                    info.bytes.set(idx+i);
+                coalescer.add(thread,addr);
             }
         }
+        if( coalescer.empty() )
+            continue;
+        coalescer.coalesce(segment_size,data_size_coales);
 
         // step 2: reduce each transaction size, if possible
-        std::map< new_addr_type, transaction_info >::iterator t;
-        for( t=subwarp_transactions.begin(); t !=subwarp_transactions.end(); t++ ) {
-            new_addr_type addr = t->first;
-            const transaction_info &info = t->second;
-
-            memory_coalescing_arch_13_reduce_and_send(is_write, access_type, info, addr, segment_size);
-
+        for( unsigned t=0; t < coalescer.num_transactions(); t++ ) {
+            transaction_info info;
+            coalescer.get_transaction(t,info);
+            memory_coalescing_arch_13_reduce_and_send(is_write, access_type, info, coalescer.segment(t), segment_size);
         }
     }
 }
@@ -431,8 +424,9 @@ void warp_inst_t::memory_coalescing_arch_13_atomic( bool is_write, mem_access_ty
    }
    unsigned subwarp_size = m_config->warp_size / warp_parts;
 
+   subwarp_coalescer coalescer;
    for( unsigned subwarp=0; subwarp <  warp_parts; subwarp++ ) {
-       std::map<new_addr_type,std::list<transaction_info> > subwarp_transactions; // each block addr maps to a list of transactions
+       coalescer.reset();
 
        // step 1: find all transactions generated by this subwarp
        for( unsigned thread=subwarp*subwarp_size; thread<subwarp_size*(subwarp+1); thread++ ) {
@@ -440,53 +434,22 @@ void warp_inst_t::memory_coalescing_arch_13_atomic( bool is_write, mem_access_ty
                continue;
 
            new_addr_type addr = m_per_scalar_thread[thread].memreqaddr[0];
-           unsigned block_address = line_size_based_tag_func(addr,segment_size);
-           unsigned chunk = (addr&127)/32; // which 32-byte chunk within in a 128-byte chunk does this thread access?
 
            // can only write to one segment
-           assert(block_address == line_size_based_tag_func(addr+data_size-1,segment_size));
-
-           // Find a transaction that does not conflict with this thread's accesses
-           bool new_transaction = true;
-           std::list<transaction_info>::iterator it;
-           transaction_info* info;
-           for(it=subwarp_transactions[block_address].begin(); it!=subwarp_transactions[block_address].end(); it++) {
-              unsigned idx = (addr&127);
-              if(not it->test_bytes(idx,idx+data_size-1)) {
-                 new_transaction = false;
-                 info = &(*it);
-                 break;
-              }
-           }
-           if(new_transaction) {
-              // Need a new transaction
-              subwarp_transactions[block_address].push_back(transaction_info());
-              info = &subwarp_transactions[block_address].back();
-           }
-           assert(info);
-
-           info->chunks.set(chunk);
-           info->active.set(thread);
-           unsigned idx = (addr&127);
-           for( unsigned i=0; i < data_size; i++ ) {
-               assert(!info->bytes.test(idx+i));
-               info->bytes.set(idx+i);
-           }
+           assert(line_size_based_tag_func(addr,segment_size) == line_size_based_tag_func(addr+data_size-1,segment_size));
+
+           coalescer.add(thread,addr);
        }
+       if( coalescer.empty() )
+           continue;
+       // each block addr gets a list of transactions, a thread joins the first one it does not conflict with
+       coalescer.coalesce_atomic(segment_size,data_size);
 
        // step 2: reduce each transaction size, if possible
-       std::map< new_addr_type, std::list<transaction_info> >::iterator t_list;
-       for( t_list=subwarp_transactions.begin(); t_list !=subwarp_transactions.end(); t_list++ ) {
-           // For each block addr
-           new_addr_type addr = t_list->first;
-           const std::list<transaction_info>& transaction_list = t_list->second;
-
-           std::list<transaction_info>::const_iterator t;
-           for(t=transaction_list.begin(); t!=transaction_list.end(); t++) {
-               // For each transaction
-               const transaction_info &info = *t;
-               memory_coalescing_arch_13_reduce_and_send(is_write, access_type, info, addr, segment_size);
-           }
+       for( unsigned t=0; t < coalescer.num_transactions(); t++ ) {
+           transaction_info info;
+           coalescer.get_transaction(t,info);
+           memory_coalescing_arch_13_reduce_and_send(is_write, access_type, info, coalescer.segment(t), segment_size);
        }
    }
 }
@@ -587,7 +550,18 @@ simt_stack::simt_stack( unsigned wid, unsigned warpSize)
 
 void simt_stack::reset()
 {
-    m_stack.clear();
+    m_depth=0;
+}
+
+void simt_stack::push( const simt_stack_entry &entry )
+{
+    if( m_depth >= MAX_SIMT_STACK_DEPTH ) {
+        printf("GPGPU-Sim uArch: ERROR ** SIMT stack overflow on warp %u: the stack holds at most "
+               "MAX_SIMT_STACK_DEPTH = %u entries (divergence plus nested calls); raise it in "
+               "abstract_hardware_model.h for deeper call chains\n", m_warp_id, (unsigned)MAX_SIMT_STACK_DEPTH);
+        abort();
+    }
+    m_stack[m_depth++] = entry;
 }
 
 void simt_stack::launch( address_type start_pc, const simt_mask_t &active_mask )
@@ -598,32 +572,29 @@ void simt_stack::launch( address_type start_pc, const simt_mask_t &active_mask )
     new_stack_entry.m_calldepth = 1;
     new_stack_entry.m_active_mask = active_mask;
     new_stack_entry.m_type = STACK_ENTRY_TYPE_NORMAL;
-    m_stack.push_back(new_stack_entry);
+    push(new_stack_entry);
 }
 
 const simt_mask_t &simt_stack::get_active_mask() const
 {
-    assert(m_stack.size() > 0);
-    return m_stack.back().m_active_mask;
+    return top().m_active_mask;
 }
 
 void simt_stack::get_pdom_stack_top_info( unsigned *pc, unsigned *rpc ) const
 {
-   assert(m_stack.size() > 0);
-   *pc = m_stack.back().m_pc;
-   *rpc = m_stack.back().m_recvg_pc;
+   *pc = top().m_pc;
+   *rpc = top().m_recvg_pc;
 }
 
 unsigned simt_stack::get_rp() const 
 { 
-    assert(m_stack.size() > 0);
-    return m_stack.back().m_recvg_pc;
+    return top().m_recvg_pc;
 }
 
 void simt_stack::print (FILE *fout) const
 {
-    for ( unsigned k=0; k < m_stack.size(); k++ ) {
-        simt_stack_entry stack_entry = m_stack[k];
+    for ( unsigned k=0; k < m_depth; k++ ) {
+        const simt_stack_entry &stack_entry = m_stack[k];
         if ( k==0 ) {
             fprintf(fout, "w%02d %1u ", m_warp_id, k );
         } else {
@@ -647,20 +618,43 @@ void simt_stack::print (FILE *fout) const
     }
 }
 
-void simt_stack::update( simt_mask_t &thread_done, addr_vector_t &next_pc, address_type recvg_pc, op_type next_inst_op,unsigned next_inst_size, address_type next_inst_pc )
+void simt_stack::update( simt_mask_t &thread_done, const address_type next_pc[], address_type recvg_pc, op_type next_inst_op,unsigned next_inst_size, address_type next_inst_pc )
 {
-    assert(m_stack.size() > 0);
-
-    assert( next_pc.size() == m_warp_size );
-
-    simt_mask_t  top_active_mask = m_stack.back().m_active_mask;
-    address_type top_recvg_pc = m_stack.back().m_recvg_pc;
-    address_type top_pc = m_stack.back().m_pc; // the pc of the instruction just executed
-    stack_entry_type top_type = m_stack.back().m_type;
+    simt_mask_t  top_active_mask = top().m_active_mask;
+    address_type top_recvg_pc = top().m_recvg_pc;
+    address_type top_pc = top().m_pc; // the pc of the instruction just executed
+    stack_entry_type top_type = top().m_type;
     assert(top_pc==next_inst_pc);
     assert(top_active_mask.any());
 
     const address_type null_pc = -1;
+
+    // fast path: every thread still running goes to the same next PC (or all
+    // threads are done), so there is no divergence and, outside of calls and
+    // returns, only the top entry changes
+    if( next_inst_op != CALL_OPS && next_inst_op != RET_OPS ) {
+        simt_mask_t live_mask = top_active_mask & ~thread_done;
+        address_type uniform_pc = null_pc;
+        bool uniform = true;
+        for( unsigned i=0; i < m_warp_size && uniform; i++ ) {
+            if( !live_mask.test(i) ) 
+                continue;
+            if( uniform_pc == null_pc ) 
+                uniform_pc = next_pc[i];
+            else 
+                uniform = (next_pc[i] == uniform_pc);
+        }
+        if( uniform ) {
+            if( uniform_pc == null_pc || (uniform_pc == top_recvg_pc && top_type != STACK_ENTRY_TYPE_CALL) ) {
+                pop(); // all threads done, or reconverged with the entry below
+            } else {
+                top().m_pc = uniform_pc;
+                top().m_active_mask = live_mask;
+            }
+            return;
+        }
+    }
+
     bool warp_diverged = false;
     address_type new_recvg_pc = null_pc;
     unsigned num_divergent_paths=0;
@@ -724,19 +718,19 @@ void simt_stack::update( simt_mask_t &thread_done, addr_vector_t &next_pc, addre
     		new_stack_entry.m_active_mask = tmp_active_mask;
     		new_stack_entry.m_branch_div_cycle = gpu_sim_cycle+gpu_tot_sim_cycle;
     		new_stack_entry.m_type = STACK_ENTRY_TYPE_CALL;
-    		m_stack.push_back(new_stack_entry);
+    		push(new_stack_entry);
     		return;
     	}else if(next_inst_op == RET_OPS && top_type==STACK_ENTRY_TYPE_CALL){
     		// pop the CALL Entry
     		assert(num_divergent_paths == 1);
-    		m_stack.pop_back();
+    		pop();
 
-    		assert(m_stack.size() > 0);
-    		m_stack.back().m_pc=tmp_next_pc;// set the PC of the stack top entry to return PC from  the call stack;
+    		assert(m_depth > 0);
+    		top().m_pc=tmp_next_pc;// set the PC of the stack top entry to return PC from  the call stack;
             // Check if the New top of the stack is reconverging
-            if (tmp_next_pc == m_stack.back().m_recvg_pc && m_stack.back().m_type!=STACK_ENTRY_TYPE_CALL){
-            	assert(m_stack.back().m_type==STACK_ENTRY_TYPE_NORMAL);
-            	m_stack.pop_back();
+            if (tmp_next_pc == top().m_recvg_pc && top().m_type!=STACK_ENTRY_TYPE_CALL){
+            	assert(top().m_type==STACK_ENTRY_TYPE_NORMAL);
+            	pop();
             }
             return;
     	}
@@ -753,10 +747,10 @@ void simt_stack::update( simt_mask_t &thread_done, addr_vector_t &next_pc, addre
             // modify the existing top entry into a reconvergence entry in the pdom stack
             new_recvg_pc = recvg_pc;
             if (new_recvg_pc != top_recvg_pc) {
-                m_stack.back().m_pc = new_recvg_pc;
-                m_stack.back().m_branch_div_cycle = gpu_sim_cycle+gpu_tot_sim_cycle;
+                top().m_pc = new_recvg_pc;
+                top().m_branch_div_cycle = gpu_sim_cycle+gpu_tot_sim_cycle;
 
-                m_stack.push_back(simt_stack_entry());
+                push(simt_stack_entry());
             }
         }
 
@@ -764,19 +758,19 @@ void simt_stack::update( simt_mask_t &thread_done, addr_vector_t &next_pc, addre
         if (warp_diverged && tmp_next_pc == new_recvg_pc) continue;
 
         // update the current top of pdom stack
-        m_stack.back().m_pc = tmp_next_pc;
-        m_stack.back().m_active_mask = tmp_active_mask;
+        top().m_pc = tmp_next_pc;
+        top().m_active_mask = tmp_active_mask;
         if (warp_diverged) {
-            m_stack.back().m_calldepth = 0;
-            m_stack.back().m_recvg_pc = new_recvg_pc;
+            top().m_calldepth = 0;
+            top().m_recvg_pc = new_recvg_pc;
         } else {
-            m_stack.back().m_recvg_pc = top_recvg_pc;
+            top().m_recvg_pc = top_recvg_pc;
         }
 
-        m_stack.push_back(simt_stack_entry());
+        push(simt_stack_entry());
     }
-    assert(m_stack.size() > 0);
-    m_stack.pop_back();
+    assert(m_depth > 0);
+    pop();
 
 
     if (warp_diverged) {
@@ -807,16 +801,16 @@ bool  core_t::ptx_thread_done( unsigned hw_thread_id ) const
 void core_t::updateSIMTStack(unsigned warpId, warp_inst_t * inst)
 {
     simt_mask_t thread_done;
-    addr_vector_t next_pc;
+    address_type next_pc[MAX_WARP_SIZE_SIMT_STACK];
     unsigned wtid = warpId * m_warp_size;
     for (unsigned i = 0; i < m_warp_size; i++) {
         if( ptx_thread_done(wtid+i) ) {
             thread_done.set(i);
-            next_pc.push_back( (address_type)-1 );
+            next_pc[i] = (address_type)-1;
         } else {
             if( inst->reconvergence_pc == RECONVERGE_RETURN_PC ) 
                 inst->reconvergence_pc = get_return_pc(m_thread[wtid+i]);
-            next_pc.push_back( m_thread[wtid+i]->get_pc() );
+            next_pc[i] = m_thread[wtid+i]->get_pc();
         }
     }
     m_simt_stack[warpId]->update(thread_done,next_pc,inst->reconvergence_pc, inst->op,inst->isize,inst->pc);
@@ -154,6 +154,7 @@ enum _memory_op_t {
 #include <stdlib.h>
 #include <map>
 #include <deque>
+#include <algorithm>
 
 #if !defined(__VECTOR_TYPES_H__)
 struct dim3 {
@@ -296,7 +297,13 @@ const unsigned MAX_WARP_SIZE = 32;
 typedef std::bitset<MAX_WARP_SIZE> active_mask_t;
 #define MAX_WARP_SIZE_SIMT_STACK  MAX_WARP_SIZE
 typedef std::bitset<MAX_WARP_SIZE_SIMT_STACK> simt_mask_t;
-typedef std::vector<address_type> addr_vector_t;
+
+// Divergence alone needs at most 2*warp_size+1 entries (every split leaves a
+// reconvergence entry and at least one thread per path); the rest of the
+// fixed-depth stack is headroom for nested calls. Unlike the std::deque it
+// replaced, the stack does not grow: a warp that goes deeper aborts the
+// simulation with an overflow error.
+#define MAX_SIMT_STACK_DEPTH (4*MAX_WARP_SIZE_SIMT_STACK)
 
 class simt_stack {
 public:
@@ -304,7 +311,7 @@ public:
 
     void reset();
     void launch( address_type start_pc, const simt_mask_t &active_mask );
-    void update( simt_mask_t &thread_done, addr_vector_t &next_pc, address_type recvg_pc, op_type next_inst_op,unsigned next_inst_size, address_type next_inst_pc );
+    void update( simt_mask_t &thread_done, const address_type next_pc[], address_type recvg_pc, op_type next_inst_op,unsigned next_inst_size, address_type next_inst_pc );
 
     const simt_mask_t &get_active_mask() const;
     void     get_pdom_stack_top_info( unsigned *pc, unsigned *rpc ) const;
@@ -331,7 +338,13 @@ protected:
             m_pc(-1), m_calldepth(0), m_active_mask(), m_recvg_pc(-1), m_branch_div_cycle(0), m_type(STACK_ENTRY_TYPE_NORMAL) { };
     };
 
-    std::deque<simt_stack_entry> m_stack;
+    simt_stack_entry &top() { assert(m_depth > 0); return m_stack[m_depth-1]; }
+    const simt_stack_entry &top() const { assert(m_depth > 0); return m_stack[m_depth-1]; }
+    void push( const simt_stack_entry &entry );
+    void pop() { assert(m_depth > 0); m_depth--; }
+
+    simt_stack_entry m_stack[MAX_SIMT_STACK_DEPTH];
+    unsigned m_depth;
 };
 
 #define GLOBAL_HEAP_START 0x80000000
@@ -884,6 +897,169 @@ public:
         }
     };
 
+    // Groups the accesses of one subwarp into transactions without building a
+    // std::map per instruction. The segment of every access is gathered into a
+    // fixed array, sorted and uniqued, and each access then finds its segment by
+    // binary search. Chunk, byte and thread masks are accumulated as plain words
+    // and only widened into a transaction_info when a transaction is read back.
+    // Transactions come out in ascending segment order (and, for atomics, in
+    // creation order within a segment), exactly as the std::map versions did.
+    class subwarp_coalescer {
+    public:
+        static const unsigned MAX_ACCESSES = MAX_WARP_SIZE*MAX_ACCESSES_PER_INSN_PER_THREAD;
+
+        subwarp_coalescer() { reset(); }
+        void reset() { m_num_accesses=0; m_num_transactions=0; }
+        bool empty() const { return m_num_accesses == 0; }
+
+        // record one access by 'thread'; accesses must be added in lane order
+        void add( unsigned thread, new_addr_type addr )
+        {
+            assert( m_num_accesses < MAX_ACCESSES );
+            m_thread[m_num_accesses] = thread;
+            m_addr[m_num_accesses] = addr;
+            m_num_accesses++;
+        }
+
+        // one transaction per segment touched
+        void coalesce( unsigned segment_size, unsigned size )
+        {
+            unsigned num_segments = find_segments(segment_size);
+            for( unsigned t=0; t < num_segments; t++ ) {
+                clear_transaction(t);
+                m_trans_segment[t] = t;
+                m_order[t] = t;
+            }
+            m_num_transactions = num_segments;
+            for( unsigned a=0; a < m_num_accesses; a++ )
+                add_to_transaction(m_seg_of[a],a,size);
+        }
+
+        // atomics: an access joins the oldest transaction in its segment whose
+        // bytes it does not overlap, otherwise it opens a new transaction
+        void coalesce_atomic( unsigned segment_size, unsigned size )
+        {
+            unsigned num_segments = find_segments(segment_size);
+            for( unsigned s=0; s < num_segments; s++ ) 
+                m_seg_head[s] = m_seg_tail[s] = NONE;
+            m_num_transactions=0;
+            for( unsigned a=0; a < m_num_accesses; a++ ) {
+                unsigned s = m_seg_of[a];
+                unsigned idx = m_addr[a]&127;
+                unsigned t;
+                for( t=m_seg_head[s]; t != NONE; t=m_next[t] ) {
+                    if( !overlaps(t,idx,size) ) 
+                        break;
+                }
+                if( t == NONE ) {
+                    t = m_num_transactions++;
+                    clear_transaction(t);
+                    m_trans_segment[t] = s;
+                    m_next[t] = NONE;
+                    if( m_seg_tail[s] == NONE ) m_seg_head[s] = t;
+                    else m_next[m_seg_tail[s]] = t;
+                    m_seg_tail[s] = t;
+                }
+                assert( !overlaps(t,idx,size) );
+                add_to_transaction(t,a,size);
+            }
+            unsigned n=0;
+            for( unsigned s=0; s < num_segments; s++ ) 
+                for( unsigned t=m_seg_head[s]; t != NONE; t=m_next[t] ) 
+                    m_order[n++] = t;
+            assert( n == m_num_transactions );
+        }
+
+        unsigned num_transactions() const { return m_num_transactions; }
+        new_addr_type segment( unsigned n ) const { return m_segment[m_trans_segment[m_order[n]]]; }
+        void get_transaction( unsigned n, transaction_info &info ) const
+        {
+            unsigned t = m_order[n];
+            info.chunks = std::bitset<4>(m_chunks[t]);
+            info.active = active_mask_t(m_active[t]);
+            info.bytes = mem_access_byte_mask_t(m_bytes[t][1]);
+            info.bytes <<= 64;
+            info.bytes |= mem_access_byte_mask_t(m_bytes[t][0]);
+        }
+
+    private:
+        static const unsigned NONE = (unsigned)-1;
+
+        // sorts and uniques the segment of every access into m_segment[] and
+        // sets m_seg_of[] to the index of each access's segment
+        unsigned find_segments( unsigned segment_size )
+        {
+            assert( m_num_accesses > 0 );
+            new_addr_type mask = ~((new_addr_type)segment_size-1);
+            bool uniform = true;
+            for( unsigned a=0; a < m_num_accesses; a++ ) {
+                // segment addresses are truncated to 32 bits, matching line_size_based_tag_func()
+                m_segment[a] = (address_type)(m_addr[a] & mask);
+                uniform &= (m_segment[a] == m_segment[0]);
+            }
+            if( uniform ) {
+                // common fully coalesced case: no sort needed
+                for( unsigned a=0; a < m_num_accesses; a++ ) 
+                    m_seg_of[a] = 0;
+                return 1;
+            }
+            new_addr_type sorted[MAX_ACCESSES];
+            std::copy(m_segment,m_segment+m_num_accesses,sorted);
+            std::sort(sorted,sorted+m_num_accesses);
+            unsigned num_segments = std::unique(sorted,sorted+m_num_accesses) - sorted;
+            for( unsigned a=0; a < m_num_accesses; a++ ) 
+                m_seg_of[a] = std::lower_bound(sorted,sorted+num_segments,m_segment[a]) - sorted;
+            std::copy(sorted,sorted+num_segments,m_segment);
+            return num_segments;
+        }
+        void clear_transaction( unsigned t )
+        {
+            m_chunks[t] = 0;
+            m_active[t] = 0;
+            m_bytes[t][0] = m_bytes[t][1] = 0;
+        }
+        // bytes [idx,idx+size) of the 128-byte chunk as two 64-bit words
+        static void byte_span( unsigned idx, unsigned size, unsigned long long span[2] )
+        {
+            assert( size > 0 && size <= 64 && idx+size <= 128 );
+            unsigned long long ones = (size == 64)? ~0ULL : ((1ULL<<size)-1);
+            span[0] = (idx < 64)? (ones << idx) : 0;
+            span[1] = (idx >= 64)? (ones << (idx-64)) : ((idx+size > 64)? (ones >> (64-idx)) : 0);
+        }
+        bool overlaps( unsigned t, unsigned idx, unsigned size ) const
+        {
+            unsigned long long span[2];
+            byte_span(idx,size,span);
+            return (m_bytes[t][0] & span[0]) || (m_bytes[t][1] & span[1]);
+        }
+        void add_to_transaction( unsigned t, unsigned a, unsigned size )
+        {
+            unsigned idx = m_addr[a]&127;
+            unsigned long long span[2];
+            byte_span(idx,size,span);
+            m_chunks[t] |= 1 << (idx/32); // which 32-byte chunk within in a 128-byte chunk
+            m_active[t] |= 1ULL << m_thread[a];
+            m_bytes[t][0] |= span[0];
+            m_bytes[t][1] |= span[1];
+        }
+
+        unsigned m_num_accesses;
+        unsigned m_thread[MAX_ACCESSES];
+        new_addr_type m_addr[MAX_ACCESSES];
+        new_addr_type m_segment[MAX_ACCESSES]; // per access, then sorted unique segments
+        unsigned m_seg_of[MAX_ACCESSES];       // access -> segment index
+
+        unsigned m_num_transactions;
+        unsigned m_trans_segment[MAX_ACCESSES];
+        unsigned char m_chunks[MAX_ACCESSES];
+        unsigned long long m_active[MAX_ACCESSES];
+        unsigned long long m_bytes[MAX_ACCESSES][2];
+        unsigned m_order[MAX_ACCESSES];        // send order -> transaction
+        unsigned m_next[MAX_ACCESSES];         // atomics: next transaction in same segment
+        unsigned m_seg_head[MAX_ACCESSES];
+        unsigned m_seg_tail[MAX_ACCESSES];
+    };
+
     void generate_mem_accesses();
     void memory_coalescing_arch_13( bool is_write, mem_access_type access_type );
     void memory_coalescing_arch_13_atomic( bool is_write, mem_access_type access_type );
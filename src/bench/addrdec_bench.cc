@@ -0,0 +1,140 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Wilson W.L. Fung
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Standalone benchmark for linear_to_raw_address_translation. It decodes
+// sequential, strided and random address streams with the bit-by-bit
+// reference decoder, the compiled per-address decoder and the batch decoder,
+// checks that all three agree and reports the time per address. The mapping
+// options are the simulator's (-gpgpu_mem_addr_mapping, -gpgpu_mem_address_mask
+// and -gpgpu_mem_addr_test, which runs sweep_test() at init). This is not part
+// of the simulator build; compile it on its own with
+//
+//    g++ -O3 -std=c++0x -I.. -o addrdec_bench addrdec_bench.cc ../gpgpu-sim/addrdec.cc ../option_parser.cc
+//    ./addrdec_bench -bench_n_mem 6 -bench_n_sub_partition 2 [-gpgpu_mem_addr_mapping <map>]
+//
+// Add -mbmi2 (or -march=native) to time the PEXT version.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include "../option_parser.h"
+#include "../gpgpu-sim/addrdec.h"
+
+enum pattern_t { SEQUENTIAL, STRIDED, RANDOM, NUM_PATTERNS };
+static const char *pattern_str[] = { "sequential", "strided", "random" };
+
+static void make_addresses( std::vector<new_addr_type> &addr, pattern_t pattern )
+{
+   for ( unsigned i = 0; i < addr.size(); i++ ) {
+      switch ( pattern ) {
+      case SEQUENTIAL: addr[i] = (new_addr_type)i * 32; break;
+      case STRIDED:    addr[i] = (new_addr_type)i * 4096 + (i & 31) * 128; break;
+      case RANDOM:     addr[i] = (((new_addr_type)rand() << 16) ^ rand()) & 0xFFFFFFFFFULL; break;
+      default: abort();
+      }
+   }
+}
+
+static bool same( const addrdec_t &a, const addrdec_t &b )
+{
+   return a.chip == b.chip && a.bk == b.bk && a.row == b.row && a.col == b.col &&
+          a.burst == b.burst && a.sub_partition == b.sub_partition;
+}
+
+int main( int argc, const char **argv )
+{
+   unsigned n_mem, n_sub_partition, iterations;
+   linear_to_raw_address_translation mapping;
+
+   option_parser_t opp = option_parser_create();
+   mapping.addrdec_setoption(opp);
+   option_parser_register(opp, "-bench_n_mem", OPT_UINT32, &n_mem,
+                          "number of memory channels", "6");
+   option_parser_register(opp, "-bench_n_sub_partition", OPT_UINT32, &n_sub_partition,
+                          "number of sub partitions per channel", "2");
+   option_parser_register(opp, "-bench_iterations", OPT_UINT32, &iterations,
+                          "passes over each address stream", "200");
+   option_parser_cmdline(opp, argc, argv);
+   mapping.init(n_mem, n_sub_partition);
+
+   const unsigned n_addr = 64 * 1024;
+   std::vector<new_addr_type> addr(n_addr);
+   std::vector<addrdec_t> ref(n_addr), tlx(n_addr), batch(n_addr);
+   srand(1);
+
+   printf("%-10s %12s %12s %12s %9s\n", "pattern", "ref (ns)", "single (ns)", "batch (ns)", "speedup");
+   for ( unsigned p = 0; p < NUM_PATTERNS; p++ ) {
+      make_addresses(addr, (pattern_t)p);
+      for ( unsigned i = 0; i < n_addr; i++ ) {
+         mapping.addrdec_tlx_reference(addr[i], &ref[i]);
+         mapping.addrdec_tlx(addr[i], &tlx[i]);
+         if ( !same(ref[i], tlx[i]) ||
+              mapping.partition_address(addr[i]) != mapping.partition_address_reference(addr[i]) ) {
+            printf("MISMATCH: pattern=%s address=%llx\n", pattern_str[p], addr[i]);
+            return 1;
+         }
+      }
+      mapping.addrdec_tlx(&addr[0], &batch[0], n_addr);
+      for ( unsigned i = 0; i < n_addr; i++ ) {
+         if ( !same(ref[i], batch[i]) ) {
+            printf("MISMATCH: pattern=%s address=%llx (batch)\n", pattern_str[p], addr[i]);
+            return 1;
+         }
+      }
+
+      double ns[3];
+      for ( unsigned impl = 0; impl < 3; impl++ ) {
+         unsigned long long sink = 0;
+         clock_t start = clock();
+         for ( unsigned n = 0; n < iterations; n++ ) {
+            switch ( impl ) {
+            case 0:
+               for ( unsigned i = 0; i < n_addr; i++ )
+                  mapping.addrdec_tlx_reference(addr[i], &ref[i]);
+               break;
+            case 1:
+               for ( unsigned i = 0; i < n_addr; i++ )
+                  mapping.addrdec_tlx(addr[i], &tlx[i]);
+               break;
+            default:
+               mapping.addrdec_tlx(&addr[0], &batch[0], n_addr);
+               break;
+            }
+            sink += (impl == 0)? ref[n % n_addr].row : (impl == 1)? tlx[n % n_addr].row : batch[n % n_addr].row;
+         }
+         ns[impl] = 1e9 * (double)(clock() - start) / CLOCKS_PER_SEC / ((double)iterations * n_addr);
+         if ( sink == 0xdeadbeef )
+            printf(" ");
+      }
+      printf("%-10s %12.2f %12.2f %12.2f %8.2fx\n", pattern_str[p], ns[0], ns[1], ns[2], ns[0] / ns[2]);
+   }
+   return 0;
+}
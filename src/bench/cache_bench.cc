@@ -0,0 +1,283 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Wilson W.L. Fung
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Standalone microbenchmark for tag_array. It drives the tag arrays of a few
+// representative cache configurations with synthetic address streams
+// (sequential, strided, random and a hot working set), fills reserved lines
+// after a fixed latency, and reports the hit/miss breakdown, a checksum of
+// the selected line indices and the time per access. Every stream is also run
+// through a reference tag array with the scalar array-of-structs lookup
+// tag_array used to have; the benchmark fails with MISMATCH unless the counts
+// and the line index and writeback checksums are identical. This is not part
+// of the simulator build; compile it with
+//
+//    g++ -O3 -std=c++0x -I.. -o cache_bench cache_bench.cc ../gpgpu-sim/gpu-cache.cc
+//    ./cache_bench [accesses per stream]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <deque>
+#include <vector>
+
+#include "../gpgpu-sim/gpu-cache.h"
+#include "../gpgpu-sim/gpu-misc.h"
+#include "../gpgpu-sim/stat-tool.h"
+#include "../gpgpu-sim/mem_fetch.h"
+#include "../gpgpu-sim/addrdec.h"
+
+// gpu-cache.cc refers to these for the cache models built on top of
+// tag_array; the benchmark only needs LOGB2 and the access logger
+unsigned int LOGB2( unsigned int v )
+{
+   unsigned int shift, r = 0;
+   for( shift=16; shift; shift >>= 1 ) {
+      if( v >= (1u << shift) ) {
+         v >>= shift;
+         r |= shift;
+      }
+   }
+   return r;
+}
+void shader_cache_access_log( int logger_id, int type, int miss ) {}
+unsigned mem_access_t::sm_next_access_uid = 0;
+const char * mem_access_type_str(enum mem_access_type access_type) { abort(); }
+mem_fetch::mem_fetch( const mem_access_t &access, const warp_inst_t *inst, unsigned ctrl_size, unsigned wid,
+                      unsigned sid, unsigned tpc, const class memory_config *config ) { abort(); }
+void mem_fetch::set_status( enum mem_fetch_status status, unsigned long long cycle ) { abort(); }
+void mem_fetch::print( FILE *fp, bool print_inst ) const { abort(); }
+bool mem_fetch::isatomic() const { abort(); }
+new_addr_type linear_to_raw_address_translation::partition_address( new_addr_type addr ) const { abort(); }
+
+struct cache_setup {
+   const char *name;
+   const char *config;
+   bool l1d; // uses the L1D (hashed) set index function
+};
+
+static const cache_setup setups[] = {
+   { "L1D", "32:128:4,L:L:m:N:H,A:32:8,8",      true  },
+   { "L1T", "4:128:24,L:R:m:N:L,F:128:4,128:2", false },
+   { "L1C", "64:64:2,L:R:m:N:L,A:2:32,4",       false },
+   { "L1I", "4:128:4,F:R:m:N:L,A:2:32,4",       false },
+   { "L2",  "64:128:8,L:B:m:W:L,A:32:4,4:0,32", false },
+};
+static const unsigned num_setups = sizeof(setups)/sizeof(setups[0]);
+
+enum stream_t { SEQUENTIAL, STRIDED, RANDOM, HOT_SET, NUM_STREAMS };
+static const char *stream_str[] = { "sequential", "strided", "random", "hot-set" };
+
+static new_addr_type next_address( stream_t stream, unsigned n, unsigned line_sz )
+{
+   switch( stream ) {
+   case SEQUENTIAL: return (new_addr_type)n * line_sz;
+   case STRIDED:    return (new_addr_type)n * 4096 + (n / 1024) * line_sz;
+   case RANDOM:     return (new_addr_type)(rand() % (1<<20)) * line_sz;
+   case HOT_SET:    return (new_addr_type)((rand() % 10)? rand() % 64 : rand() % (1<<20)) * line_sz;
+   default: abort();
+   }
+}
+
+// exposes the parsed parameters the reference tag array needs
+template<class CONFIG> 
+struct bench_config : public CONFIG {
+   unsigned assoc() const { return this->m_assoc; }
+   enum replacement_policy_t replacement_policy() const { return this->m_replacement_policy; }
+};
+
+// the array of cache_block_t with the one-way-at-a-time scalar lookup that
+// tag_array used before it was split into per-field arrays
+template<class CONFIG> 
+class reference_tag_array {
+public:
+   reference_tag_array( const bench_config<CONFIG> &config ) 
+      : m_config(config), m_lines(config.get_num_lines()) {}
+
+   enum cache_request_status probe( new_addr_type addr, unsigned &idx ) const
+   {
+      unsigned set_index = m_config.set_index(addr);
+      new_addr_type tag = m_config.tag(addr);
+      unsigned invalid_line = (unsigned)-1;
+      unsigned valid_line = (unsigned)-1;
+      unsigned valid_timestamp = (unsigned)-1;
+      bool all_reserved = true;
+      for( unsigned way=0; way < m_config.assoc(); way++ ) {
+         unsigned index = set_index*m_config.assoc()+way;
+         const cache_block_t &line = m_lines[index];
+         if( line.m_tag == tag && line.m_status != INVALID ) {
+            idx = index;
+            return (line.m_status == RESERVED)? HIT_RESERVED : HIT;
+         }
+         if( line.m_status != RESERVED ) {
+            all_reserved = false;
+            if( line.m_status == INVALID ) {
+               invalid_line = index;
+            } else {
+               unsigned timestamp = (m_config.replacement_policy() == LRU)? line.m_last_access_time : line.m_alloc_time;
+               if( timestamp < valid_timestamp ) {
+                  valid_timestamp = timestamp;
+                  valid_line = index;
+               }
+            }
+         }
+      }
+      if( all_reserved ) 
+         return RESERVATION_FAIL;
+      idx = (invalid_line != (unsigned)-1)? invalid_line : valid_line;
+      assert( idx != (unsigned)-1 );
+      return MISS;
+   }
+
+   enum cache_request_status access( new_addr_type addr, unsigned time, unsigned &idx, bool &wb, cache_block_t &evicted )
+   {
+      enum cache_request_status status = probe(addr,idx);
+      if( status == HIT || status == HIT_RESERVED ) {
+         m_lines[idx].m_last_access_time = time;
+      } else if( status == MISS ) {
+         cache_block_t &line = m_lines[idx];
+         if( line.m_status == MODIFIED ) {
+            wb = true;
+            evicted = line;
+         }
+         line.m_tag = m_config.tag(addr);
+         line.m_block_addr = m_config.block_addr(addr);
+         line.m_alloc_time = time;
+         line.m_last_access_time = time;
+         line.m_fill_time = 0;
+         line.m_status = RESERVED;
+      }
+      return status;
+   }
+
+   void fill( unsigned idx, unsigned time ) 
+   {
+      m_lines[idx].m_status = VALID;
+      m_lines[idx].m_fill_time = time;
+   }
+   void set_status( unsigned idx, cache_block_state status ) { m_lines[idx].m_status = status; }
+
+private:
+   const bench_config<CONFIG> &m_config;
+   std::vector<cache_block_t> m_lines;
+};
+
+struct pending_fill {
+   unsigned idx;
+   unsigned time;
+};
+
+struct stream_result {
+   unsigned count[NUM_CACHE_REQUEST_STATUS];
+   unsigned writebacks;
+   unsigned long long checksum; // of the selected line indices
+   unsigned long long wb_checksum; // of the evicted block addresses
+   double ns;
+};
+
+template<class TAGS> 
+static void run_stream( TAGS &tags, stream_t stream, unsigned line_sz, unsigned accesses, stream_result &r )
+{
+   const unsigned fill_latency = 200;
+   std::deque<pending_fill> fills;
+   memset(&r,0,sizeof(r));
+   srand(stream+1);
+
+   clock_t start = clock();
+   for( unsigned n=0; n < accesses; n++ ) {
+      unsigned time = n;
+      while( !fills.empty() && fills.front().time <= time ) {
+         tags.fill(fills.front().idx,time);
+         fills.pop_front();
+      }
+      new_addr_type addr = next_address(stream,n,line_sz);
+      bool write = (rand() % 8) == 0;
+      unsigned idx = 0;
+      bool wb = false;
+      cache_block_t evicted;
+      enum cache_request_status status = tags.access(addr,time,idx,wb,evicted);
+      r.count[status]++;
+      if( wb ) {
+         r.writebacks++;
+         r.wb_checksum = r.wb_checksum*31 + evicted.m_block_addr;
+      }
+      if( status == MISS ) {
+         pending_fill f = { idx, time + fill_latency };
+         fills.push_back(f);
+      } else if( status == HIT && write ) {
+         tags.set_status(idx,MODIFIED);
+      }
+      if( status != RESERVATION_FAIL ) 
+         r.checksum = r.checksum*31 + idx;
+   }
+   r.ns = 1e9 * (double)(clock()-start) / CLOCKS_PER_SEC / accesses;
+}
+
+template<class CONFIG> 
+static bool run_setup( const cache_setup &setup, stream_t stream, unsigned accesses )
+{
+   bench_config<CONFIG> config;
+   config.init((char*)setup.config,FuncCachePreferNone);
+   stream_result fast, ref;
+   {
+      tag_array tags(config,0,0);
+      run_stream(tags,stream,config.get_line_sz(),accesses,fast);
+   }
+   {
+      reference_tag_array<CONFIG> tags(config);
+      run_stream(tags,stream,config.get_line_sz(),accesses,ref);
+   }
+
+   printf("%-4s %-10s %9u %9u %9u %9u %9u %18llx %8.2f %8.2f\n", setup.name, stream_str[stream],
+          fast.count[HIT], fast.count[HIT_RESERVED], fast.count[MISS], fast.count[RESERVATION_FAIL], 
+          fast.writebacks, fast.checksum, fast.ns, ref.ns);
+   if( memcmp(fast.count,ref.count,sizeof(fast.count)) || fast.writebacks != ref.writebacks || 
+       fast.checksum != ref.checksum || fast.wb_checksum != ref.wb_checksum ) {
+      printf("MISMATCH: cache=%s stream=%s reference checksum=%llx wb checksum=%llx/%llx\n", setup.name, 
+             stream_str[stream], ref.checksum, fast.wb_checksum, ref.wb_checksum);
+      return false;
+   }
+   return true;
+}
+
+int main( int argc, char **argv )
+{
+   unsigned accesses = (argc > 1)? atoi(argv[1]) : 2000000;
+
+   printf("%-4s %-10s %9s %9s %9s %9s %9s %18s %8s %8s\n", "cache", "stream", "hit", "hit_res",
+          "miss", "res_fail", "wb", "checksum", "ns/acc", "ref ns");
+   for( unsigned c=0; c < num_setups; c++ ) {
+      for( unsigned s=0; s < NUM_STREAMS; s++ ) {
+         bool match = setups[c].l1d? run_setup<l1d_cache_config>(setups[c],(stream_t)s,accesses) 
+                                   : run_setup<cache_config>(setups[c],(stream_t)s,accesses);
+         if( !match ) 
+            return 1;
+      }
+   }
+   return 0;
+}
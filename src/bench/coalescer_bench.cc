@@ -0,0 +1,249 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Wilson W.L. Fung
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Standalone benchmark for warp_inst_t::subwarp_coalescer. It checks that the
+// coalescer groups accesses exactly like the std::map based code it replaced
+// and times both on fully coalesced, strided and random address patterns.
+// This is not part of the simulator build; compile it on its own with
+//
+//    g++ -O3 -std=c++0x -I.. -o coalescer_bench coalescer_bench.cc
+//    ./coalescer_bench [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+#include <map>
+#include <list>
+#include <vector>
+
+#include "../abstract_hardware_model.h"
+
+typedef warp_inst_t::transaction_info transaction_info;
+typedef warp_inst_t::subwarp_coalescer subwarp_coalescer;
+
+struct transaction {
+   new_addr_type segment;
+   transaction_info info;
+
+   bool operator==( const transaction &t ) const
+   {
+      return segment == t.segment && info.chunks == t.info.chunks &&
+             info.bytes == t.info.bytes && info.active == t.info.active;
+   }
+};
+
+struct instruction {
+   unsigned warp_size;
+   unsigned warp_parts;
+   unsigned data_size;
+   unsigned num_accesses; // per thread (local memory splits into 4B accesses)
+   bool atomic;
+   active_mask_t active;
+   new_addr_type addr[MAX_WARP_SIZE][MAX_ACCESSES_PER_INSN_PER_THREAD];
+};
+
+static unsigned segment_size_of( unsigned data_size )
+{
+   switch( data_size ) {
+   case 1: return 32;
+   case 2: return 64;
+   default: return 128;
+   }
+}
+
+static unsigned access_size_of( const instruction &inst )
+{
+   return (inst.num_accesses > 1)? 4 : inst.data_size;
+}
+
+static address_type tag( new_addr_type addr, unsigned segment_size )
+{
+   return addr & ~((new_addr_type)segment_size-1);
+}
+
+// the std::map based grouping from memory_coalescing_arch_13{,_atomic}
+static void reference_coalesce( const instruction &inst, std::vector<transaction> &out )
+{
+   unsigned segment_size = segment_size_of(inst.data_size);
+   unsigned size = access_size_of(inst);
+   unsigned subwarp_size = inst.warp_size / inst.warp_parts;
+   for( unsigned subwarp=0; subwarp < inst.warp_parts; subwarp++ ) {
+      std::map<new_addr_type,std::list<transaction_info> > subwarp_transactions;
+      for( unsigned thread=subwarp*subwarp_size; thread<subwarp_size*(subwarp+1); thread++ ) {
+         if( !inst.active.test(thread) )
+            continue;
+         for( unsigned access=0; access < inst.num_accesses; access++ ) {
+            new_addr_type addr = inst.addr[thread][access];
+            unsigned block_address = tag(addr,segment_size);
+            unsigned idx = (addr&127);
+            std::list<transaction_info> &l = subwarp_transactions[block_address];
+            transaction_info *info = NULL;
+            if( !inst.atomic ) {
+               if( l.empty() )
+                  l.push_back(transaction_info());
+               info = &l.front();
+            } else {
+               std::list<transaction_info>::iterator it;
+               for( it=l.begin(); it != l.end(); it++ ) {
+                  if( !it->test_bytes(idx,idx+size-1) ) {
+                     info = &(*it);
+                     break;
+                  }
+               }
+               if( !info ) {
+                  l.push_back(transaction_info());
+                  info = &l.back();
+               }
+            }
+            info->chunks.set(idx/32);
+            info->active.set(thread);
+            for( unsigned i=0; i < size; i++ )
+               info->bytes.set(idx+i);
+         }
+      }
+      std::map<new_addr_type,std::list<transaction_info> >::iterator t;
+      for( t=subwarp_transactions.begin(); t != subwarp_transactions.end(); t++ ) {
+         std::list<transaction_info>::iterator i;
+         for( i=t->second.begin(); i != t->second.end(); i++ ) {
+            transaction tr;
+            tr.segment = t->first;
+            tr.info = *i;
+            out.push_back(tr);
+         }
+      }
+   }
+}
+
+static void fast_coalesce( const instruction &inst, std::vector<transaction> &out )
+{
+   unsigned segment_size = segment_size_of(inst.data_size);
+   unsigned size = access_size_of(inst);
+   unsigned subwarp_size = inst.warp_size / inst.warp_parts;
+   subwarp_coalescer coalescer;
+   for( unsigned subwarp=0; subwarp < inst.warp_parts; subwarp++ ) {
+      coalescer.reset();
+      for( unsigned thread=subwarp*subwarp_size; thread<subwarp_size*(subwarp+1); thread++ ) {
+         if( !inst.active.test(thread) )
+            continue;
+         for( unsigned access=0; access < inst.num_accesses; access++ )
+            coalescer.add(thread,inst.addr[thread][access]);
+      }
+      if( coalescer.empty() )
+         continue;
+      if( inst.atomic )
+         coalescer.coalesce_atomic(segment_size,size);
+      else
+         coalescer.coalesce(segment_size,size);
+      for( unsigned t=0; t < coalescer.num_transactions(); t++ ) {
+         transaction tr;
+         tr.segment = coalescer.segment(t);
+         coalescer.get_transaction(t,tr.info);
+         out.push_back(tr);
+      }
+   }
+}
+
+enum pattern_t { COALESCED, STRIDED, RANDOM, NUM_PATTERNS };
+static const char *pattern_str[] = { "coalesced", "strided", "random" };
+
+static void make_instruction( instruction &inst, pattern_t pattern, bool atomic )
+{
+   static const unsigned sizes[] = { 1, 2, 4, 8, 16 };
+   inst.warp_size = MAX_WARP_SIZE;
+   inst.warp_parts = atomic? 2 : 1;
+   inst.data_size = atomic? 4 : sizes[rand()%5];
+   inst.num_accesses = (!atomic && inst.data_size >= 4 && rand()%4 == 0)? inst.data_size/4 : 1; // local
+   inst.atomic = atomic;
+   inst.active.reset();
+   for( unsigned t=0; t < inst.warp_size; t++ )
+      if( rand()%8 )
+         inst.active.set(t);
+   unsigned size = access_size_of(inst);
+   new_addr_type base = ((new_addr_type)(rand()%4096) << 12) | (rand()%2? (1ULL<<32) : 0);
+   unsigned stride = size << (rand()%6);
+   for( unsigned t=0; t < inst.warp_size; t++ ) {
+      for( unsigned a=0; a < inst.num_accesses; a++ ) {
+         new_addr_type addr = 0;
+         switch( pattern ) {
+         case COALESCED: addr = base + (t*inst.num_accesses+a)*size; break;
+         case STRIDED:   addr = base + (t*inst.num_accesses+a)*stride; break;
+         case RANDOM:    addr = base + (rand()%(1<<16))*size; break;
+         default: abort();
+         }
+         if( atomic && rand()%3 == 0 )
+            addr = base; // same-address atomics conflict
+         inst.addr[t][a] = addr;
+      }
+   }
+}
+
+int main( int argc, char **argv )
+{
+   unsigned iterations = (argc > 1)? atoi(argv[1]) : 200000;
+   const unsigned num_insts = 1024;
+   std::vector<instruction> insts(num_insts);
+   std::vector<transaction> ref, fast;
+   srand(1);
+
+   printf("%-10s %-7s %12s %12s %8s\n", "pattern", "kind", "map (ns)", "fast (ns)", "speedup");
+   for( unsigned p=0; p < NUM_PATTERNS; p++ ) {
+      for( unsigned atomic=0; atomic <= 1; atomic++ ) {
+         for( unsigned i=0; i < num_insts; i++ ) {
+            make_instruction(insts[i],(pattern_t)p,atomic);
+            ref.clear();
+            fast.clear();
+            reference_coalesce(insts[i],ref);
+            fast_coalesce(insts[i],fast);
+            if( ref != fast ) {
+               printf("MISMATCH: pattern=%s atomic=%u instruction=%u\n", pattern_str[p], atomic, i);
+               return 1;
+            }
+         }
+         double ns[2];
+         for( unsigned impl=0; impl < 2; impl++ ) {
+            clock_t start = clock();
+            unsigned long long sink = 0;
+            for( unsigned n=0; n < iterations; n++ ) {
+               std::vector<transaction> &out = impl? fast : ref;
+               out.clear();
+               if( impl )
+                  fast_coalesce(insts[n%num_insts],out);
+               else
+                  reference_coalesce(insts[n%num_insts],out);
+               sink += out.size();
+            }
+            ns[impl] = 1e9 * (double)(clock()-start) / CLOCKS_PER_SEC / iterations;
+            if( sink == 0 )
+               printf("no transactions generated\n");
+         }
+         printf("%-10s %-7s %12.1f %12.1f %7.2fx\n", pattern_str[p], atomic? "atomic" : "normal",
+                ns[0], ns[1], ns[0]/ns[1]);
+      }
+   }
+   return 0;
+}
@@ -0,0 +1,288 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Wilson W.L. Fung, Ali Bakhoda,
+// George L. Yuan
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Standalone driver that replays a memory request trace into the memory
+// partitions (L2 sub partitions + DRAM) without shader cores or an
+// interconnect. It reads the same configuration files as the simulator and
+// keeps the core, interconnect, L2 and DRAM clock domains, so DRAM scheduler
+// and memory configuration sweeps can run on recorded traffic directly.
+//
+// Trace format: one request per line, '#' starts a comment
+//
+//    <core cycle> <R|W> <hex address> <size in bytes>
+//
+// A binary trace captured with -gpgpu_mem_trace_file is accepted as well; its
+// MEM_TRACE_REQ_INJECT records are replayed as global reads and writes.
+//
+// Requests are injected at their core cycle (or as soon as the partition
+// input queue drains) and their reply is taken at the next interconnect
+// clock. This is not part of the simulator build; once the simulator has
+// been built, compile and run it with
+//
+//    g++ -O3 -std=c++0x -I.. -I../gpgpu-sim -I../cuda-sim -o dram_replay dram_replay.cc
+//        ../gpgpu-sim/mem_trace.cc -L$GPGPUSIM_ROOT/lib/$GPGPUSIM_CONFIG -lcudart -lz -lm -pthread
+//    ./dram_replay -config gpgpusim.config -replay_trace trace.txt [-replay_partition <id>]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <deque>
+#include <vector>
+
+#include "../option_parser.h"
+#include "../abstract_hardware_model.h"
+#include "../cuda-sim/cuda-sim.h"
+#include "../cuda-sim/ptx_ir.h"
+#include "../gpgpu-sim/gpu-sim.h"
+#include "../gpgpu-sim/icnt_wrapper.h"
+#include "../gpgpu-sim/l2cache.h"
+#include "../gpgpu-sim/mem_fetch.h"
+#include "../gpgpu-sim/mem_latency_stat.h"
+#include "../gpgpu-sim/mem_trace.h"
+#include "../gpgpu-sim/shader.h"
+
+static gpgpu_sim_config g_replay_config;
+
+struct trace_record {
+   unsigned long long cycle;
+   bool is_write;
+   new_addr_type addr;
+   unsigned size;
+};
+
+// reads the next request, skipping comments and blank lines
+static bool read_record( FILE *fp, mem_trace_reader *binary, trace_record &r )
+{
+   if ( binary ) {
+      mem_trace_record b;
+      while ( binary->next(b) ) {
+         if ( b.event != MEM_TRACE_REQ_INJECT )
+            continue;
+         r.cycle = b.cycle;
+         r.is_write = b.is_write;
+         r.addr = b.addr;
+         r.size = b.size;
+         return true;
+      }
+      return false;
+   }
+   char line[256];
+   while ( fgets(line, sizeof(line), fp) ) {
+      char *comment = strchr(line, '#');
+      if ( comment )
+         *comment = 0;
+      char rw;
+      if ( sscanf(line, "%llu %c %llx %u", &r.cycle, &rw, &r.addr, &r.size) != 4 )
+         continue;
+      r.is_write = (rw == 'W' || rw == 'w');
+      return true;
+   }
+   return false;
+}
+
+static mem_fetch *make_request( const trace_record &r, const memory_config *config )
+{
+   mem_access_byte_mask_t byte_mask;
+   for ( unsigned b = 0; b < r.size && (r.addr & 127) + b < MAX_MEMORY_ACCESS_SIZE; b++ )
+      byte_mask.set((r.addr & 127) + b);
+   active_mask_t active_mask;
+   active_mask.set(0);
+   mem_access_t access( r.is_write? GLOBAL_ACC_W : GLOBAL_ACC_R, r.addr, r.size, r.is_write,
+                        active_mask, byte_mask );
+   return new mem_fetch( access, NULL, r.is_write? WRITE_PACKET_SIZE : READ_PACKET_SIZE,
+                         0, 0, 0, config );
+}
+
+int main( int argc, const char **argv )
+{
+   char *trace_filename;
+   int replay_partition;
+   unsigned long long max_cycle;
+
+   option_parser_t opp = option_parser_create();
+   icnt_reg_options(opp);
+   g_replay_config.reg_options(opp);
+   ptx_reg_options(opp);
+   ptx_opcocde_latency_options(opp);
+   option_parser_register(opp, "-replay_trace", OPT_CSTR, &trace_filename,
+                          "memory request trace to replay", NULL);
+   option_parser_register(opp, "-replay_partition", OPT_INT32, &replay_partition,
+                          "only replay the requests mapped to this memory partition (-1 = all)", "-1");
+   option_parser_register(opp, "-replay_max_cycle", OPT_UINT64, &max_cycle,
+                          "stop after this many core cycles (0 = run until the trace drains)", "0");
+   option_parser_cmdline(opp, argc, argv);
+   if ( trace_filename == NULL ) {
+      fprintf(stderr, "usage: %s -config <gpgpusim.config> -replay_trace <trace> [-replay_partition <id>]\n", argv[0]);
+      exit(1);
+   }
+   FILE *trace = NULL;
+   mem_trace_reader *binary = NULL;
+   if ( mem_trace_reader::probe(trace_filename) )
+      binary = new mem_trace_reader(trace_filename);
+   else
+      trace = fopen(trace_filename, "r");
+   if ( trace == NULL && binary == NULL ) {
+      fprintf(stderr, "GPGPU-Sim DRAM replay: cannot open trace '%s'\n", trace_filename);
+      exit(1);
+   }
+   g_replay_config.init();
+
+   const memory_config *mem_config = g_replay_config.get_memory_config();
+   memory_stats_t *stats = new memory_stats_t(1, g_replay_config.get_shader_config(), mem_config);
+   std::vector<memory_partition_unit*> partition(mem_config->m_n_mem);
+   std::vector<memory_sub_partition*> sub_partition(mem_config->m_n_mem_sub_partition);
+   for ( unsigned i = 0; i < mem_config->m_n_mem; i++ ) {
+      partition[i] = new memory_partition_unit(i, mem_config, stats);
+      for ( unsigned p = 0; p < mem_config->m_n_sub_partition_per_memory_channel; p++ ) {
+         unsigned spid = i * mem_config->m_n_sub_partition_per_memory_channel + p;
+         sub_partition[spid] = partition[i]->get_sub_partition(p);
+      }
+   }
+   unsigned first_mem = 0, last_mem = mem_config->m_n_mem;
+   if ( replay_partition >= 0 ) {
+      assert( (unsigned)replay_partition < mem_config->m_n_mem );
+      first_mem = replay_partition;
+      last_mem = replay_partition + 1;
+   }
+   unsigned first_sub = first_mem * mem_config->m_n_sub_partition_per_memory_channel;
+   unsigned last_sub = last_mem * mem_config->m_n_sub_partition_per_memory_channel;
+
+   // requests that arrived but have not entered their sub partition yet
+   std::vector<std::deque<mem_fetch*> > input_queue(mem_config->m_n_mem_sub_partition);
+
+   trace_record next;
+   bool trace_done = !read_record(trace, binary, next);
+   unsigned long long n_requests = 0, n_reads = 0, n_writes = 0, n_skipped = 0;
+   unsigned long long outstanding = 0, n_replies = 0;
+   unsigned long long total_latency = 0, max_latency = 0;
+   unsigned long long input_stall = 0;
+
+   double core_time = 0, icnt_time = 0, l2_time = 0, dram_time = 0;
+   const double core_period = g_replay_config.get_core_period();
+   const double icnt_period = g_replay_config.get_icnt_period();
+   const double l2_period = g_replay_config.get_l2_period();
+   const double dram_period = g_replay_config.get_dram_period();
+   unsigned long long dram_cycles = 0;
+
+   clock_t start = clock();
+   while ( !trace_done || outstanding ) {
+      if ( max_cycle && gpu_sim_cycle >= max_cycle )
+         break;
+
+      // same clock domain stepping as gpgpu_sim::next_clock_domain()
+      double smallest = core_time;
+      if ( icnt_time < smallest ) smallest = icnt_time;
+      if ( dram_time < smallest ) smallest = dram_time;
+      bool l2_clk = false, icnt_clk = false, dram_clk = false, core_clk = false;
+      if ( l2_time <= smallest ) { smallest = l2_time; l2_clk = true; l2_time += l2_period; }
+      if ( icnt_time <= smallest ) { icnt_clk = true; icnt_time += icnt_period; }
+      if ( dram_time <= smallest ) { dram_clk = true; dram_time += dram_period; }
+      if ( core_time <= smallest ) { core_clk = true; core_time += core_period; }
+
+      if ( icnt_clk ) {
+         for ( unsigned i = first_sub; i < last_sub; i++ ) {
+            mem_fetch *mf = sub_partition[i]->top();
+            if ( mf ) {
+               unsigned long long latency = gpu_sim_cycle + gpu_tot_sim_cycle - mf->get_timestamp();
+               total_latency += latency;
+               if ( latency > max_latency )
+                  max_latency = latency;
+               n_replies++;
+               outstanding--;
+               sub_partition[i]->pop();
+               delete mf;
+            } else {
+               sub_partition[i]->pop();
+            }
+         }
+      }
+      if ( dram_clk ) {
+         for ( unsigned i = first_mem; i < last_mem; i++ )
+            partition[i]->dram_cycle();
+         dram_cycles++;
+      }
+      if ( l2_clk ) {
+         for ( unsigned i = first_sub; i < last_sub; i++ ) {
+            if ( !input_queue[i].empty() ) {
+               if ( sub_partition[i]->full() ) {
+                  input_stall++;
+               } else {
+                  sub_partition[i]->push(input_queue[i].front(), gpu_sim_cycle + gpu_tot_sim_cycle);
+                  input_queue[i].pop_front();
+               }
+            }
+            sub_partition[i]->cache_cycle(gpu_sim_cycle + gpu_tot_sim_cycle);
+         }
+      }
+      if ( core_clk ) {
+         while ( !trace_done && next.cycle <= gpu_sim_cycle ) {
+            mem_fetch *mf = make_request(next, mem_config);
+            unsigned spid = mf->get_sub_partition_id();
+            if ( spid < first_sub || spid >= last_sub ) {
+               delete mf;
+               n_skipped++;
+            } else {
+               input_queue[spid].push_back(mf);
+               outstanding++;
+               n_requests++;
+               if ( next.is_write )
+                  n_writes++;
+               else
+                  n_reads++;
+            }
+            trace_done = !read_record(trace, binary, next);
+         }
+         gpu_sim_cycle++;
+      }
+   }
+   double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+   if ( trace )
+      fclose(trace);
+   delete binary;
+
+   printf("dram_replay: trace = %s\n", trace_filename);
+   printf("dram_replay: core cycles = %llu, dram cycles = %llu\n", gpu_sim_cycle, dram_cycles);
+   printf("dram_replay: requests = %llu (reads = %llu, writes = %llu), skipped = %llu, unfinished = %llu\n",
+          n_requests, n_reads, n_writes, n_skipped, outstanding);
+   printf("dram_replay: average latency = %.2f, max latency = %llu (core cycles)\n",
+          n_replies? (double)total_latency / n_replies : 0.0, max_latency);
+   printf("dram_replay: input stall cycles = %llu\n", input_stall);
+   for ( unsigned i = first_mem; i < last_mem; i++ )
+      partition[i]->print(stdout);
+   for ( unsigned i = first_sub; i < last_sub; i++ ) {
+      unsigned accesses = 0, misses = 0;
+      sub_partition[i]->print_cache_stat(accesses, misses);
+   }
+   printf("dram_replay: simulation time = %.2f s (%.0f dram cycles/s, %.0f requests/s)\n",
+          seconds, seconds > 0? dram_cycles / seconds : 0.0, seconds > 0? n_requests / seconds : 0.0);
+
+   for ( unsigned i = 0; i < mem_config->m_n_mem; i++ )
+      delete partition[i];
+   return 0;
+}
@@ -0,0 +1,230 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Wilson W.L. Fung
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Standalone check for -power_async_eval. It feeds the same sequence of
+// synthetic power samples through the McPAT wrapper once synchronously and
+// once on the power evaluation thread, ending every "kernel" the way
+// gpu_print_stat() does (mcpat_flush, print_power_kernel_stats,
+// mcpat_reset_perf_count), and then compares everything the wrapper wrote:
+// the power report, the power, metric and steady state traces and the
+// columnar trace. The two modes run in separate processes because the
+// wrapper keeps its file setup in function statics.
+//
+// This is not part of the simulator build. It includes power_interface.cc
+// directly and links against the gpuwattch objects of a normal build (every
+// object in $(SIM_OBJ_FILES_DIR)/gpuwattch except main.o):
+//
+//    g++ -O2 -std=c++0x -I.. -I../cuda-sim -I../gpuwattch -DGPGPUSIM_POWER_MODEL -o power_async_check power_async_check.cc ../gpgpu-sim/stats_log.cc <gpuwattch objects> -lz -pthread
+//    ./power_async_check <gpuwattch xml> [samples per kernel] [kernels] [work]
+//
+// where work is the time in microseconds the simulation thread spends
+// between two samples (a stand-in for the timing model, 0 by default).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <string>
+
+#include "../gpgpu-sim/power_interface.cc"
+
+// mcpat_cycle() reads these through power_stat_t; the check builds its
+// samples directly and never calls it
+void power_core_stat_t::save_stats() { abort(); }
+void power_mem_stat_t::save_stats() { abort(); }
+unsigned cache_stats::get_stats( enum mem_access_type *access_type, unsigned num_access_type, 
+                                 enum cache_request_status *access_status, unsigned num_access_status ) const { abort(); }
+
+static const unsigned sample_freq = 500;
+static const char *mode_str[] = { "sync", "async" };
+static const char *file_str[] = { "power.log", "power_trace.gz", "metric_trace.gz", "steady_state.gz", "columnar.slog" };
+static const unsigned num_files = sizeof(file_str)/sizeof(file_str[0]);
+
+static std::string file_name( unsigned mode, unsigned f )
+{
+   return std::string("power_async_check_") + mode_str[mode] + "_" + file_str[f];
+}
+
+// max scaled by 0.95-1.05
+static double frand( double max ) { return max * (0.95 + 0.1 * rand() / RAND_MAX); }
+
+static void make_sample( power_sample_t &s, unsigned long long cycle, double &tot_insn )
+{
+   // phases of high and low activity so steady state detection has
+   // something to find
+   double activity = ((cycle / (40*sample_freq)) % 2)? frand(0.2) : frand(0.9);
+   s.clock_gated_lanes = false;
+   s.sample_cycles = sample_freq;
+   s.tot_inst = activity * frand(sample_freq * 15 * 32);
+   s.int_inst = s.tot_inst * 0.7;
+   s.fp_inst = s.tot_inst * 0.3;
+   s.committed_inst = s.tot_inst;
+   s.l1d_read_accesses = activity * frand(2000);
+   s.l1d_write_accesses = activity * frand(500);
+   s.regfile_reads = s.tot_inst * 2;
+   s.regfile_writes = s.tot_inst;
+   s.non_regfile_operands = s.tot_inst * 0.2;
+   s.icache_hits = s.tot_inst / 32;
+   s.icache_misses = frand(10);
+   s.ccache_hits = frand(100);
+   s.ccache_misses = frand(5);
+   s.tcache_hits = 0;
+   s.tcache_misses = 0;
+   s.shmem_read_access = activity * frand(1000);
+   s.l1d_read_hits = s.l1d_read_accesses * 0.6;
+   s.l1d_read_misses = s.l1d_read_accesses * 0.4;
+   s.l1d_write_hits = s.l1d_write_accesses * 0.5;
+   s.l1d_write_misses = s.l1d_write_accesses * 0.5;
+   s.l2_read_hits = s.l1d_read_misses * 0.7;
+   s.l2_read_misses = s.l1d_read_misses * 0.3;
+   s.l2_write_hits = s.l1d_write_misses * 0.7;
+   s.l2_write_misses = s.l1d_write_misses * 0.3;
+   s.num_idle_core = (1.0 - activity) * 15;
+   s.pipeline_duty_cycle = activity * 0.8;
+   s.dram_rd = s.l2_read_misses * 4;
+   s.dram_wr = s.l2_write_misses * 4;
+   s.dram_pre = frand(100);
+   s.fpu_accesses = s.fp_inst;
+   s.ialu_accesses = s.int_inst;
+   s.sfu_accesses = s.tot_inst * 0.05;
+   s.sp_active_lanes = activity * 32;
+   s.sfu_active_lanes = activity * 4;
+   s.icnt_mem_to_simt = s.l1d_read_misses * 5;
+   s.icnt_simt_to_mem = s.l1d_read_misses + s.l1d_write_misses * 5;
+   tot_insn += s.tot_inst;
+   s.tot_sim_insn = tot_insn;
+   s.cycle = cycle;
+}
+
+static void simulate( unsigned us )
+{
+   struct timeval start, now;
+   gettimeofday(&start,NULL);
+   do {
+      gettimeofday(&now,NULL);
+   } while( (now.tv_sec-start.tv_sec)*1000000 + (now.tv_usec-start.tv_usec) < us );
+}
+
+static int run( unsigned mode, char *xml, unsigned samples, unsigned kernels, unsigned work )
+{
+   std::string names[num_files];
+   for( unsigned f=0; f < num_files; f++ ) 
+      names[f] = file_name(mode,f);
+   gpgpu_sim_wrapper *wrapper = new gpgpu_sim_wrapper(true,xml,NULL);
+   wrapper->init_mcpat(xml,(char*)names[0].c_str(),(char*)names[1].c_str(),(char*)names[2].c_str(),
+                       (char*)names[3].c_str(),true,true,true,false,8,8,6,0,sample_freq);
+   if( mode ) 
+      g_power_eval_thread = new power_eval_thread(wrapper,64);
+   g_power_columnar_trace = new stats_log_writer(names[4].c_str(),6);
+
+   struct timeval start, end;
+   gettimeofday(&start,NULL);
+   srand(1);
+   unsigned long long tot_cycle = 0;
+   double tot_insn = 0;
+   for( unsigned k=0; k < kernels; k++ ) {
+      for( unsigned n=1; n <= samples; n++ ) {
+         if( work ) 
+            simulate(work);
+         power_sample_t s;
+         make_sample(s,tot_cycle+n*sample_freq,tot_insn);
+         if( g_power_eval_thread )
+            g_power_eval_thread->push(s);
+         else
+            evaluate_power_sample(wrapper,s);
+      }
+      char info[64];
+      snprintf(info,sizeof(info),"kernel_name = kernel_%u \nkernel_launch_uid = %u \n",k,k+1);
+      mcpat_flush();
+      wrapper->print_power_kernel_stats(samples*sample_freq,tot_cycle,tot_insn,info,true);
+      mcpat_reset_perf_count(wrapper);
+      wrapper->detect_print_steady_state(1,tot_insn);
+      tot_cycle += samples*sample_freq;
+   }
+   mcpat_flush();
+   gettimeofday(&end,NULL);
+   printf("%-5s %u kernels x %u samples: %.3f s\n", mode_str[mode], kernels, samples,
+          (end.tv_sec-start.tv_sec) + 1e-6*(end.tv_usec-start.tv_usec));
+   fflush(stdout);
+   return 0;
+}
+
+// whole (decompressed for .gz) contents of a file
+static bool read_file( const std::string &name, std::string &out )
+{
+   gzFile f = gzopen(name.c_str(),"rb");
+   if( !f ) 
+      return false;
+   char buf[65536];
+   int n;
+   out.clear();
+   while( (n = gzread(f,buf,sizeof(buf))) > 0 )
+      out.append(buf,n);
+   gzclose(f);
+   return n == 0;
+}
+
+int main( int argc, char **argv )
+{
+   if( argc < 2 ) {
+      fprintf(stderr,"usage: power_async_check <gpuwattch xml> [samples per kernel] [kernels] [work]\n");
+      return 1;
+   }
+   unsigned samples = (argc > 2)? atoi(argv[2]) : 200;
+   unsigned kernels = (argc > 3)? atoi(argv[3]) : 3;
+   unsigned work = (argc > 4)? atoi(argv[4]) : 0;
+
+   for( unsigned mode=0; mode < 2; mode++ ) {
+      pid_t pid = fork();
+      if( pid == 0 ) {
+         exit(run(mode,argv[1],samples,kernels,work));
+      }
+      int status;
+      if( pid < 0 || waitpid(pid,&status,0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) ) {
+         printf("%s run failed\n", mode_str[mode]);
+         return 1;
+      }
+   }
+
+   bool match = true;
+   for( unsigned f=0; f < num_files; f++ ) {
+      std::string sync, async;
+      if( !read_file(file_name(0,f),sync) || !read_file(file_name(1,f),async) ) {
+         printf("%-16s cannot read\n", file_str[f]);
+         match = false;
+         continue;
+      }
+      bool same = (sync == async);
+      printf("%-16s %10zu bytes %s\n", file_str[f], sync.size(), same? "identical" : "MISMATCH");
+      match = match && same && !sync.empty();
+   }
+   return match? 0 : 1;
+}
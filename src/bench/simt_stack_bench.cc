@@ -0,0 +1,467 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Wilson W.L. Fung
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Standalone check for the simt_stack update fast path. It drives random
+// warps (uniform branches, divergent branches, reconvergence, calls, returns
+// and exiting threads) through both simt_stack and a copy of the std::deque
+// and std::map based update it replaced, compares the whole stack after every
+// update, and then times both on the recorded update sequence. This is not
+// part of the simulator build; compile it with
+//
+//    g++ -O3 -std=c++0x -I.. -o simt_stack_bench simt_stack_bench.cc ../abstract_hardware_model.cc ../cuda-sim/memory.cc
+//    ./simt_stack_bench [updates per warp size]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+#include <map>
+#include <deque>
+#include <vector>
+
+#include "../abstract_hardware_model.h"
+#include "../cuda-sim/ptx_sim.h"
+#include "../option_parser.h"
+
+// abstract_hardware_model.cc refers to these for the parts of the model that
+// sit on top of the functional simulator; simt_stack only needs the cycle
+// counters and the divergence statistics hook
+unsigned long long gpu_sim_cycle = 0;
+unsigned long long gpu_tot_sim_cycle = 0;
+void ptx_file_line_stats_add_warp_divergence( unsigned pc, unsigned n_way_divergence ) {}
+void ptx_file_line_stats_add_latency( unsigned pc, unsigned latency ) { abort(); }
+void ptx_file_line_stats_add_uncoalesced_gmem( unsigned pc, unsigned n_access ) { abort(); }
+void ptx_file_line_stats_add_smem_bank_conflict( unsigned pc, unsigned n_way_bkconflict ) { abort(); }
+void ptx_print_insn( address_type pc, FILE *fp ) {}
+const warp_inst_t *ptx_fetch_inst( address_type pc ) { abort(); }
+unsigned get_return_pc( void *thd ) { abort(); }
+void hit_watchpoint( unsigned watchpoint_num, ptx_thread_info *thd, const ptx_instruction *pI ) { abort(); }
+void ptx_thread_info::ptx_exec_inst( warp_inst_t &inst, unsigned lane_id ) { abort(); }
+void option_parser_register( option_parser_t opp, const char *name, enum option_dtype type,
+                             void *variable, const char *desc, const char *defaultvalue ) { abort(); }
+
+struct entry_state {
+   address_type pc;
+   unsigned calldepth;
+   simt_mask_t active_mask;
+   address_type recvg_pc;
+   unsigned long long branch_div_cycle;
+   int type;
+
+   bool operator==( const entry_state &e ) const
+   {
+      return pc == e.pc && calldepth == e.calldepth && active_mask == e.active_mask &&
+             recvg_pc == e.recvg_pc && branch_div_cycle == e.branch_div_cycle && type == e.type;
+   }
+   bool operator!=( const entry_state &e ) const { return !(*this == e); }
+};
+
+static entry_state make_state( address_type pc, unsigned calldepth, const simt_mask_t &mask,
+                               address_type recvg_pc, unsigned long long cycle, int type )
+{
+   entry_state e;
+   e.pc = pc;
+   e.calldepth = calldepth;
+   e.active_mask = mask;
+   e.recvg_pc = recvg_pc;
+   e.branch_div_cycle = cycle;
+   e.type = type;
+   return e;
+}
+
+// simt_stack with its entries exposed
+class fast_simt_stack : public simt_stack {
+public:
+   fast_simt_stack( unsigned warp_size ) : simt_stack(0,warp_size) {}
+
+   void get_state( std::vector<entry_state> &out ) const
+   {
+      out.clear();
+      for( unsigned k=0; k < m_depth; k++ ) {
+         const simt_stack_entry &e = m_stack[k];
+         out.push_back(make_state(e.m_pc,e.m_calldepth,e.m_active_mask,e.m_recvg_pc,e.m_branch_div_cycle,e.m_type));
+      }
+   }
+};
+
+// simt_stack as it was before the fast path: every update groups the threads
+// by next PC in a std::map and the stack is a std::deque
+class reference_simt_stack : public simt_stack {
+public:
+   reference_simt_stack( unsigned warp_size ) : simt_stack(0,warp_size) {}
+
+   void launch( address_type start_pc, const simt_mask_t &active_mask )
+   {
+      m_ref_stack.clear();
+      simt_stack_entry new_stack_entry;
+      new_stack_entry.m_pc = start_pc;
+      new_stack_entry.m_calldepth = 1;
+      new_stack_entry.m_active_mask = active_mask;
+      new_stack_entry.m_type = STACK_ENTRY_TYPE_NORMAL;
+      m_ref_stack.push_back(new_stack_entry);
+   }
+
+   void update( simt_mask_t &thread_done, const address_type next_pc[], address_type recvg_pc, 
+                op_type next_inst_op, unsigned next_inst_size, address_type next_inst_pc );
+
+   unsigned depth() const { return m_ref_stack.size(); }
+   entry_state top_state() const
+   {
+      const simt_stack_entry &e = m_ref_stack.back();
+      return make_state(e.m_pc,e.m_calldepth,e.m_active_mask,e.m_recvg_pc,e.m_branch_div_cycle,e.m_type);
+   }
+   void get_state( std::vector<entry_state> &out ) const
+   {
+      out.clear();
+      for( unsigned k=0; k < m_ref_stack.size(); k++ ) {
+         const simt_stack_entry &e = m_ref_stack[k];
+         out.push_back(make_state(e.m_pc,e.m_calldepth,e.m_active_mask,e.m_recvg_pc,e.m_branch_div_cycle,e.m_type));
+      }
+   }
+
+private:
+   std::deque<simt_stack_entry> m_ref_stack;
+};
+
+void reference_simt_stack::update( simt_mask_t &thread_done, const address_type next_pc[], address_type recvg_pc, 
+                                   op_type next_inst_op, unsigned next_inst_size, address_type next_inst_pc )
+{
+    assert(m_ref_stack.size() > 0);
+
+    simt_mask_t  top_active_mask = m_ref_stack.back().m_active_mask;
+    address_type top_recvg_pc = m_ref_stack.back().m_recvg_pc;
+    address_type top_pc = m_ref_stack.back().m_pc; // the pc of the instruction just executed
+    stack_entry_type top_type = m_ref_stack.back().m_type;
+    assert(top_pc==next_inst_pc);
+    assert(top_active_mask.any());
+
+    const address_type null_pc = -1;
+    bool warp_diverged = false;
+    address_type new_recvg_pc = null_pc;
+    unsigned num_divergent_paths=0;
+
+    std::map<address_type,simt_mask_t> divergent_paths;
+    while (top_active_mask.any()) {
+
+        // extract a group of threads with the same next PC among the active threads in the warp
+        address_type tmp_next_pc = null_pc;
+        simt_mask_t tmp_active_mask;
+        for (int i = m_warp_size - 1; i >= 0; i--) {
+            if ( top_active_mask.test(i) ) { // is this thread active?
+                if (thread_done.test(i)) {
+                    top_active_mask.reset(i); // remove completed thread from active mask
+                } else if (tmp_next_pc == null_pc) {
+                    tmp_next_pc = next_pc[i];
+                    tmp_active_mask.set(i);
+                    top_active_mask.reset(i);
+                } else if (tmp_next_pc == next_pc[i]) {
+                    tmp_active_mask.set(i);
+                    top_active_mask.reset(i);
+                }
+            }
+        }
+
+        if(tmp_next_pc == null_pc) {
+            assert(!top_active_mask.any()); // all threads done
+            continue;
+        }
+
+        divergent_paths[tmp_next_pc]=tmp_active_mask;
+        num_divergent_paths++;
+    }
+
+
+    address_type not_taken_pc = next_inst_pc+next_inst_size;
+    assert(num_divergent_paths<=2);
+    for(unsigned i=0; i<num_divergent_paths; i++){
+    	address_type tmp_next_pc = null_pc;
+    	simt_mask_t tmp_active_mask;
+    	tmp_active_mask.reset();
+    	if(divergent_paths.find(not_taken_pc)!=divergent_paths.end()){
+    		assert(i==0);
+    		tmp_next_pc=not_taken_pc;
+    		tmp_active_mask=divergent_paths[tmp_next_pc];
+    		divergent_paths.erase(tmp_next_pc);
+    	}else{
+    		std::map<address_type,simt_mask_t>:: iterator it=divergent_paths.begin();
+    		tmp_next_pc=it->first;
+    		tmp_active_mask=divergent_paths[tmp_next_pc];
+    		divergent_paths.erase(tmp_next_pc);
+    	}
+
+        // HANDLE THE SPECIAL CASES FIRST
+    	if (next_inst_op== CALL_OPS){
+    		// Since call is not a divergent instruction, all threads should have executed a call instruction
+    		assert(num_divergent_paths == 1);
+
+    		simt_stack_entry new_stack_entry;
+    		new_stack_entry.m_pc = tmp_next_pc;
+    		new_stack_entry.m_active_mask = tmp_active_mask;
+    		new_stack_entry.m_branch_div_cycle = gpu_sim_cycle+gpu_tot_sim_cycle;
+    		new_stack_entry.m_type = STACK_ENTRY_TYPE_CALL;
+    		m_ref_stack.push_back(new_stack_entry);
+    		return;
+    	}else if(next_inst_op == RET_OPS && top_type==STACK_ENTRY_TYPE_CALL){
+    		// pop the CALL Entry
+    		assert(num_divergent_paths == 1);
+    		m_ref_stack.pop_back();
+
+    		assert(m_ref_stack.size() > 0);
+    		m_ref_stack.back().m_pc=tmp_next_pc;// set the PC of the stack top entry to return PC from  the call stack;
+            // Check if the New top of the stack is reconverging
+            if (tmp_next_pc == m_ref_stack.back().m_recvg_pc && m_ref_stack.back().m_type!=STACK_ENTRY_TYPE_CALL){
+            	assert(m_ref_stack.back().m_type==STACK_ENTRY_TYPE_NORMAL);
+            	m_ref_stack.pop_back();
+            }
+            return;
+    	}
+
+        // discard the new entry if its PC matches with reconvergence PC
+        // that automatically reconverges the entry
+        // If the top stack entry is CALL, dont reconverge.
+        if (tmp_next_pc == top_recvg_pc && (top_type != STACK_ENTRY_TYPE_CALL)) continue;
+
+        // this new entry is not converging
+        // if this entry does not include thread from the warp, divergence occurs
+        if ((num_divergent_paths>1) && !warp_diverged ) {
+            warp_diverged = true;
+            // modify the existing top entry into a reconvergence entry in the pdom stack
+            new_recvg_pc = recvg_pc;
+            if (new_recvg_pc != top_recvg_pc) {
+                m_ref_stack.back().m_pc = new_recvg_pc;
+                m_ref_stack.back().m_branch_div_cycle = gpu_sim_cycle+gpu_tot_sim_cycle;
+
+                m_ref_stack.push_back(simt_stack_entry());
+            }
+        }
+
+        // discard the new entry if its PC matches with reconvergence PC
+        if (warp_diverged && tmp_next_pc == new_recvg_pc) continue;
+
+        // update the current top of pdom stack
+        m_ref_stack.back().m_pc = tmp_next_pc;
+        m_ref_stack.back().m_active_mask = tmp_active_mask;
+        if (warp_diverged) {
+            m_ref_stack.back().m_calldepth = 0;
+            m_ref_stack.back().m_recvg_pc = new_recvg_pc;
+        } else {
+            m_ref_stack.back().m_recvg_pc = top_recvg_pc;
+        }
+
+        m_ref_stack.push_back(simt_stack_entry());
+    }
+    assert(m_ref_stack.size() > 0);
+    m_ref_stack.pop_back();
+}
+
+// one simt_stack::update call (or a warp launch when launch_mask is non-zero)
+struct stack_update {
+   simt_mask_t launch_mask;
+   simt_mask_t thread_done;
+   address_type next_pc[MAX_WARP_SIZE_SIMT_STACK];
+   address_type recvg_pc;
+   op_type op;
+   address_type pc;
+};
+
+static const unsigned inst_size = 8;
+static const unsigned num_pcs = 16; // small PC space so paths meet their reconvergence points
+
+static address_type random_pc() { return 0x100 + inst_size * (rand() % num_pcs); }
+
+// picks the next instruction for the warp whose stack top is 'top'
+static void make_update( stack_update &u, const entry_state &top, unsigned depth, 
+                         unsigned num_calls, simt_mask_t &done, unsigned warp_size )
+{
+   const address_type null_pc = -1;
+   u.launch_mask.reset();
+   u.pc = top.pc;
+   u.recvg_pc = null_pc;
+   u.op = ALU_OP;
+   for( unsigned t=0; t < MAX_WARP_SIZE_SIMT_STACK; t++ )
+      u.next_pc[t] = null_pc;
+
+   unsigned r = rand() % 100;
+   address_type fallthrough = top.pc + inst_size;
+   if( r < 8 && depth + 2*warp_size + 4 < MAX_SIMT_STACK_DEPTH ) {
+      // call: not divergent, every active thread enters the function
+      u.op = CALL_OPS;
+      address_type target = 0x800 + 0x100 * (rand() % 4);
+      for( unsigned t=0; t < warp_size; t++ )
+         if( top.active_mask.test(t) )
+            u.next_pc[t] = target;
+   } else if( r < 16 && num_calls > 0 && top.type != 0 ) {
+      // return from the function on top of the stack
+      u.op = RET_OPS;
+      address_type ret_pc = (rand() % 2)? random_pc() : fallthrough;
+      for( unsigned t=0; t < warp_size; t++ )
+         if( top.active_mask.test(t) )
+            u.next_pc[t] = ret_pc;
+   } else if( r < 45 ) {
+      // conditional branch, taken by a random subset (possibly none or all)
+      u.op = BRANCH_OP;
+      u.recvg_pc = (rand() % 4)? random_pc() : top.recvg_pc;
+      address_type target = (rand() % 4 || top.recvg_pc == null_pc)? random_pc() : top.recvg_pc;
+      unsigned bias = rand() % 4;
+      for( unsigned t=0; t < warp_size; t++ ) {
+         if( !top.active_mask.test(t) )
+            continue;
+         bool taken = bias == 0? true : bias == 1? false : (rand() % 2);
+         u.next_pc[t] = taken? target : fallthrough;
+      }
+   } else {
+      // straight-line code; now and then the warp walks into its
+      // reconvergence point
+      address_type next = (rand() % 8 == 0 && top.recvg_pc != null_pc)? top.recvg_pc : fallthrough;
+      for( unsigned t=0; t < warp_size; t++ )
+         if( top.active_mask.test(t) )
+            u.next_pc[t] = next;
+   }
+
+   // threads exit; outside of calls since calls are uniform
+   if( u.op != CALL_OPS && u.op != RET_OPS && rand() % 16 == 0 ) {
+      bool all = (rand() % 8 == 0);
+      for( unsigned t=0; t < warp_size; t++ ) {
+         if( top.active_mask.test(t) && (all || rand() % 4 == 0) ) {
+            done.set(t);
+            u.next_pc[t] = null_pc;
+         }
+      }
+   }
+   u.thread_done = done;
+}
+
+static void random_launch( stack_update &u, simt_mask_t &done, unsigned warp_size )
+{
+   u.launch_mask.reset();
+   while( u.launch_mask.none() ) {
+      bool full = rand() % 2;
+      for( unsigned t=0; t < warp_size; t++ )
+         if( full || rand() % 4 )
+            u.launch_mask.set(t);
+   }
+   u.pc = random_pc();
+   done.reset();
+   u.thread_done = done;
+}
+
+static void print_state( const char *name, const std::vector<entry_state> &s, unsigned warp_size )
+{
+   printf("%s:\n", name);
+   for( unsigned k=0; k < s.size(); k++ ) {
+      printf("   %2u ", k);
+      for( unsigned t=0; t < warp_size; t++ )
+         printf("%c", s[k].active_mask.test(t)? '1' : '0');
+      printf(" pc: 0x%03x rp: 0x%03x tp: %s cd: %2u bd@%llu\n", s[k].pc, s[k].recvg_pc,
+             s[k].type? "C" : "N", s[k].calldepth, s[k].branch_div_cycle);
+   }
+}
+
+template<class STACK>
+static void replay( STACK &stack, std::vector<stack_update> &trace )
+{
+   for( unsigned n=0; n < trace.size(); n++ ) {
+      stack_update &u = trace[n];
+      gpu_sim_cycle = n;
+      if( u.launch_mask.any() )
+         stack.launch(u.pc,u.launch_mask);
+      else
+         stack.update(u.thread_done,u.next_pc,u.recvg_pc,u.op,inst_size,u.pc);
+   }
+}
+
+int main( int argc, char **argv )
+{
+   unsigned updates = (argc > 1)? atoi(argv[1]) : 1000000;
+   const unsigned warp_sizes[] = { 32, 8 };
+   srand(1);
+
+   printf("%-5s %9s %9s %9s %9s %12s %12s %8s\n", "warp", "updates", "launches", "uniform",
+          "max_depth", "deque (ns)", "fast (ns)", "speedup");
+   for( unsigned w=0; w < sizeof(warp_sizes)/sizeof(warp_sizes[0]); w++ ) {
+      unsigned warp_size = warp_sizes[w];
+      reference_simt_stack ref(warp_size);
+      fast_simt_stack fast(warp_size);
+      std::vector<stack_update> trace(updates);
+      std::vector<entry_state> ref_state, fast_state;
+      simt_mask_t done;
+      unsigned launches = 0, uniform = 0, max_depth = 0, num_calls = 0;
+
+      for( unsigned n=0; n < updates; n++ ) {
+         stack_update &u = trace[n];
+         gpu_sim_cycle = n;
+         if( ref.depth() == 0 ) {
+            random_launch(u,done,warp_size);
+            ref.launch(u.pc,u.launch_mask);
+            fast.launch(u.pc,u.launch_mask);
+            launches++;
+            num_calls = 0;
+         } else {
+            entry_state top = ref.top_state();
+            make_update(u,top,ref.depth(),num_calls,done,warp_size);
+            std::map<address_type,unsigned> paths;
+            for( unsigned t=0; t < warp_size; t++ )
+               if( top.active_mask.test(t) && !done.test(t) )
+                  paths[u.next_pc[t]]++;
+            if( paths.size() <= 1 ) 
+               uniform++;
+            ref.update(u.thread_done,u.next_pc,u.recvg_pc,u.op,inst_size,u.pc);
+            fast.update(u.thread_done,u.next_pc,u.recvg_pc,u.op,inst_size,u.pc);
+            if( u.op == CALL_OPS ) 
+               num_calls++;
+            else if( u.op == RET_OPS && top.type != 0 ) 
+               num_calls--;
+         }
+         ref.get_state(ref_state);
+         fast.get_state(fast_state);
+         if( ref_state != fast_state ) {
+            printf("MISMATCH: warp_size=%u update=%u op=%d\n", warp_size, n, (int)u.op);
+            print_state("reference",ref_state,warp_size);
+            print_state("fast",fast_state,warp_size);
+            return 1;
+         }
+         if( ref_state.size() > max_depth ) 
+            max_depth = ref_state.size();
+      }
+
+      double ns[2];
+      for( unsigned impl=0; impl < 2; impl++ ) {
+         reference_simt_stack timed_ref(warp_size);
+         fast_simt_stack timed_fast(warp_size);
+         clock_t start = clock();
+         if( impl ) 
+            replay(timed_fast,trace);
+         else 
+            replay(timed_ref,trace);
+         ns[impl] = 1e9 * (double)(clock()-start) / CLOCKS_PER_SEC / updates;
+      }
+      printf("%-5u %9u %9u %9u %9u %12.1f %12.1f %7.2fx\n", warp_size, updates, launches, uniform,
+             max_depth, ns[0], ns[1], ns[0]/ns[1]);
+   }
+   return 0;
+}
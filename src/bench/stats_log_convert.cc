@@ -0,0 +1,212 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Wilson W.L. Fung
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Converts a columnar stats log (-visualizer_columnar_file,
+// -power_trace_columnar_file) back to the text formats and answers range
+// queries on single columns without decoding the rest of the log. This is
+// not part of the simulator build; compile it on its own with
+//
+//    g++ -O2 -I.. -o stats_log_convert stats_log_convert.cc ../gpgpu-sim/stats_log.cc -lz
+//
+//    ./stats_log_convert <log>                  visualizer text log
+//    ./stats_log_convert -csv <component> <log> power (0) or metric (1) trace
+//    ./stats_log_convert -list <log>            column table
+//    ./stats_log_convert -query <metric> <component> <index> <first cycle> <last cycle> <log>
+//
+// For example, the utilization of DRAM partition 3 between two cycles is
+//
+//    ./stats_log_convert -query dramutil 3 1 100000 200000 visualizer.slog
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+#include "../gpgpu-sim/stats_log.h"
+
+typedef std::vector<std::pair<unsigned,long long> > column_values;
+
+static void print_value( const stats_log_column &col, long long v )
+{
+   if( col.scale )
+      printf("%.*f", col.scale, stats_log_reader::to_double(col,v));
+   else
+      printf("%lld", v);
+}
+
+// value of a column in sample s; cursors only move forward
+static bool value_at( const column_values &values, unsigned &cursor, unsigned s, long long &v )
+{
+   while( cursor < values.size() && values[cursor].first < s )
+      cursor++;
+   if( cursor < values.size() && values[cursor].first == s ) {
+      v = values[cursor].second;
+      return true;
+   }
+   return false;
+}
+
+static int print_text( stats_log_reader &log )
+{
+   // the value columns of every line column, in index order, and the line
+   // column of every position column
+   std::vector<std::vector<int> > line_values(log.num_columns());
+   std::vector<int> line_of(log.num_columns(),-1);
+   for( unsigned c=0; c < log.num_columns(); c++ ) {
+      const stats_log_column &col = log.get_column(c);
+      if( col.index == -2 )
+         line_of[c] = log.find(col.metric,col.component,-1);
+      if( col.index != -1 )
+         continue;
+      for( int i=0; ; i++ ) {
+         int v = log.find(col.metric,col.component,i);
+         if( v < 0 )
+            break;
+         line_values[c].push_back(v);
+      }
+   }
+
+   std::vector<unsigned long long> cycles;
+   std::vector<column_values> values;
+   for( unsigned k=0; k < log.num_chunks(); k++ ) {
+      if( !log.read_chunk(k,cycles,values) )
+         return 1;
+      std::vector<unsigned> cursor(log.num_columns(),0);
+      for( unsigned s=0; s < cycles.size(); s++ ) {
+         // {position, line column} of the lines printed in this sample
+         std::vector<std::pair<long long,unsigned> > lines;
+         for( unsigned c=0; c < log.num_columns(); c++ ) {
+            long long pos;
+            if( line_of[c] >= 0 && value_at(values[c],cursor[c],s,pos) )
+               lines.push_back(std::make_pair(pos,(unsigned)line_of[c]));
+         }
+         std::sort(lines.begin(),lines.end());
+         for( unsigned l=0; l < lines.size(); l++ ) {
+            unsigned c = lines[l].second;
+            const stats_log_column &col = log.get_column(c);
+            long long n;
+            if( !value_at(values[c],cursor[c],s,n) )
+               continue;
+            printf("%s:", col.metric.c_str());
+            for( long long i=0; i < n && i < (long long)line_values[c].size(); i++ ) {
+               int vc = line_values[c][i];
+               long long v;
+               printf(" ");
+               if( value_at(values[vc],cursor[vc],s,v) )
+                  print_value(log.get_column(vc),v);
+               else
+                  printf("-"); // not a number (or NaN/infinite) in the text log
+            }
+            printf("\n");
+         }
+      }
+   }
+   return 0;
+}
+
+static int print_csv( stats_log_reader &log, int component )
+{
+   std::vector<unsigned> columns;
+   for( unsigned c=0; c < log.num_columns(); c++ ) {
+      const stats_log_column &col = log.get_column(c);
+      if( col.component == component && col.index == 0 )
+         columns.push_back(c);
+   }
+   for( unsigned i=0; i < columns.size(); i++ )
+      printf("%s%s", i? "," : "", log.get_column(columns[i]).metric.c_str());
+   printf("\n");
+
+   std::vector<unsigned long long> cycles;
+   std::vector<column_values> values;
+   for( unsigned k=0; k < log.num_chunks(); k++ ) {
+      if( !log.read_chunk(k,cycles,values) )
+         return 1;
+      std::vector<unsigned> cursor(log.num_columns(),0);
+      for( unsigned s=0; s < cycles.size(); s++ ) {
+         for( unsigned i=0; i < columns.size(); i++ ) {
+            unsigned c = columns[i];
+            long long v;
+            if( !value_at(values[c],cursor[c],s,v) )
+               v = 0;
+            print_value(log.get_column(c),v);
+            printf(",");
+         }
+         printf("\n");
+      }
+   }
+   return 0;
+}
+
+static int print_columns( stats_log_reader &log )
+{
+   printf("%llu samples in %u chunks\n", log.num_samples(), log.num_chunks());
+   for( unsigned c=0; c < log.num_columns(); c++ ) {
+      const stats_log_column &col = log.get_column(c);
+      printf("%s %d %d%s\n", col.metric.c_str(), col.component, col.index, col.scale? " (fixed point)" : "");
+   }
+   return 0;
+}
+
+static int usage()
+{
+   fprintf(stderr,"usage: stats_log_convert [-csv <component> | -list | -query <metric> <component> <index> <first cycle> <last cycle>] <log>\n");
+   return 1;
+}
+
+int main( int argc, char **argv )
+{
+   if( argc < 2 )
+      return usage();
+   stats_log_reader log(argv[argc-1]);
+   if( !log.is_open() )
+      return 1;
+   if( argc == 2 )
+      return print_text(log);
+   if( !strcmp(argv[1],"-csv") && argc == 4 )
+      return print_csv(log,atoi(argv[2]));
+   if( !strcmp(argv[1],"-list") && argc == 3 )
+      return print_columns(log);
+   if( !strcmp(argv[1],"-query") && argc == 8 ) {
+      int c = log.find(argv[2],atoi(argv[3]),atoi(argv[4]));
+      if( c < 0 ) {
+         fprintf(stderr,"no column %s %s %s\n", argv[2], argv[3], argv[4]);
+         return 1;
+      }
+      std::vector<stats_log_value> values;
+      if( !log.read(c,strtoull(argv[5],NULL,0),strtoull(argv[6],NULL,0),values) )
+         return 1;
+      for( unsigned i=0; i < values.size(); i++ ) {
+         printf("%llu ", values[i].cycle);
+         print_value(log.get_column(c),values[i].value);
+         printf("\n");
+      }
+      return 0;
+   }
+   return usage();
+}
@@ -0,0 +1,155 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Wilson W.L. Fung
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Converts a binary event trace (-trace_event_file) to Chrome trace JSON,
+// which chrome://tracing and ui.perfetto.dev load directly. Every component
+// kind (core, sub_partition, dram_channel) becomes a process and every
+// component a thread, so warp issues and L1 misses of a core share one
+// timeline. Timestamps are simulator cycles shown as microseconds. This is not
+// part of the simulator build; compile it on its own with
+//
+//    g++ -O2 -I.. -o trace_to_chrome trace_to_chrome.cc
+//    ./trace_to_chrome <trace> [<first cycle> <last cycle>] > trace.json
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <set>
+
+#include "../trace.h"
+
+struct event_desc {
+   std::string name;
+   unsigned stream;
+   std::string arg[2];
+   unsigned pid;
+};
+
+static FILE *in;
+
+static unsigned read_u32()
+{
+   unsigned v;
+   if( fread(&v,sizeof(v),1,in) != 1 ) {
+      fprintf(stderr,"trace_to_chrome: truncated header\n");
+      exit(1);
+   }
+   return v;
+}
+
+static std::string read_string()
+{
+   std::string s(read_u32(),'\0');
+   if( !s.empty() && fread(&s[0],1,s.size(),in) != s.size() ) {
+      fprintf(stderr,"trace_to_chrome: truncated header\n");
+      exit(1);
+   }
+   return s;
+}
+
+int main( int argc, char **argv )
+{
+   if( argc != 2 && argc != 4 ) {
+      fprintf(stderr,"usage: trace_to_chrome <trace> [<first cycle> <last cycle>]\n");
+      return 1;
+   }
+   unsigned long long first = 0, last = ~0ULL;
+   if( argc == 4 ) {
+      first = strtoull(argv[2],NULL,0);
+      last = strtoull(argv[3],NULL,0);
+   }
+   in = fopen(argv[1],"rb");
+   if( !in ) {
+      perror(argv[1]);
+      return 1;
+   }
+   char magic[8];
+   if( fread(magic,1,8,in) != 8 || memcmp(magic,"GPUEVTR1",8) ) {
+      fprintf(stderr,"trace_to_chrome: %s is not an event trace\n", argv[1]);
+      return 1;
+   }
+   if( read_u32() != sizeof(Trace::event_record) ) {
+      fprintf(stderr,"trace_to_chrome: record size mismatch\n");
+      return 1;
+   }
+   std::vector<std::string> streams(read_u32());
+   for( unsigned i=0; i < streams.size(); i++ )
+      streams[i] = read_string();
+   std::vector<event_desc> events(read_u32());
+   std::vector<std::string> kinds;
+   for( unsigned i=0; i < events.size(); i++ ) {
+      events[i].name = read_string();
+      events[i].stream = read_u32();
+      std::string kind = read_string();
+      events[i].arg[0] = read_string();
+      events[i].arg[1] = read_string();
+      unsigned pid;
+      for( pid=0; pid < kinds.size() && kinds[pid] != kind; pid++ )
+         ;
+      if( pid == kinds.size() )
+         kinds.push_back(kind);
+      events[i].pid = pid;
+   }
+
+   printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+   for( unsigned pid=0; pid < kinds.size(); pid++ )
+      printf("%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"%s\"}}",
+             pid? ",\n" : "", pid, kinds[pid].c_str());
+   std::set<std::pair<unsigned,unsigned> > threads;
+   std::vector<Trace::event_record> buf(4096);
+   unsigned long long n = 0, skipped = 0;
+   size_t count;
+   while( (count = fread(&buf[0],sizeof(Trace::event_record),buf.size(),in)) > 0 ) {
+      for( size_t i=0; i < count; i++ ) {
+         const Trace::event_record &r = buf[i];
+         if( r.event >= events.size() ) {
+            skipped++;
+            continue;
+         }
+         if( r.cycle < first || r.cycle > last )
+            continue;
+         const event_desc &e = events[r.event];
+         if( threads.insert(std::make_pair(e.pid,r.component)).second )
+            printf(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}",
+                   e.pid, r.component, kinds[e.pid].c_str(), r.component);
+         printf(",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":1,\"pid\":%u,\"tid\":%u,"
+                "\"args\":{\"%s\":\"0x%llx\",\"%s\":\"0x%llx\"}}",
+                e.name.c_str(), streams[e.stream].c_str(), r.cycle, e.pid, r.component,
+                e.arg[0].c_str(), r.arg[0], e.arg[1].c_str(), r.arg[1]);
+         n++;
+      }
+   }
+   printf("\n]}\n");
+   fclose(in);
+   fprintf(stderr,"trace_to_chrome: %llu events", n);
+   if( skipped )
+      fprintf(stderr,", %llu records with unknown event ids skipped", skipped);
+   fprintf(stderr,"\n");
+   return 0;
+}
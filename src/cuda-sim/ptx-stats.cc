@@ -30,12 +30,14 @@
 #include "ptx-stats.h"
 #include "../option_parser.h"
 #include <stdio.h>
+#include <string.h>
 #include <map>
 #include "../tr1_hash_map.h"
 
 // options
 bool enable_ptx_file_line_stats;
 char * ptx_line_stats_filename = NULL;
+char * ptx_line_stall_filename = NULL;
 
 void ptx_file_line_stats_options(option_parser_t opp)
 {
@@ -45,6 +47,9 @@ void ptx_file_line_stats_options(option_parser_t opp)
     option_parser_register(opp, "-ptx_line_stats_filename", OPT_CSTR, 
                            &ptx_line_stats_filename, 
                            "Output file for PTX source line statistics.", "gpgpu_inst_stats.txt");
+    option_parser_register(opp, "-ptx_line_stall_filename", OPT_CSTR, 
+                           &ptx_line_stall_filename, 
+                           "Output file for the sampled stall reasons per PTX source line (see -gpgpu_stall_sample_freq).", "gpgpu_stall_stats.txt");
 }
 
 // implementations
@@ -117,9 +122,76 @@ typedef tr1_hash_map<ptx_file_line, ptx_file_line_stats, hash_ptx_file_line> ptx
 
 static ptx_file_line_stats_map_t ptx_file_line_stats_tracker;
 
+// sampled stall reasons, counted per pc while simulating and mapped to
+// source lines only when written out
+struct ptx_stall_counts
+{
+    ptx_stall_counts() { memset(count, 0, sizeof(count)); }
+    ptx_stall_counts &operator+=(const ptx_stall_counts &other) {
+        for (unsigned r = 0; r < NUM_PTX_STALL_REASONS; r++) 
+            count[r] += other.count[r];
+        return *this;
+    }
+    unsigned long long total() const {
+        unsigned long long t = 0;
+        for (unsigned r = 0; r < NUM_PTX_STALL_REASONS; r++) 
+            t += count[r];
+        return t;
+    }
+
+    unsigned long long count[NUM_PTX_STALL_REASONS];
+};
+
+static const char *ptx_stall_reason_str[NUM_PTX_STALL_REASONS] = {
+    "issued", "not_selected", "barrier", "membar", "inst_fetch", "ibuffer_empty", 
+    "control_hazard", "scoreboard_long", "scoreboard_short", "mem_pipe_full", "exec_unit_busy"
+};
+
+typedef tr1_hash_map<unsigned, ptx_stall_counts> ptx_stall_map_t;
+static ptx_stall_map_t ptx_stall_tracker;
+
+static void ptx_file_line_stall_write_file()
+{
+    if (ptx_stall_tracker.empty()) return;
+
+    // merge the pcs of each line, in source order
+    std::map<ptx_file_line, ptx_stall_counts> lines;
+    ptx_stall_counts total;
+    for (ptx_stall_map_t::const_iterator it = ptx_stall_tracker.begin(); it != ptx_stall_tracker.end(); it++) {
+        const ptx_instruction *pInsn = function_info::pc_to_instruction(it->first);
+        if (pInsn == NULL) continue;
+        lines[ptx_file_line(pInsn->source_file(), pInsn->source_line())] += it->second;
+        total += it->second;
+    }
+
+    FILE * pfile = fopen(ptx_line_stall_filename, "w");
+    if (pfile == NULL) {
+        printf("GPGPU-Sim PTX: WARNING - could not open %s\n", ptx_line_stall_filename);
+        return;
+    }
+    fprintf(pfile, "kernel line : samples");
+    for (unsigned r = 0; r < NUM_PTX_STALL_REASONS; r++) 
+        fprintf(pfile, " %s", ptx_stall_reason_str[r]);
+    fprintf(pfile, "\n");
+    std::map<ptx_file_line, ptx_stall_counts>::const_iterator l;
+    for (l = lines.begin(); l != lines.end(); l++) {
+        fprintf(pfile, "%s %i : %llu", l->first.st.c_str(), l->first.line, l->second.total());
+        for (unsigned r = 0; r < NUM_PTX_STALL_REASONS; r++) 
+            fprintf(pfile, " %llu", l->second.count[r]);
+        fprintf(pfile, "\n");
+    }
+    fprintf(pfile, "total : %llu", total.total());
+    for (unsigned r = 0; r < NUM_PTX_STALL_REASONS; r++) 
+        fprintf(pfile, " %llu", total.count[r]);
+    fprintf(pfile, "\n");
+    fclose(pfile);
+}
+
 // output statistics to a file
 void ptx_file_line_stats_write_file()
 {
+    ptx_file_line_stall_write_file();
+
     // check if stat collection is turned on
     if (enable_ptx_file_line_stats == 0) return;
 
@@ -264,6 +336,12 @@ void ptx_file_line_stats_commit_exposed_latency(int sc_id, int exposed_latency)
     inflight_mem_tracker[sc_id].attribute_exposed_latency(exposed_latency);
 }
 
+// attribute one sampled warp-cycle to the instruction the warp is at (specified by the pc)
+void ptx_file_line_stats_add_stall(unsigned pc, enum ptx_stall_reason reason)
+{
+    ptx_stall_tracker[pc].count[reason] += 1;
+}
+
 // attribute the number of warp divergence to a ptx instruction
 void ptx_file_line_stats_add_warp_divergence(unsigned pc, unsigned n_way_divergence)
 {
@@ -56,3 +56,21 @@ void ptx_file_line_stats_commit_exposed_latency(int sc_id, int exposed_latency);
 
 void ptx_file_line_stats_add_warp_divergence(unsigned pc, unsigned n_way_divergence);
 
+// why a warp did or did not issue in a sampled scheduler cycle, in the order
+// scheduler_unit::cycle() checks them (see scheduler_unit::sample_stalls())
+enum ptx_stall_reason {
+    PTX_STALL_ISSUED = 0,       // issued an instruction
+    PTX_STALL_NOT_SELECTED,     // ready, but the scheduler issued another warp
+    PTX_STALL_BARRIER,          // waiting at bar.sync for the rest of its CTA
+    PTX_STALL_MEMBAR,           // waiting at membar or for outstanding atomics
+    PTX_STALL_INST_FETCH,       // instruction buffer empty, instruction cache miss pending
+    PTX_STALL_IBUFFER_EMPTY,    // instruction buffer empty, fetch/decode has not caught up
+    PTX_STALL_CONTROL_HAZARD,   // instruction buffer holds the wrong path, flushed
+    PTX_STALL_SCOREBOARD_LONG,  // operand pending from a global/local/texture load
+    PTX_STALL_SCOREBOARD_SHORT, // operand pending from any other instruction
+    PTX_STALL_MEM_PIPE_FULL,    // memory instruction, LD/ST pipeline register full
+    PTX_STALL_EXEC_UNIT_BUSY,   // SP/SFU pipeline register full
+    NUM_PTX_STALL_REASONS
+};
+void ptx_file_line_stats_add_stall(unsigned pc, enum ptx_stall_reason reason);
+
@@ -31,6 +31,9 @@
 #include "gpu-sim.h"
 #include "../option_parser.h"
 
+#ifdef ADDRDEC_RUNTIME_PEXT
+#include <immintrin.h>
+#endif
 
 
 static long int powli( long int x, long int y );
@@ -65,6 +68,52 @@ void linear_to_raw_address_translation::addrdec_setoption(option_parser_t opp)
 }
 
 new_addr_type linear_to_raw_address_translation::partition_address( new_addr_type addr ) const 
+{ 
+   if (!gap) {
+      return m_partition.gather(addr); 
+   } else {
+      // see addrdec_tlx for explanation 
+      unsigned long long int partition_addr; 
+      partition_addr = ( (addr>>ADDR_CHIP_S) / m_n_channel) << ADDR_CHIP_S; 
+      partition_addr |= addr & ((1 << ADDR_CHIP_S) - 1); 
+      return m_partition.gather(partition_addr); 
+   }
+}
+
+void linear_to_raw_address_translation::addrdec_tlx(new_addr_type addr, addrdec_t *tlx) const
+{  
+   if (!gap) {
+      tlx->chip = m_field[CHIP].gather(addr);
+   } else {
+      // see addrdec_tlx_reference for explanation 
+      tlx->chip = (addr>>ADDR_CHIP_S) % m_n_channel; 
+      new_addr_type rest_of_addr = ( (addr>>ADDR_CHIP_S) / m_n_channel) << ADDR_CHIP_S; 
+      addr = rest_of_addr | (addr & ((1 << ADDR_CHIP_S) - 1)); 
+   }
+   tlx->bk   = m_field[BK].gather(addr);
+   tlx->row  = m_field[ROW].gather(addr);
+   tlx->col  = m_field[COL].gather(addr);
+   tlx->burst= m_field[BURST].gather(addr);
+   set_sub_partition(tlx);
+}
+
+void linear_to_raw_address_translation::addrdec_tlx(const new_addr_type *addr, addrdec_t *tlx, unsigned n) const
+{
+   if (gap) {
+      for (unsigned i=0; i < n; i++) 
+         addrdec_tlx(addr[i], &tlx[i]);
+      return;
+   }
+   // one field at a time keeps each gather plan in registers across the batch 
+   for (unsigned i=0; i < n; i++) tlx[i].chip  = m_field[CHIP].gather(addr[i]);
+   for (unsigned i=0; i < n; i++) tlx[i].bk    = m_field[BK].gather(addr[i]);
+   for (unsigned i=0; i < n; i++) tlx[i].row   = m_field[ROW].gather(addr[i]);
+   for (unsigned i=0; i < n; i++) tlx[i].col   = m_field[COL].gather(addr[i]);
+   for (unsigned i=0; i < n; i++) tlx[i].burst = m_field[BURST].gather(addr[i]);
+   for (unsigned i=0; i < n; i++) set_sub_partition(&tlx[i]);
+}
+
+new_addr_type linear_to_raw_address_translation::partition_address_reference( new_addr_type addr ) const 
 { 
    if (!gap) {
       return addrdec_packbits( ~(addrdec_mask[CHIP] | sub_partition_id_mask), addr, 64, 0 ); 
@@ -79,7 +128,7 @@ new_addr_type linear_to_raw_address_translation::partition_address( new_addr_typ
    }
 }
 
-void linear_to_raw_address_translation::addrdec_tlx(new_addr_type addr, addrdec_t *tlx) const
+void linear_to_raw_address_translation::addrdec_tlx_reference(new_addr_type addr, addrdec_t *tlx) const
 {  
    unsigned long long int addr_for_chip,rest_of_addr;
    if (!gap) {
@@ -102,11 +151,7 @@ void linear_to_raw_address_translation::addrdec_tlx(new_addr_type addr, addrdec_
       tlx->col  = addrdec_packbits(addrdec_mask[COL], rest_of_addr, addrdec_mkhigh[COL], addrdec_mklow[COL]);
       tlx->burst= addrdec_packbits(addrdec_mask[BURST], rest_of_addr, addrdec_mkhigh[BURST], addrdec_mklow[BURST]);
    }
-
-   // combine the chip address and the lower bits of DRAM bank address to form the subpartition ID
-   unsigned sub_partition_addr_mask = m_n_sub_partition_in_channel - 1; 
-   tlx->sub_partition = tlx->chip * m_n_sub_partition_in_channel
-                        + (tlx->bk & sub_partition_addr_mask); 
+   set_sub_partition(tlx);
 }
 
 void linear_to_raw_address_translation::addrdec_parseoption(const char *option)
@@ -322,6 +367,13 @@ void linear_to_raw_address_translation::init(unsigned int n_channel, unsigned in
    }
    printf("sub_partition_id_mask = %016llx\n", sub_partition_id_mask);
 
+   for (i=0;i<N_ADDRDEC;i++) 
+      m_field[i].compile(addrdec_mask[i]);
+   if (!gap) 
+      m_partition.compile(~(addrdec_mask[CHIP] | sub_partition_id_mask));
+   else 
+      m_partition.compile(~sub_partition_id_mask);
+
    if (run_test) {
       sweep_test(); 
    }
@@ -364,9 +416,27 @@ void linear_to_raw_address_translation::sweep_test() const
 #endif
    history_map_t history_map; 
 
+   const unsigned batch_size = 256; 
+   new_addr_type batch_addr[batch_size]; 
+   addrdec_t batch_tlx[batch_size]; 
+   unsigned batch_pos = batch_size; 
+
    for (new_addr_type raw_addr = 4; raw_addr < sweep_range; raw_addr += 4) {
-      addrdec_t tlx; 
-      addrdec_tlx(raw_addr, &tlx); 
+      if (batch_pos == batch_size) {
+         for (unsigned b = 0; b < batch_size; b++) 
+            batch_addr[b] = raw_addr + 4 * b; 
+         addrdec_tlx(batch_addr, batch_tlx, batch_size); 
+         batch_pos = 0; 
+      }
+      addrdec_t &tlx = batch_tlx[batch_pos++]; 
+
+      // the compiled masks must decode exactly like the bit-by-bit decoder 
+      addrdec_t ref; 
+      addrdec_tlx_reference(raw_addr, &ref); 
+      if (!(ref == tlx) or partition_address(raw_addr) != partition_address_reference(raw_addr)) {
+         printf("[AddrDec] ** Error: compiled address mapping disagrees with the reference decoder at %llx\n", raw_addr); 
+         abort(); 
+      }
 
       history_map_t::iterator h = history_map.find(tlx); 
 
@@ -437,6 +507,42 @@ static new_addr_type addrdec_packbits( new_addr_type mask, new_addr_type val, un
    return result;
 }
 
+void addrdec_bitgather::compile( new_addr_type mask )
+{
+   m_mask = mask;
+   m_n_runs = 0;
+   unsigned dst = 0;
+   unsigned i = 0;
+   while (i < 64) {
+      if ((mask & ((unsigned long long int)1<<i)) == 0) {
+         i++;
+         continue;
+      }
+      unsigned width = 0;
+      while (i + width < 64 and (mask & ((unsigned long long int)1<<(i+width))) != 0) 
+         width++;
+      assert(m_n_runs < 32);
+      run_t &r = m_run[m_n_runs++];
+      r.mask = (width == 64)? ~(new_addr_type)0 : (((new_addr_type)1 << width) - 1);
+      r.src = i;
+      r.dst = dst;
+      dst += width;
+      i += width;
+   }
+   m_use_pext = false;
+#ifdef ADDRDEC_RUNTIME_PEXT
+   m_use_pext = m_n_runs > 1 && __builtin_cpu_supports("bmi2");
+#endif
+}
+
+#ifdef ADDRDEC_RUNTIME_PEXT
+__attribute__((target("bmi2")))
+new_addr_type addrdec_bitgather::pext( new_addr_type addr, new_addr_type mask )
+{
+   return _pext_u64(addr,mask);
+}
+#endif
+
 static void addrdec_getmasklimit(new_addr_type mask, unsigned char *high, unsigned char *low) 
 {
    *high = 64;
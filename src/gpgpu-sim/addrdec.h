@@ -35,6 +35,12 @@
 
 #include "../abstract_hardware_model.h"
 
+// x86-64 GCC can compile a BMI2 function into a generic build and pick it
+// at run time
+#if defined(__x86_64__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define ADDRDEC_RUNTIME_PEXT
+#endif
+
 struct addrdec_t {
    void print( FILE *fp ) const;
     
@@ -47,6 +53,45 @@ struct addrdec_t {
    unsigned sub_partition; 
 };
 
+// Gathers the bits selected by a mask into the low bits of the result, in
+// order (the same as addrdec_packbits). compile() splits the mask into runs of
+// contiguous bits so that each run costs one shift and one and; when the mask
+// has more than one run and the host CPU has BMI2, compile() selects a single
+// PEXT instead.
+class addrdec_bitgather {
+public:
+   addrdec_bitgather() { compile(0); }
+   void compile( new_addr_type mask );
+
+   new_addr_type gather( new_addr_type addr ) const
+   {
+#ifdef ADDRDEC_RUNTIME_PEXT
+      if (m_use_pext) 
+         return pext(addr,m_mask);
+#endif
+      new_addr_type result = 0;
+      for (unsigned r=0; r < m_n_runs; r++) 
+         result |= ((addr >> m_run[r].src) & m_run[r].mask) << m_run[r].dst;
+      return result;
+   }
+
+private:
+   struct run_t {
+      new_addr_type mask; // run width in bits, as a mask
+      unsigned char src;  // lowest bit of the run in the address
+      unsigned char dst;  // position of that bit in the result
+   };
+
+#ifdef ADDRDEC_RUNTIME_PEXT
+   static new_addr_type pext( new_addr_type addr, new_addr_type mask );
+#endif
+
+   new_addr_type m_mask;
+   bool m_use_pext;
+   unsigned m_n_runs;
+   run_t m_run[32]; // a 64-bit mask has at most 32 runs
+};
+
 class linear_to_raw_address_translation {
 public:
    linear_to_raw_address_translation();
@@ -55,11 +100,23 @@ public:
 
    // accessors
    void addrdec_tlx(new_addr_type addr, addrdec_t *tlx) const; 
+   void addrdec_tlx(const new_addr_type *addr, addrdec_t *tlx, unsigned n) const; 
    new_addr_type partition_address( new_addr_type addr ) const;
 
+   // the bit-by-bit decoder the compiled masks are checked against
+   void addrdec_tlx_reference(new_addr_type addr, addrdec_t *tlx) const; 
+   new_addr_type partition_address_reference( new_addr_type addr ) const;
+
 private:
    void addrdec_parseoption(const char *option);
    void sweep_test() const; // sanity check to ensure no overlapping
+   void set_sub_partition( addrdec_t *tlx ) const
+   {
+      // combine the chip address and the lower bits of DRAM bank address to form the subpartition ID
+      unsigned sub_partition_addr_mask = m_n_sub_partition_in_channel - 1; 
+      tlx->sub_partition = tlx->chip * m_n_sub_partition_in_channel
+                           + (tlx->bk & sub_partition_addr_mask); 
+   }
 
    enum {
       CHIP  = 0,
@@ -80,6 +137,10 @@ private:
    new_addr_type addrdec_mask[N_ADDRDEC];
    new_addr_type sub_partition_id_mask; 
 
+   // addrdec_mask[] and the partition address mask compiled by init()
+   addrdec_bitgather m_field[N_ADDRDEC];
+   addrdec_bitgather m_partition;
+
    unsigned int gap;
    int m_n_channel;
    int m_n_sub_partition_in_channel; 
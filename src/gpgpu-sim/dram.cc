@@ -33,6 +33,7 @@
 #include "dram_sched.h"
 #include "mem_fetch.h"
 #include "l2cache.h"
+#include "../trace.h"
 
 #ifdef DRAM_VERIFY
 int PRINT_CYCLE = 0;
@@ -49,10 +50,14 @@ dram_t::dram_t( unsigned int partition_id, const struct memory_config *config, m
    m_stats = stats;
    m_config = config;
 
-   CCDc = 0;
-   RRDc = 0;
-   RTWc = 0;
-   WTRc = 0;
+   m_dram_cycle = 0;
+   m_busy_banks = 0;
+   m_all_idle_cycles = 0;
+   m_activity_until = 0;
+   CCD_ready = 0;
+   RRD_ready = 0;
+   RTW_ready = 0;
+   WTR_ready = 0;
 
    rw = READ; //read mode is default
 
@@ -62,8 +67,8 @@ dram_t::dram_t( unsigned int partition_id, const struct memory_config *config, m
 		bkgrp[i] = bkgrp[0] + i;
 	}
 	for (unsigned i=0; i<m_config->nbkgrp; i++) {
-		bkgrp[i]->CCDLc = 0;
-		bkgrp[i]->RTPLc = 0;
+		bkgrp[i]->CCDL_ready = 0;
+		bkgrp[i]->RTPL_ready = 0;
 	}
 
    bk = (bank_t**) calloc(sizeof(bank_t*),m_config->nbk);
@@ -163,13 +168,29 @@ dram_req_t::dram_req_t( class mem_fetch *mf )
    addr = mf->get_addr();
    insertion_time = (unsigned) gpu_sim_cycle;
    rw = data->get_is_write()?WRITE:READ;
+   bank_prev = bank_next = row_next = NULL;
+}
+
+dram_req_t *dram_t::alloc_req( class mem_fetch *data )
+{
+   if ( m_free_reqs.empty() ) 
+      return new dram_req_t(data);
+   dram_req_t *req = m_free_reqs.back();
+   m_free_reqs.pop_back();
+   *req = dram_req_t(data);
+   return req;
+}
+
+void dram_t::free_req( dram_req_t *req )
+{
+   m_free_reqs.push_back(req);
 }
 
 void dram_t::push( class mem_fetch *data ) 
 {
    assert(id == data->get_tlx_addr().chip); // Ensure request is in correct memory partition
 
-   dram_req_t *mrq = new dram_req_t(data);
+   dram_req_t *mrq = alloc_req(data);
    data->set_status(IN_PARTITION_MC_INTERFACE_QUEUE,gpu_sim_cycle+gpu_tot_sim_cycle);
    mrqq->push(mrq);
 
@@ -194,12 +215,45 @@ void dram_t::scheduler_fifo()
       head_mrqq->data->set_status(IN_PARTITION_MC_BANK_ARB_QUEUE,gpu_sim_cycle+gpu_tot_sim_cycle);
       bkn = head_mrqq->bk;
       if (!bk[bkn]->mrq) 
-         bk[bkn]->mrq = mrqq->pop();
+         bank_assign(bkn,mrqq->pop());
    }
 }
 
+void dram_t::bank_assign( unsigned b, dram_req_t *req )
+{
+   assert(!bk[b]->mrq);
+   bk[b]->mrq = req;
+   m_busy_banks++;
+}
+
+void dram_t::bank_release( unsigned b )
+{
+   bk[b]->mrq = NULL;
+   m_busy_banks--;
+}
+
+unsigned dram_t::bank_idle_cycles( unsigned b ) const
+{
+   // every bank is idle in a cycle that skips the bank loop
+   return bk[b]->n_idle + m_all_idle_cycles;
+}
+
+void dram_t::set_activity_timer( unsigned long long &ready, unsigned delay )
+{
+   ready = m_dram_cycle + delay;
+   if (ready > m_activity_until) 
+      m_activity_until = ready;
+}
+
+unsigned long long dram_t::next_event_cycle() const
+{
+   if (m_busy_banks || que_length() || !mrqq->empty() || rwq->get_length() || returnq->get_length()) 
+      return m_dram_cycle;
+   if (m_activity_until > m_dram_cycle) 
+      return m_activity_until; // idle cycles until then still count towards n_activity
+   return (unsigned long long)-1; // nothing happens until the next push()
+}
 
-#define DEC2ZERO(x) x = (x)? (x-1) : 0;
 #define SWAP(a,b) a ^= b; b ^= a; a ^= b;
 
 void dram_t::cycle()
@@ -222,7 +276,7 @@ void dram_t::cycle()
                  m_memory_partition_unit->set_done(data);
                  delete data;
               }
-              delete cmd;
+              free_req(cmd);
            }
 #ifdef DRAM_VIEWCMD 
            printf("\n");
@@ -255,20 +309,31 @@ void dram_t::cycle()
       ave_mrqs_partial +=  mrqq->get_length();
    }
 
-   unsigned k=m_config->nbk;
+   const unsigned long long now = m_dram_cycle;
+   // the channel is active while a bank is servicing a request or a timing
+   // constraint set through set_activity_timer() is pending
+   bool active = m_busy_banks || now < m_activity_until;
    bool issued = false;
 
+   // with no bank servicing a request there is nothing to issue; the idle
+   // cycle is charged to all banks at once (see bank_idle_cycles())
+   unsigned nbk_loop = m_config->nbk;
+   if (!m_busy_banks) {
+      m_all_idle_cycles++;
+      nbk_loop = 0;
+   }
+
    // check if any bank is ready to issue a new read
-   for (unsigned i=0;i<m_config->nbk;i++) {
+   for (unsigned i=0;i<nbk_loop;i++) {
       unsigned j = (i + prio) % m_config->nbk;
 	  unsigned grp = j>>m_config->bk_tag_length;
       if (bk[j]->mrq) { //if currently servicing a memory request
           bk[j]->mrq->data->set_status(IN_PARTITION_DRAM,gpu_sim_cycle+gpu_tot_sim_cycle);
          // correct row activated for a READ
-         if ( !issued && !CCDc && !bk[j]->RCDc &&
-              !(bkgrp[grp]->CCDLc) &&
+         if ( !issued && now >= CCD_ready && now >= bk[j]->RCD_ready &&
+              now >= bkgrp[grp]->CCDL_ready &&
               (bk[j]->curr_row == bk[j]->mrq->row) && 
-              (bk[j]->mrq->rw == READ) && (WTRc == 0 )  &&
+              (bk[j]->mrq->rw == READ) && now >= WTR_ready &&
               (bk[j]->state == BANK_ACTIVE) &&
               !rwq->full() ) {
             if (rw==WRITE) {
@@ -277,13 +342,14 @@ void dram_t::cycle()
             }
             rwq->push(bk[j]->mrq);
             bk[j]->mrq->txbytes += m_config->dram_atom_size; 
-            CCDc = m_config->tCCD;
-            bkgrp[grp]->CCDLc = m_config->tCCDL;
-            RTWc = m_config->tRTW;
-            bk[j]->RTPc = m_config->BL/m_config->data_command_freq_ratio;
-            bkgrp[grp]->RTPLc = m_config->tRTPL;
+            set_activity_timer(CCD_ready, m_config->tCCD);
+            bkgrp[grp]->CCDL_ready = now + m_config->tCCDL;
+            set_activity_timer(RTW_ready, m_config->tRTW);
+            bk[j]->RTP_ready = now + m_config->BL/m_config->data_command_freq_ratio;
+            bkgrp[grp]->RTPL_ready = now + m_config->tRTPL;
             issued = true;
             n_rd++;
+            TRACE_EVENT(DRAM_RD, id, j, bk[j]->curr_row);
             bwutil += m_config->BL/m_config->data_command_freq_ratio;
             bwutil_partial += m_config->BL/m_config->data_command_freq_ratio;
             bk[j]->n_access++;
@@ -295,14 +361,14 @@ void dram_t::cycle()
 #endif            
             // transfer done
             if ( !(bk[j]->mrq->txbytes < bk[j]->mrq->nbytes) ) {
-               bk[j]->mrq = NULL;
+               bank_release(j);
             }
          } else
             // correct row activated for a WRITE
-            if ( !issued && !CCDc && !bk[j]->RCDWRc &&
-                 !(bkgrp[grp]->CCDLc) &&
+            if ( !issued && now >= CCD_ready && now >= bk[j]->RCDWR_ready &&
+                 now >= bkgrp[grp]->CCDL_ready &&
                  (bk[j]->curr_row == bk[j]->mrq->row)  && 
-                 (bk[j]->mrq->rw == WRITE) && (RTWc == 0 )  &&
+                 (bk[j]->mrq->rw == WRITE) && now >= RTW_ready &&
                  (bk[j]->state == BANK_ACTIVE) &&
                  !rwq->full() ) {
             if (rw==READ) {
@@ -312,12 +378,13 @@ void dram_t::cycle()
             rwq->push(bk[j]->mrq);
 
             bk[j]->mrq->txbytes += m_config->dram_atom_size; 
-            CCDc = m_config->tCCD;
-            bkgrp[grp]->CCDLc = m_config->tCCDL;
-            WTRc = m_config->tWTR; 
-            bk[j]->WTPc = m_config->tWTP; 
+            set_activity_timer(CCD_ready, m_config->tCCD);
+            bkgrp[grp]->CCDL_ready = now + m_config->tCCDL;
+            set_activity_timer(WTR_ready, m_config->tWTR); 
+            bk[j]->WTP_ready = now + m_config->tWTP; 
             issued = true;
             n_wr++;
+            TRACE_EVENT(DRAM_WR, id, j, bk[j]->curr_row);
             bwutil += m_config->BL/m_config->data_command_freq_ratio;
             bwutil_partial += m_config->BL/m_config->data_command_freq_ratio;
 #ifdef DRAM_VERIFY
@@ -328,15 +395,15 @@ void dram_t::cycle()
 #endif  
             // transfer done 
             if ( !(bk[j]->mrq->txbytes < bk[j]->mrq->nbytes) ) {
-               bk[j]->mrq = NULL;
+               bank_release(j);
             }
          }
 
          else
             // bank is idle
-            if ( !issued && !RRDc && 
+            if ( !issued && now >= RRD_ready && 
                  (bk[j]->state == BANK_IDLE) &&
-                 !bk[j]->RPc && !bk[j]->RCc ) {
+                 now >= bk[j]->RP_ready && now >= bk[j]->RC_ready ) {
 #ifdef DRAM_VERIFY
             PRINT_CYCLE=1;
             printf("\tACT BK:%d NewRow:%03x From:%03x \n",
@@ -345,15 +412,16 @@ void dram_t::cycle()
             // activate the row with current memory request 
             bk[j]->curr_row = bk[j]->mrq->row;
             bk[j]->state = BANK_ACTIVE;
-            RRDc = m_config->tRRD;
-            bk[j]->RCDc = m_config->tRCD;
-            bk[j]->RCDWRc = m_config->tRCDWR;
-            bk[j]->RASc = m_config->tRAS;
-            bk[j]->RCc = m_config->tRC;
+            set_activity_timer(RRD_ready, m_config->tRRD);
+            set_activity_timer(bk[j]->RCD_ready, m_config->tRCD);
+            set_activity_timer(bk[j]->RCDWR_ready, m_config->tRCDWR);
+            set_activity_timer(bk[j]->RAS_ready, m_config->tRAS);
+            set_activity_timer(bk[j]->RC_ready, m_config->tRC);
             prio = (j + 1) % m_config->nbk;
             issued = true;
             n_act_partial++;
             n_act++;
+            TRACE_EVENT(DRAM_ACT, id, j, bk[j]->curr_row);
          }
 
          else
@@ -361,15 +429,16 @@ void dram_t::cycle()
             if ( (!issued) && 
                  (bk[j]->curr_row != bk[j]->mrq->row) &&
                  (bk[j]->state == BANK_ACTIVE) && 
-                 (!bk[j]->RASc && !bk[j]->WTPc && 
-				  !bk[j]->RTPc &&
-				  !bkgrp[grp]->RTPLc) ) {
+                 (now >= bk[j]->RAS_ready && now >= bk[j]->WTP_ready && 
+				  now >= bk[j]->RTP_ready &&
+				  now >= bkgrp[grp]->RTPL_ready) ) {
             // make the bank idle again
             bk[j]->state = BANK_IDLE;
-            bk[j]->RPc = m_config->tRP;
+            set_activity_timer(bk[j]->RP_ready, m_config->tRP);
             prio = (j + 1) % m_config->nbk;
             issued = true;
             n_pre++;
+            TRACE_EVENT(DRAM_PRE, id, j, bk[j]->curr_row);
             n_pre_partial++;
 #ifdef DRAM_VERIFY
             PRINT_CYCLE=1;
@@ -377,8 +446,6 @@ void dram_t::cycle()
 #endif
          }
       } else {
-         if (!CCDc && !RRDc && !RTWc && !WTRc && !bk[j]->RCDc && !bk[j]->RASc
-             && !bk[j]->RCc && !bk[j]->RPc  && !bk[j]->RCDWRc) k--;
          bk[j]->n_idle++;
       }
    }
@@ -389,31 +456,14 @@ void dram_t::cycle()
       printf("\tNOP                        ");
 #endif
    }
-   if (k) {
+   if (active) {
       n_activity++;
       n_activity_partial++;
    }
    n_cmd++;
    n_cmd_partial++;
 
-   // decrements counters once for each time dram_issueCMD is called
-   DEC2ZERO(RRDc);
-   DEC2ZERO(CCDc);
-   DEC2ZERO(RTWc);
-   DEC2ZERO(WTRc);
-   for (unsigned j=0;j<m_config->nbk;j++) {
-      DEC2ZERO(bk[j]->RCDc);
-      DEC2ZERO(bk[j]->RASc);
-      DEC2ZERO(bk[j]->RCc);
-      DEC2ZERO(bk[j]->RPc);
-      DEC2ZERO(bk[j]->RCDWRc);
-      DEC2ZERO(bk[j]->WTPc);
-      DEC2ZERO(bk[j]->RTPc);
-   }
-   for (unsigned j=0; j<m_config->nbkgrp; j++) {
-	   DEC2ZERO(bkgrp[j]->CCDLc);
-	   DEC2ZERO(bkgrp[j]->RTPLc);
-   }
+   m_dram_cycle++;
 
 #ifdef DRAM_VISUALIZE
    visualize();
@@ -444,7 +494,7 @@ void dram_t::print( FILE* simFile) const
    fprintf(simFile,"n_activity=%d dram_eff=%.4g\n",
            n_activity, (float)bwutil/n_activity);
    for (i=0;i<m_config->nbk;i++) {
-      fprintf(simFile, "bk%d: %da %di ",i,bk[i]->n_access,bk[i]->n_idle);
+      fprintf(simFile, "bk%d: %da %di ",i,bk[i]->n_access,bank_idle_cycles(i));
    }
    fprintf(simFile, "\n");
    fprintf(simFile, "dram_util_bins:");
@@ -459,12 +509,12 @@ void dram_t::print( FILE* simFile) const
 void dram_t::visualize() const
 {
    printf("RRDc=%d CCDc=%d mrqq.Length=%d rwq.Length=%d\n", 
-          RRDc, CCDc, mrqq->get_length(),rwq->get_length());
+          cycles_left(RRD_ready), cycles_left(CCD_ready), mrqq->get_length(),rwq->get_length());
    for (unsigned i=0;i<m_config->nbk;i++) {
       printf("BK%d: state=%c curr_row=%03x, %2d %2d %2d %2d %p ", 
              i, bk[i]->state, bk[i]->curr_row,
-             bk[i]->RCDc, bk[i]->RASc,
-             bk[i]->RPc, bk[i]->RCc,
+             cycles_left(bk[i]->RCD_ready), cycles_left(bk[i]->RAS_ready),
+             cycles_left(bk[i]->RP_ready), cycles_left(bk[i]->RC_ready),
              bk[i]->mrq );
       if (bk[i]->mrq)
          printf("txf: %d %d", bk[i]->mrq->nbytes, bk[i]->mrq->txbytes);
@@ -31,6 +31,7 @@
 
 #include "delayqueue.h"
 #include <set>
+#include <vector>
 #include <zlib.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -56,23 +57,32 @@ public:
    unsigned long long int addr;
    unsigned int insertion_time;
    class mem_fetch * data;
+
+   // links used by frfcfs_scheduler while the request is pending
+   dram_req_t *bank_prev; // newer request to the same bank
+   dram_req_t *bank_next; // older request to the same bank
+   dram_req_t *row_next;  // newer request to the same row
 };
 
+// Timing constraints are kept as the DRAM cycle at which they expire
+// (a constraint X is satisfied once dram_t::m_dram_cycle >= X_ready)
+// instead of counters decremented every cycle.
+
 struct bankgrp_t
 {
-	unsigned int CCDLc;
-	unsigned int RTPLc;
+	unsigned long long CCDL_ready;
+	unsigned long long RTPL_ready;
 };
 
 struct bank_t
 {
-   unsigned int RCDc;
-   unsigned int RCDWRc;
-   unsigned int RASc;
-   unsigned int RPc;
-   unsigned int RCc;
-   unsigned int WTPc; // write to precharge
-   unsigned int RTPc; // read to precharge
+   unsigned long long RCD_ready;
+   unsigned long long RCDWR_ready;
+   unsigned long long RAS_ready;
+   unsigned long long RP_ready;
+   unsigned long long RC_ready;
+   unsigned long long WTP_ready; // write to precharge
+   unsigned long long RTP_ready; // read to precharge
 
    unsigned char rw;    //is the bank reading or writing?
    unsigned char state; //is the bank active or idle?
@@ -82,14 +92,53 @@ struct bank_t
 
    unsigned int n_access;
    unsigned int n_writes;
-   unsigned int n_idle;
+   unsigned int n_idle; // excludes cycles with all banks idle, see dram_t::bank_idle_cycles()
 
    unsigned int bkgrpindex;
 };
 
 struct mem_fetch;
 
-class dram_t 
+// Interface between memory_partition_unit and the DRAM timing model behind
+// it. The partition pushes requests, calls cycle() once per DRAM clock and
+// drains completed reads/writes from the return queue; dram_t, the GDDR
+// model, is the implementation the simulator builds.
+class dram_device 
+{
+public:
+   virtual ~dram_device() {}
+
+   virtual bool full() const = 0;
+   virtual bool returnq_full() const = 0;
+   virtual unsigned que_length() const = 0;
+   virtual void push( class mem_fetch *data ) = 0;
+   virtual class mem_fetch* return_queue_top() = 0;
+   virtual class mem_fetch* return_queue_pop() = 0;
+   virtual void cycle() = 0;
+   virtual void dram_log( int task ) = 0;
+
+   // Earliest DRAM cycle at which cycle() does more than count an idle cycle,
+   // ~0ULL when nothing can happen before the next push()
+   virtual unsigned long long next_event_cycle() const = 0;
+   virtual unsigned long long get_dram_cycle() const = 0;
+
+   virtual void print( FILE* simFile ) const = 0;
+   virtual void print_stat( FILE* simFile ) = 0;
+   virtual void visualize() const = 0;
+   virtual void visualizer_print( gzFile visualizer_file ) = 0;
+
+   // Power Model
+   virtual void set_dram_power_stats(unsigned &cmd,
+                                     unsigned &activity,
+                                     unsigned &nop,
+                                     unsigned &act,
+                                     unsigned &pre,
+                                     unsigned &rd,
+                                     unsigned &wr,
+                                     unsigned &req) const = 0;
+};
+
+class dram_t : public dram_device
 {
 public:
    dram_t( unsigned int parition_id, const struct memory_config *config, class memory_stats_t *stats, 
@@ -110,6 +159,14 @@ public:
    void cycle();
    void dram_log (int task);
 
+   // Earliest DRAM cycle at which cycle() does more than count an idle cycle.
+   // Returns the current cycle while a request is queued, in a bank or in
+   // flight, the expiry of the last pending timing constraint while idle
+   // cycles still count towards n_activity, and ~0ULL when nothing can
+   // happen before the next push().
+   unsigned long long next_event_cycle() const;
+   unsigned long long get_dram_cycle() const { return m_dram_cycle; }
+
    class memory_partition_unit *m_memory_partition_unit;
    unsigned int id;
 
@@ -127,6 +184,18 @@ private:
    void scheduler_fifo();
    void scheduler_frfcfs();
 
+   // bank request assignment keeps m_busy_banks current
+   void bank_assign( unsigned b, dram_req_t *req );
+   void bank_release( unsigned b );
+   unsigned bank_idle_cycles( unsigned b ) const;
+   void set_activity_timer( unsigned long long &ready, unsigned delay );
+   int cycles_left( unsigned long long ready ) const { return (ready > m_dram_cycle)? (int)(ready - m_dram_cycle) : 0; }
+
+   // dram_req_t objects are recycled instead of new/delete per request
+   dram_req_t *alloc_req( class mem_fetch *data );
+   void free_req( dram_req_t *req );
+   std::vector<dram_req_t*> m_free_reqs;
+
    const struct memory_config *m_config;
 
    bankgrp_t **bkgrp;
@@ -134,10 +203,15 @@ private:
    bank_t **bk;
    unsigned int prio;
 
-   unsigned int RRDc;
-   unsigned int CCDc;
-   unsigned int RTWc;   //read to write penalty applies across banks
-   unsigned int WTRc;   //write to read penalty applies across banks
+   unsigned long long m_dram_cycle; // number of times cycle() has been called
+   unsigned m_busy_banks;           // banks with an mrq
+   unsigned m_all_idle_cycles;      // cycles in which no bank had an mrq (bank loop skipped)
+   unsigned long long m_activity_until; // latest expiry of the timers that count towards n_activity
+
+   unsigned long long RRD_ready;
+   unsigned long long CCD_ready;
+   unsigned long long RTW_ready;   //read to write penalty applies across banks
+   unsigned long long WTR_ready;   //write to read penalty applies across banks
 
    unsigned char rw; //was last request a read or write? (important for RTW, WTR)
 
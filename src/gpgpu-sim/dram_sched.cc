@@ -37,27 +37,105 @@ frfcfs_scheduler::frfcfs_scheduler( const memory_config *config, dram_t *dm, mem
    m_stats = stats;
    m_num_pending = 0;
    m_dram = dm;
-   m_queue = new std::list<dram_req_t*>[m_config->nbk];
-   m_bins = new std::map<unsigned,std::list<std::list<dram_req_t*>::iterator> >[ m_config->nbk ];
-   m_last_row = new std::list<std::list<dram_req_t*>::iterator>*[ m_config->nbk ];
+   m_queue = new bank_queue[m_config->nbk];
    curr_row_service_time = new unsigned[m_config->nbk];
    row_service_timestamp = new unsigned[m_config->nbk];
    for ( unsigned i=0; i < m_config->nbk; i++ ) {
-      m_queue[i].clear();
-      m_bins[i].clear();
-      m_last_row[i] = NULL;
+      m_queue[i].newest = NULL;
+      m_queue[i].oldest = NULL;
+      m_queue[i].size = 0;
+      row_bin empty = { 0, NULL, NULL };
+      m_queue[i].bins.assign(16,empty);
+      m_queue[i].num_bins = 0;
+      m_queue[i].has_last_row = false;
+      m_queue[i].last_row = 0;
       curr_row_service_time[i] = 0;
       row_service_timestamp[i] = 0;
    }
 
 }
 
+unsigned frfcfs_scheduler::bin_hash( const bank_queue &q, unsigned row ) const
+{
+   return (row * 2654435761U) & (q.bins.size()-1);
+}
+
+frfcfs_scheduler::row_bin *frfcfs_scheduler::find_bin( bank_queue &q, unsigned row )
+{
+   unsigned mask = q.bins.size()-1;
+   for ( unsigned i=bin_hash(q,row); q.bins[i].oldest; i=(i+1)&mask ) {
+      if ( q.bins[i].row == row ) 
+         return &q.bins[i];
+   }
+   return NULL;
+}
+
+frfcfs_scheduler::row_bin &frfcfs_scheduler::insert_bin( bank_queue &q, unsigned row )
+{
+   if ( 2*(q.num_bins+1) > q.bins.size() ) {
+      // keep the table at most half full
+      std::vector<row_bin> old_bins;
+      old_bins.swap(q.bins);
+      row_bin empty = { 0, NULL, NULL };
+      q.bins.assign(2*old_bins.size(),empty);
+      q.num_bins = 0;
+      for ( unsigned i=0; i < old_bins.size(); i++ ) {
+         if ( old_bins[i].oldest ) 
+            insert_bin(q,old_bins[i].row) = old_bins[i];
+      }
+   }
+   unsigned mask = q.bins.size()-1;
+   unsigned i=bin_hash(q,row);
+   while ( q.bins[i].oldest ) {
+      assert( q.bins[i].row != row );
+      i=(i+1)&mask;
+   }
+   q.num_bins++;
+   q.bins[i].row = row;
+   return q.bins[i];
+}
+
+void frfcfs_scheduler::erase_bin( bank_queue &q, row_bin *bin )
+{
+   // backward shift deletion: move later entries of the probe sequence into the hole
+   unsigned mask = q.bins.size()-1;
+   unsigned hole = bin - &q.bins[0];
+   for ( unsigned i=(hole+1)&mask; q.bins[i].oldest; i=(i+1)&mask ) {
+      unsigned home = bin_hash(q,q.bins[i].row);
+      if ( ((i-home)&mask) >= ((i-hole)&mask) ) {
+         q.bins[hole] = q.bins[i];
+         hole = i;
+      }
+   }
+   q.bins[hole].oldest = NULL;
+   q.bins[hole].newest = NULL;
+   q.num_bins--;
+}
+
 void frfcfs_scheduler::add_req( dram_req_t *req )
 {
    m_num_pending++;
-   m_queue[req->bk].push_front(req);
-   std::list<dram_req_t*>::iterator ptr = m_queue[req->bk].begin();
-   m_bins[req->bk][req->row].push_front( ptr ); //newest reqs to the front
+   bank_queue &q = m_queue[req->bk];
+
+   // newest reqs to the front
+   req->bank_prev = NULL;
+   req->bank_next = q.newest;
+   if ( q.newest ) 
+      q.newest->bank_prev = req;
+   else 
+      q.oldest = req;
+   q.newest = req;
+   q.size++;
+
+   req->row_next = NULL;
+   row_bin *bin = find_bin(q,req->row);
+   if ( bin ) {
+      bin->newest->row_next = req;
+      bin->newest = req;
+   } else {
+      row_bin &new_bin = insert_bin(q,req->row);
+      new_bin.oldest = new_bin.newest = req;
+   }
 }
 
 void frfcfs_scheduler::data_collection(unsigned int bank)
@@ -78,33 +156,37 @@ void frfcfs_scheduler::data_collection(unsigned int bank)
 
 dram_req_t *frfcfs_scheduler::schedule( unsigned bank, unsigned curr_row )
 {
-   if ( m_last_row[bank] == NULL ) {
-      if ( m_queue[bank].empty() )
+   bank_queue &q = m_queue[bank];
+   if ( !q.has_last_row ) {
+      if ( q.size == 0 )
          return NULL;
 
-      std::map<unsigned,std::list<std::list<dram_req_t*>::iterator> >::iterator bin_ptr = m_bins[bank].find( curr_row );
-      if ( bin_ptr == m_bins[bank].end()) {
-         dram_req_t *req = m_queue[bank].back();
-         bin_ptr = m_bins[bank].find( req->row );
-         assert( bin_ptr != m_bins[bank].end() ); // where did the request go???
-         m_last_row[bank] = &(bin_ptr->second);
+      if ( find_bin(q,curr_row) == NULL ) {
+         // no request to the open row: switch to the row of the oldest request
+         q.last_row = q.oldest->row;
          data_collection(bank);
       } else {
-         m_last_row[bank] = &(bin_ptr->second);
-
+         q.last_row = curr_row;
       }
+      q.has_last_row = true;
    }
-   std::list<dram_req_t*>::iterator next = m_last_row[bank]->back();
-   dram_req_t *req = (*next);
+   row_bin *bin = find_bin(q,q.last_row);
+   assert( bin != NULL ); // where did the request go???
+   dram_req_t *req = bin->oldest;
 
    m_stats->concurrent_row_access[m_dram->id][bank]++;
    m_stats->row_access[m_dram->id][bank]++;
-   m_last_row[bank]->pop_back();
+   bin->oldest = req->row_next;
+
+   if ( req->bank_prev ) req->bank_prev->bank_next = req->bank_next;
+   else q.newest = req->bank_next;
+   if ( req->bank_next ) req->bank_next->bank_prev = req->bank_prev;
+   else q.oldest = req->bank_prev;
+   q.size--;
 
-   m_queue[bank].erase(next);
-   if ( m_last_row[bank]->empty() ) {
-      m_bins[bank].erase( req->row );
-      m_last_row[bank] = NULL;
+   if ( bin->oldest == NULL ) {
+      erase_bin(q,bin);
+      q.has_last_row = false;
    }
 #ifdef DEBUG_FAST_IDEAL_SCHED
    if ( req )
@@ -121,7 +203,7 @@ dram_req_t *frfcfs_scheduler::schedule( unsigned bank, unsigned curr_row )
 void frfcfs_scheduler::print( FILE *fp )
 {
    for ( unsigned b=0; b < m_config->nbk; b++ ) {
-      printf(" %u: queue length = %u\n", b, (unsigned)m_queue[b].size() );
+      printf(" %u: queue length = %u\n", b, m_queue[b].size );
    }
 }
 
@@ -157,7 +239,7 @@ void dram_t::scheduler_frfcfs()
          if ( req ) {
             req->data->set_status(IN_PARTITION_MC_BANK_ARB_QUEUE,gpu_sim_cycle+gpu_tot_sim_cycle);
             prio = (prio+1)%m_config->nbk;
-            bk[b]->mrq = req;
+            bank_assign(b,req);
             if (m_config->gpgpu_memlatency_stat) {
                mrq_latency = gpu_sim_cycle + gpu_tot_sim_cycle - bk[b]->mrq->timestamp;
                bk[b]->mrq->timestamp = gpu_tot_sim_cycle + gpu_sim_cycle;
@@ -32,8 +32,7 @@
 #include "shader.h"
 #include "gpu-sim.h"
 #include "gpu-misc.h"
-#include <list>
-#include <map>
+#include <vector>
 
 class frfcfs_scheduler {
 public:
@@ -45,12 +44,35 @@ public:
    unsigned num_pending() const { return m_num_pending;}
 
 private:
+   // requests to one row of a bank, linked oldest to newest through row_next
+   struct row_bin {
+      unsigned row;
+      dram_req_t *oldest; // NULL if the slot is empty
+      dram_req_t *newest;
+   };
+
+   // Pending requests of one bank: an intrusive list of all requests (newest
+   // first, linked through bank_prev/bank_next) plus an open-addressed table
+   // from row to the bin of requests to that row.
+   struct bank_queue {
+      dram_req_t *newest;
+      dram_req_t *oldest;
+      unsigned size;
+      std::vector<row_bin> bins; // power of two sized, linear probing
+      unsigned num_bins;
+      bool has_last_row; // row currently being drained, see schedule()
+      unsigned last_row;
+   };
+
+   row_bin *find_bin( bank_queue &q, unsigned row );
+   row_bin &insert_bin( bank_queue &q, unsigned row );
+   void erase_bin( bank_queue &q, row_bin *bin );
+   unsigned bin_hash( const bank_queue &q, unsigned row ) const;
+
    const memory_config *m_config;
    dram_t *m_dram;
    unsigned m_num_pending;
-   std::list<dram_req_t*>                                    *m_queue;
-   std::map<unsigned,std::list<std::list<dram_req_t*>::iterator> >    *m_bins;
-   std::list<std::list<dram_req_t*>::iterator>                 **m_last_row;
+   bank_queue *m_queue;
    unsigned *curr_row_service_time; //one set of variables for each bank.
    unsigned *row_service_timestamp; //tracks when scheduler began servicing current row
 
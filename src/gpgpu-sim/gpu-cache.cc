@@ -28,6 +28,9 @@
 #include "gpu-cache.h"
 #include "stat-tool.h"
 #include <assert.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #define MAX_DEFAULT_CACHE_SIZE_MULTIBLIER 4
 // used to allocate memory that is large enough to adapt the changes in cache size across kernels
@@ -113,22 +116,18 @@ unsigned l2_cache_config::set_index(new_addr_type addr) const{
 
 tag_array::~tag_array() 
 {
-    delete[] m_lines;
-}
-
-tag_array::tag_array( cache_config &config,
-                      int core_id,
-                      int type_id,
-                      cache_block_t* new_lines)
-    : m_config( config ),
-      m_lines( new_lines )
-{
-    init( core_id, type_id );
+    delete[] m_tag;
+    delete[] m_block_addr;
+    delete[] m_alloc_time;
+    delete[] m_last_access_time;
+    delete[] m_fill_time;
+    delete[] m_status;
 }
 
 void tag_array::update_cache_parameters(cache_config &config)
 {
 	m_config=config;
+	assert( m_config.get_num_lines() <= m_num_lines_allocated );
 }
 
 tag_array::tag_array( cache_config &config,
@@ -137,7 +136,21 @@ tag_array::tag_array( cache_config &config,
     : m_config( config )
 {
     //assert( m_config.m_write_policy == READ_ONLY ); Old assert
-    m_lines = new cache_block_t[MAX_DEFAULT_CACHE_SIZE_MULTIBLIER*config.get_num_lines()];
+    m_num_lines_allocated = MAX_DEFAULT_CACHE_SIZE_MULTIBLIER*config.get_num_lines();
+    m_tag = new new_addr_type[m_num_lines_allocated];
+    m_block_addr = new new_addr_type[m_num_lines_allocated];
+    m_alloc_time = new unsigned[m_num_lines_allocated];
+    m_last_access_time = new unsigned[m_num_lines_allocated];
+    m_fill_time = new unsigned[m_num_lines_allocated];
+    m_status = new cache_block_state[m_num_lines_allocated];
+    for (unsigned i=0; i < m_num_lines_allocated; i++) {
+        m_tag[i] = INVALID_TAG;
+        m_block_addr[i] = 0;
+        m_alloc_time[i] = 0;
+        m_last_access_time[i] = 0;
+        m_fill_time[i] = 0;
+        m_status[i] = INVALID;
+    }
     init( core_id, type_id );
 }
 
@@ -155,52 +168,98 @@ void tag_array::init( int core_id, int type_id )
     m_type_id = type_id;
 }
 
+cache_block_t tag_array::get_block( unsigned idx ) const
+{
+    cache_block_t block;
+    block.m_tag = m_tag[idx];
+    block.m_block_addr = m_block_addr[idx];
+    block.m_alloc_time = m_alloc_time[idx];
+    block.m_last_access_time = m_last_access_time[idx];
+    block.m_fill_time = m_fill_time[idx];
+    block.m_status = m_status[idx];
+    return block;
+}
+
+void tag_array::allocate( unsigned idx, new_addr_type addr, unsigned time )
+{
+    m_tag[idx] = m_config.tag(addr);
+    m_block_addr[idx] = m_config.block_addr(addr);
+    m_alloc_time[idx] = time;
+    m_last_access_time[idx] = time;
+    m_fill_time[idx] = 0;
+    m_status[idx] = RESERVED;
+}
+
 enum cache_request_status tag_array::probe( new_addr_type addr, unsigned &idx ) const {
     //assert( m_config.m_write_policy == READ_ONLY );
     unsigned set_index = m_config.set_index(addr);
     new_addr_type tag = m_config.tag(addr);
 
+    switch (m_config.m_assoc) {
+    case 2:  return probe_set<2>(set_index,tag,idx);
+    case 4:  return probe_set<4>(set_index,tag,idx);
+    case 8:  return probe_set<8>(set_index,tag,idx);
+    case 16: return probe_set<16>(set_index,tag,idx);
+    default: return probe_set<0>(set_index,tag,idx);
+    }
+}
+
+// Returns the first way in [0,assoc) holding 'tag', or assoc if none does.
+// Tags are compared four at a time with SSE2, two per 128-bit register (a
+// 64-bit compare is two 32-bit compares whose halves must both match).
+static inline unsigned find_tag( const new_addr_type *tags, unsigned assoc, new_addr_type tag )
+{
+    unsigned way = 0;
+#ifdef __SSE2__
+    const __m128i key = _mm_set1_epi64x(tag);
+    for (; way+4 <= assoc; way += 4) {
+        __m128i eq0 = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(tags+way)), key);
+        __m128i eq1 = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(tags+way+2)), key);
+        eq0 = _mm_and_si128(eq0, _mm_shuffle_epi32(eq0, _MM_SHUFFLE(2,3,0,1)));
+        eq1 = _mm_and_si128(eq1, _mm_shuffle_epi32(eq1, _MM_SHUFFLE(2,3,0,1)));
+        int mask = _mm_movemask_pd(_mm_castsi128_pd(eq0)) | (_mm_movemask_pd(_mm_castsi128_pd(eq1)) << 2);
+        if (mask) 
+            return way + __builtin_ctz(mask);
+    }
+#endif
+    for (; way < assoc; way++) {
+        if (tags[way] == tag) 
+            return way;
+    }
+    return assoc;
+}
+
+// ASSOC == 0 reads the associativity from the config. Invalid lines hold
+// INVALID_TAG, which no address maps to, so a hit is a plain tag match.
+template<unsigned ASSOC> 
+enum cache_request_status tag_array::probe_set( unsigned set_index, new_addr_type tag, unsigned &idx ) const
+{
+    const unsigned assoc = ASSOC? ASSOC : m_config.m_assoc;
+    const unsigned base = set_index*assoc;
+    const cache_block_state *status = m_status + base;
+
+    // check for hit or pending hit
+    unsigned hit_way = find_tag(m_tag+base,assoc,tag);
+    if (hit_way < assoc) {
+        idx = base + hit_way;
+        assert( status[hit_way] != INVALID );
+        return (status[hit_way] == RESERVED)? HIT_RESERVED : HIT;
+    }
+
+    // valid line : keep track of most appropriate replacement candidate
+    const unsigned *timestamp = ((m_config.m_replacement_policy == LRU)? m_last_access_time : m_alloc_time) + base;
     unsigned invalid_line = (unsigned)-1;
     unsigned valid_line = (unsigned)-1;
     unsigned valid_timestamp = (unsigned)-1;
-
     bool all_reserved = true;
-
-    // check for hit or pending hit
-    for (unsigned way=0; way<m_config.m_assoc; way++) {
-        unsigned index = set_index*m_config.m_assoc+way;
-        cache_block_t *line = &m_lines[index];
-        if (line->m_tag == tag) {
-            if ( line->m_status == RESERVED ) {
-                idx = index;
-                return HIT_RESERVED;
-            } else if ( line->m_status == VALID ) {
-                idx = index;
-                return HIT;
-            } else if ( line->m_status == MODIFIED ) {
-                idx = index;
-                return HIT;
-            } else {
-                assert( line->m_status == INVALID );
-            }
-        }
-        if (line->m_status != RESERVED) {
+    for (unsigned way=0; way < assoc; way++) {
+        if (status[way] != RESERVED) {
             all_reserved = false;
-            if (line->m_status == INVALID) {
-                invalid_line = index;
-            } else {
-                // valid line : keep track of most appropriate replacement candidate
-                if ( m_config.m_replacement_policy == LRU ) {
-                    if ( line->m_last_access_time < valid_timestamp ) {
-                        valid_timestamp = line->m_last_access_time;
-                        valid_line = index;
-                    }
-                } else if ( m_config.m_replacement_policy == FIFO ) {
-                    if ( line->m_alloc_time < valid_timestamp ) {
-                        valid_timestamp = line->m_alloc_time;
-                        valid_line = index;
-                    }
-                }
+            if (status[way] == INVALID) {
+                invalid_line = base + way;
+            } else if (timestamp[way] < valid_timestamp) {
+                valid_timestamp = timestamp[way];
+                valid_line = base + way;
             }
         }
     }
@@ -236,17 +295,17 @@ enum cache_request_status tag_array::access( new_addr_type addr, unsigned time,
     case HIT_RESERVED: 
         m_pending_hit++;
     case HIT: 
-        m_lines[idx].m_last_access_time=time; 
+        m_last_access_time[idx]=time; 
         break;
     case MISS:
         m_miss++;
         shader_cache_access_log(m_core_id, m_type_id, 1); // log cache misses
         if ( m_config.m_alloc_policy == ON_MISS ) {
-            if( m_lines[idx].m_status == MODIFIED ) {
+            if( m_status[idx] == MODIFIED ) {
                 wb = true;
-                evicted = m_lines[idx];
+                evicted = get_block(idx);
             }
-            m_lines[idx].allocate( m_config.tag(addr), m_config.block_addr(addr), time );
+            allocate( idx, addr, time );
         }
         break;
     case RESERVATION_FAIL:
@@ -267,20 +326,21 @@ void tag_array::fill( new_addr_type addr, unsigned time )
     unsigned idx;
     enum cache_request_status status = probe(addr,idx);
     assert(status==MISS); // MSHR should have prevented redundant memory request
-    m_lines[idx].allocate( m_config.tag(addr), m_config.block_addr(addr), time );
-    m_lines[idx].fill(time);
+    allocate( idx, addr, time );
+    fill( idx, time );
 }
 
 void tag_array::fill( unsigned index, unsigned time ) 
 {
-    assert( m_config.m_alloc_policy == ON_MISS );
-    m_lines[index].fill(time);
+    assert( m_status[index] == RESERVED );
+    m_status[index] = VALID;
+    m_fill_time[index] = time;
 }
 
 void tag_array::flush() 
 {
     for (unsigned i=0; i < m_config.get_num_lines(); i++)
-        m_lines[i].m_status = INVALID;
+        set_status(i,INVALID);
 }
 
 float tag_array::windowed_miss_rate( ) const
@@ -349,64 +409,140 @@ bool was_read_sent( const std::list<cache_event> &events )
 }
 /****************************************************************** MSHR ******************************************************************/
 
+const unsigned mshr_table::NO_ENTRY;
+
+mshr_table::mshr_table( unsigned num_entries, unsigned max_merged )
+    : m_num_entries(num_entries),
+    m_max_merged(max_merged),
+    m_entries(num_entries),
+    m_merged(num_entries*max_merged,(mem_fetch*)NULL),
+    m_free_entries(num_entries),
+    m_num_free(num_entries),
+    m_ready(num_entries),
+    m_ready_head(0),
+    m_num_ready(0)
+{
+    unsigned num_slots = 1;
+    while ( num_slots < 2*num_entries ) 
+        num_slots <<= 1;
+    m_slots.resize(num_slots,NO_ENTRY);
+    m_slot_mask = num_slots-1;
+    for ( unsigned e=0; e < num_entries; e++ ) 
+        m_free_entries[e] = num_entries-1-e;
+}
+
+unsigned mshr_table::hash( new_addr_type block_addr ) const
+{
+    // block addresses are line aligned: mix the upper bits down before masking
+    unsigned long long h = block_addr * 0x9E3779B97F4A7C15ULL;
+    return (unsigned)(h >> 32) & m_slot_mask;
+}
+
+/// Returns the slot holding block_addr, or NO_ENTRY
+unsigned mshr_table::find_slot( new_addr_type block_addr ) const
+{
+    for ( unsigned slot=hash(block_addr); m_slots[slot] != NO_ENTRY; slot=(slot+1)&m_slot_mask ) {
+        if ( m_entries[m_slots[slot]].m_block_addr == block_addr ) 
+            return slot;
+    }
+    return NO_ENTRY;
+}
+
+/// Frees the entry in 'slot' and closes the gap it leaves in its probe sequence
+void mshr_table::release( unsigned slot )
+{
+    m_free_entries[m_num_free++] = m_slots[slot];
+    unsigned hole = slot;
+    for ( unsigned next=(slot+1)&m_slot_mask; m_slots[next] != NO_ENTRY; next=(next+1)&m_slot_mask ) {
+        unsigned home = hash(m_entries[m_slots[next]].m_block_addr);
+        // move the entry back if its home slot is not in (hole,next]
+        if ( ((next-home)&m_slot_mask) >= ((next-hole)&m_slot_mask) ) {
+            m_slots[hole] = m_slots[next];
+            hole = next;
+        }
+    }
+    m_slots[hole] = NO_ENTRY;
+}
+
 /// Checks if there is a pending request to the lower memory level already
 bool mshr_table::probe( new_addr_type block_addr ) const{
-    table::const_iterator a = m_data.find(block_addr);
-    return a != m_data.end();
+    return find_slot(block_addr) != NO_ENTRY;
 }
 
 /// Checks if there is space for tracking a new memory access
 bool mshr_table::full( new_addr_type block_addr ) const{
-    table::const_iterator i=m_data.find(block_addr);
-    if ( i != m_data.end() )
-        return i->second.m_list.size() >= m_max_merged;
+    unsigned slot = find_slot(block_addr);
+    if ( slot != NO_ENTRY )
+        return m_entries[m_slots[slot]].m_count >= m_max_merged;
     else
-        return m_data.size() >= m_num_entries;
+        return m_num_free == 0;
 }
 
 /// Add or merge this access
 void mshr_table::add( new_addr_type block_addr, mem_fetch *mf ){
-	m_data[block_addr].m_list.push_back(mf);
-	assert( m_data.size() <= m_num_entries );
-	assert( m_data[block_addr].m_list.size() <= m_max_merged );
+    unsigned slot = hash(block_addr);
+    while ( m_slots[slot] != NO_ENTRY && m_entries[m_slots[slot]].m_block_addr != block_addr ) 
+        slot = (slot+1)&m_slot_mask;
+    if ( m_slots[slot] == NO_ENTRY ) {
+        assert( m_num_free > 0 );
+        unsigned e = m_free_entries[--m_num_free];
+        m_entries[e].m_block_addr = block_addr;
+        m_entries[e].m_first = 0;
+        m_entries[e].m_count = 0;
+        m_entries[e].m_has_atomic = false;
+        m_slots[slot] = e;
+    }
+    unsigned e = m_slots[slot];
+    mshr_entry &entry = m_entries[e];
+    assert( entry.m_count < m_max_merged );
+    m_merged[e*m_max_merged + (entry.m_first+entry.m_count)%m_max_merged] = mf;
+    entry.m_count++;
 	// indicate that this MSHR entry contains an atomic operation
 	if ( mf->isatomic() ) {
-		m_data[block_addr].m_has_atomic = true;
+		entry.m_has_atomic = true;
 	}
 }
 
 /// Accept a new cache fill response: mark entry ready for processing
 void mshr_table::mark_ready( new_addr_type block_addr, bool &has_atomic ){
     assert( !busy() );
-    table::iterator a = m_data.find(block_addr);
-    assert( a != m_data.end() ); // don't remove same request twice
-    m_current_response.push_back( block_addr );
-    has_atomic = a->second.m_has_atomic;
-    assert( m_current_response.size() <= m_data.size() );
+    unsigned slot = find_slot(block_addr);
+    assert( slot != NO_ENTRY ); // don't remove same request twice
+    assert( m_num_ready < m_num_entries - m_num_free );
+    m_ready[(m_ready_head+m_num_ready)%m_num_entries] = m_slots[slot];
+    m_num_ready++;
+    has_atomic = m_entries[m_slots[slot]].m_has_atomic;
 }
 
 /// Returns next ready access
 mem_fetch *mshr_table::next_access(){
     assert( access_ready() );
-    new_addr_type block_addr = m_current_response.front();
-    assert( !m_data[block_addr].m_list.empty() );
-    mem_fetch *result = m_data[block_addr].m_list.front();
-    m_data[block_addr].m_list.pop_front();
-    if ( m_data[block_addr].m_list.empty() ) {
+    unsigned e = m_ready[m_ready_head];
+    mshr_entry &entry = m_entries[e];
+    assert( entry.m_count > 0 );
+    mem_fetch *result = m_merged[e*m_max_merged + entry.m_first];
+    entry.m_first = (entry.m_first+1)%m_max_merged;
+    entry.m_count--;
+    if ( entry.m_count == 0 ) {
         // release entry
-        m_data.erase(block_addr);
-        m_current_response.pop_front();
+        release(find_slot(entry.m_block_addr));
+        m_ready_head = (m_ready_head+1)%m_num_entries;
+        m_num_ready--;
     }
     return result;
 }
 
 void mshr_table::display( FILE *fp ) const{
     fprintf(fp,"MSHR contents\n");
-    for ( table::const_iterator e=m_data.begin(); e!=m_data.end(); ++e ) {
-        unsigned block_addr = e->first;
-        fprintf(fp,"MSHR: tag=0x%06x, atomic=%d %zu entries : ", block_addr, e->second.m_has_atomic, e->second.m_list.size());
-        if ( !e->second.m_list.empty() ) {
-            mem_fetch *mf = e->second.m_list.front();
+    for ( unsigned slot=0; slot < m_slots.size(); slot++ ) {
+        if ( m_slots[slot] == NO_ENTRY ) 
+            continue;
+        unsigned e = m_slots[slot];
+        const mshr_entry &entry = m_entries[e];
+        unsigned block_addr = entry.m_block_addr;
+        fprintf(fp,"MSHR: tag=0x%06x, atomic=%d %u entries : ", block_addr, entry.m_has_atomic, entry.m_count);
+        if ( entry.m_count ) {
+            mem_fetch *mf = m_merged[e*m_max_merged + entry.m_first];
             fprintf(fp,"%p :",mf);
             mf->print(fp);
         } else {
@@ -710,8 +846,7 @@ void baseline_cache::fill(mem_fetch *mf, unsigned time){
     m_mshrs.mark_ready(e->second.m_block_addr, has_atomic);
     if (has_atomic) {
         assert(m_config.m_alloc_policy == ON_MISS);
-        cache_block_t &block = m_tag_array->get_block(e->second.m_cache_index);
-        block.m_status = MODIFIED; // mark line as dirty for atomic operation
+        m_tag_array->set_status(e->second.m_cache_index, MODIFIED); // mark line as dirty for atomic operation
     }
     m_extra_mf_fields.erase(mf);
     m_bandwidth_management.use_fill_port(mf); 
@@ -789,8 +924,7 @@ void data_cache::send_write_request(mem_fetch *mf, cache_event request, unsigned
 cache_request_status data_cache::wr_hit_wb(new_addr_type addr, unsigned cache_index, mem_fetch *mf, unsigned time, std::list<cache_event> &events, enum cache_request_status status ){
 	new_addr_type block_addr = m_config.block_addr(addr);
 	m_tag_array->access(block_addr,time,cache_index); // update LRU state
-	cache_block_t &block = m_tag_array->get_block(cache_index);
-	block.m_status = MODIFIED;
+	m_tag_array->set_status(cache_index, MODIFIED);
 
 	return HIT;
 }
@@ -802,8 +936,7 @@ cache_request_status data_cache::wr_hit_wt(new_addr_type addr, unsigned cache_in
 
 	new_addr_type block_addr = m_config.block_addr(addr);
 	m_tag_array->access(block_addr,time,cache_index); // update LRU state
-	cache_block_t &block = m_tag_array->get_block(cache_index);
-	block.m_status = MODIFIED;
+	m_tag_array->set_status(cache_index, MODIFIED);
 
 	// generate a write-through
 	send_write_request(mf, WRITE_REQUEST_SENT, time, events);
@@ -817,11 +950,10 @@ cache_request_status data_cache::wr_hit_we(new_addr_type addr, unsigned cache_in
 		return RESERVATION_FAIL; // cannot handle request this cycle
 
 	// generate a write-through/evict
-	cache_block_t &block = m_tag_array->get_block(cache_index);
 	send_write_request(mf, WRITE_REQUEST_SENT, time, events);
 
 	// Invalidate block
-	block.m_status = INVALID;
+	m_tag_array->set_status(cache_index, INVALID);
 
 	return HIT;
 }
@@ -936,8 +1068,7 @@ data_cache::rd_hit_base( new_addr_type addr,
     // MODIFIED
     if(mf->isatomic()){ 
         assert(mf->get_access_type() == GLOBAL_ACC_R);
-        cache_block_t &block = m_tag_array->get_block(cache_index);
-        block.m_status = MODIFIED;  // mark line as dirty
+        m_tag_array->set_status(cache_index, MODIFIED);  // mark line as dirty
     }
     return HIT;
 }
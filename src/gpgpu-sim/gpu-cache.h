@@ -60,6 +60,8 @@ enum cache_event {
 
 const char * cache_request_status_str(enum cache_request_status status); 
 
+// snapshot of one line of a tag_array (the tag array itself is stored as
+// separate per-field arrays, see tag_array)
 struct cache_block_t {
     cache_block_t()
     {
@@ -70,21 +72,6 @@ struct cache_block_t {
         m_last_access_time=0;
         m_status=INVALID;
     }
-    void allocate( new_addr_type tag, new_addr_type block_addr, unsigned time )
-    {
-        m_tag=tag;
-        m_block_addr=block_addr;
-        m_alloc_time=time;
-        m_last_access_time=time;
-        m_fill_time=0;
-        m_status=RESERVED;
-    }
-    void fill( unsigned time )
-    {
-        assert( m_status == RESERVED );
-        m_status=VALID;
-        m_fill_time=time;
-    }
 
     new_addr_type    m_tag;
     new_addr_type    m_block_addr;
@@ -334,6 +321,12 @@ private:
 	linear_to_raw_address_translation *m_address_mapping;
 };
 
+// Tags are kept as a structure of arrays: the tags, states and timestamps of
+// the ways of a set are contiguous, so a lookup compares the tags of a set
+// several at a time without touching the rest of the line state. probe()
+// dispatches to a version of the set lookup specialized for the common
+// associativities; the replacement policy only selects which timestamp array
+// is searched for a victim.
 class tag_array {
 public:
     // Use this constructor
@@ -348,7 +341,14 @@ public:
     void fill( unsigned idx, unsigned time );
 
     unsigned size() const { return m_config.get_num_lines();}
-    cache_block_t &get_block(unsigned idx) { return m_lines[idx];}
+    cache_block_t get_block(unsigned idx) const;
+    cache_block_state get_status(unsigned idx) const { return m_status[idx]; }
+    void set_status(unsigned idx, cache_block_state status) 
+    { 
+        m_status[idx] = status; 
+        if (status == INVALID) 
+            m_tag[idx] = INVALID_TAG; 
+    }
 
     void flush(); // flash invalidate all entries
     void new_window();
@@ -359,20 +359,26 @@ public:
 
 	void update_cache_parameters(cache_config &config);
 protected:
-    // This constructor is intended for use only from derived classes that wish to
-    // avoid unnecessary memory allocation that takes place in the
-    // other tag_array constructor
-    tag_array( cache_config &config,
-               int core_id,
-               int type_id,
-               cache_block_t* new_lines );
+    // tags are line addresses, so an all-ones tag never matches a lookup
+    static const new_addr_type INVALID_TAG = ~0ULL;
+
     void init( int core_id, int type_id );
+    void allocate( unsigned idx, new_addr_type addr, unsigned time );
+    template<unsigned ASSOC> 
+    enum cache_request_status probe_set( unsigned set_index, new_addr_type tag, unsigned &idx ) const;
 
 protected:
 
     cache_config &m_config;
 
-    cache_block_t *m_lines; /* nbanks x nset x assoc lines in total */
+    /* nbanks x nset x assoc lines in total, one array per field */
+    unsigned m_num_lines_allocated;
+    new_addr_type     *m_tag;
+    new_addr_type     *m_block_addr;
+    unsigned          *m_alloc_time;
+    unsigned          *m_last_access_time;
+    unsigned          *m_fill_time;
+    cache_block_state *m_status;
 
     unsigned m_access;
     unsigned m_miss;
@@ -390,14 +396,7 @@ protected:
 
 class mshr_table {
 public:
-    mshr_table( unsigned num_entries, unsigned max_merged )
-    : m_num_entries(num_entries),
-    m_max_merged(max_merged)
-#if (tr1_hash_map_ismap == 0)
-    ,m_data(2*num_entries)
-#endif
-    {
-    }
+    mshr_table( unsigned num_entries, unsigned max_merged );
 
     /// Checks if there is a pending request to the lower memory level already
     bool probe( new_addr_type block_addr ) const;
@@ -410,7 +409,7 @@ public:
     /// Accept a new cache fill response: mark entry ready for processing
     void mark_ready( new_addr_type block_addr, bool &has_atomic );
     /// Returns true if ready accesses exist
-    bool access_ready() const {return !m_current_response.empty();}
+    bool access_ready() const {return m_num_ready != 0;}
     /// Returns next ready access
     mem_fetch *next_access();
     void display( FILE *fp ) const;
@@ -422,22 +421,37 @@ public:
     }
 
 private:
+    static const unsigned NO_ENTRY = (unsigned)-1;
+
+    unsigned hash( new_addr_type block_addr ) const;
+    unsigned find_slot( new_addr_type block_addr ) const;
+    void release( unsigned slot );
 
     // finite sized, fully associative table, with a finite maximum number of merged requests
     const unsigned m_num_entries;
     const unsigned m_max_merged;
 
+    // All storage is sized by the constructor. Entries live in a fixed pool;
+    // the hash table is open addressed with linear probing over at least twice
+    // as many slots as entries, each slot holding an entry index.
     struct mshr_entry {
-        std::list<mem_fetch*> m_list;
+        new_addr_type m_block_addr;
+        unsigned m_first;   // merged requests form a ring of m_max_merged slots
+        unsigned m_count;
         bool m_has_atomic; 
-        mshr_entry() : m_has_atomic(false) { }
     }; 
-    typedef tr1_hash_map<new_addr_type,mshr_entry> table;
-    table m_data;
-
-    // it may take several cycles to process the merged requests
-    bool m_current_response_ready;
-    std::list<new_addr_type> m_current_response;
+    std::vector<mshr_entry> m_entries;
+    std::vector<mem_fetch*> m_merged;     // m_num_entries x m_max_merged
+    std::vector<unsigned> m_free_entries; // stack of unused entry indices
+    unsigned m_num_free;
+    std::vector<unsigned> m_slots;        // entry index or NO_ENTRY
+    unsigned m_slot_mask;
+
+    // entries whose fill has arrived, in arrival order (ring buffer); it may
+    // take several cycles to process the merged requests
+    std::vector<unsigned> m_ready;
+    unsigned m_ready_head;
+    unsigned m_num_ready;
 };
 
 
@@ -592,6 +606,16 @@ public:
     bool access_ready() const {return m_mshrs.access_ready();}
     /// Pop next ready access (does not include accesses that "HIT")
     mem_fetch *next_access(){return m_mshrs.next_access();}
+    /// True if cycle() has nothing to do until a fill arrives: no queued misses,
+    /// no ready accesses and both ports free
+    bool idle() const
+    {
+        return m_miss_queue.empty() && !access_ready()
+               && m_bandwidth_management.data_port_free()
+               && m_bandwidth_management.fill_port_free();
+    }
+    /// Account for a cycle() on an idle cache without running it
+    void idle_cycle() { m_stats.sample_cache_port_utility(false, false); }
     // flash invalidate all entries in cache
     void flush(){m_tag_array->flush();}
     void print(FILE *fp, unsigned &accesses, unsigned &misses) const;
@@ -1013,6 +1037,11 @@ public:
     bool access_ready() const{return !m_result_fifo.empty();}
     /// Pop next ready access (includes both accesses that "HIT" and those that "MISS")
     mem_fetch *next_access(){return m_result_fifo.pop();}
+    /// True if no request is queued, in flight or waiting to be read out
+    bool idle() const
+    {
+        return m_request_fifo.empty() && m_fragment_fifo.empty() && m_result_fifo.empty();
+    }
     void display_state( FILE *fp ) const;
 
     // accessors for cache bandwidth availability - stubs for now 
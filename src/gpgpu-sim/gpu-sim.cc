@@ -60,6 +60,9 @@
 #include "mem_latency_stat.h"
 #include "power_stat.h"
 #include "visualizer.h"
+#include "mem_trace.h"
+#include "host_prof.h"
+#include "stats_registry.h"
 #include "stats.h"
 
 #ifdef GPGPUSIM_POWER_MODEL
@@ -110,6 +113,10 @@ void power_config::reg_options(class OptionParser * opp)
 			  	  	  	  	 &g_power_config_name,"GPUWattch XML file",
 	                   "gpuwattch.xml");
 
+	  option_parser_register(opp, "-power_model_cache", OPT_CSTR,
+	                         &g_power_model_cache, "File caching the CACTI array solutions of the power model between runs (default=off)",
+	                         NULL);
+
 	   option_parser_register(opp, "-power_simulation_enabled", OPT_BOOL,
 	                          &g_power_simulation_enabled, "Turn on power simulator (1=On, 0=Off)",
 	                          "0");
@@ -118,6 +125,10 @@ void power_config::reg_options(class OptionParser * opp)
 	                          &g_power_per_cycle_dump, "Dump detailed power output each cycle",
 	                          "0");
 
+	   option_parser_register(opp, "-power_async_eval", OPT_BOOL,
+	                          &g_power_async_eval, "Evaluate the power model of each sample on a separate thread while simulation continues (1=On, 0=Off)",
+	                          "0");
+
 	   // Output Data Formats
 	   option_parser_register(opp, "-power_trace_enabled", OPT_BOOL,
 	                          &g_power_trace_enabled, "produce a file for the power trace (1=On, 0=Off)",
@@ -127,6 +138,10 @@ void power_config::reg_options(class OptionParser * opp)
 	                          &g_power_trace_zlevel, "Compression level of the power trace output log (0=no comp, 9=highest)",
 	                          "6");
 
+	   option_parser_register(opp, "-power_trace_columnar_file", OPT_CSTR,
+	                          &g_power_columnar_trace_filename, "Also write the power and metric traces to this columnar stats log (default=off)",
+	                          NULL);
+
 	   option_parser_register(opp, "-steady_power_levels_enabled", OPT_BOOL,
 	                          &g_steady_power_levels_enabled, "produce a file for the steady power levels (1=On, 0=Off)",
 	                          "0");
@@ -347,6 +362,12 @@ void shader_core_config::reg_options(class OptionParser * opp)
     option_parser_register(opp, "-gpgpu_simt_core_sim_order", OPT_INT32, &simt_core_sim_order,
                             "Select the simulation order of cores in a cluster (0=Fix, 1=Round-Robin)",
                             "1");
+    option_parser_register(opp, "-gpgpu_shader_core_sleep", OPT_BOOL, &gpgpu_shader_core_sleep,
+                            "Skip the pipeline of shader cores that cannot make progress until a memory response or new CTA arrives (0=off, 1=on)",
+                            "0");
+    option_parser_register(opp, "-gpgpu_stall_sample_freq", OPT_UINT32, &gpgpu_stall_sample_freq,
+                            "Sample why each warp does or does not issue every <n> core cycles, per PTX source line (0 = off, see -ptx_line_stall_filename)",
+                            "0");
     option_parser_register(opp, "-gpgpu_pipeline_widths", OPT_CSTR, &pipeline_widths_string,
                             "Pipeline widths "
                             "ID_OC_SP,ID_OC_SFU,ID_OC_MEM,OC_EX_SP,OC_EX_SFU,OC_EX_MEM,EX_WB",
@@ -389,6 +410,18 @@ void gpgpu_sim_config::reg_options(option_parser_t opp)
    option_parser_register(opp, "-liveness_message_freq", OPT_INT64, &liveness_message_freq, 
                "Minimum number of seconds between simulation liveness messages (0 = always print)",
                "1");
+   option_parser_register(opp, "-gpgpu_host_prof_sample", OPT_UINT32, &gpgpu_host_prof_sample, 
+               "Profile the simulator's host time per phase, timing one in <n> cycles on average (0 = off)",
+               "0");
+   option_parser_register(opp, "-gpgpu_stats_jsonl_file", OPT_CSTR, &gpgpu_stats_jsonl_filename, 
+               "Export the statistics of each kernel to this file as JSON Lines (default = off)",
+               NULL);
+   option_parser_register(opp, "-gpgpu_stats_csv_file", OPT_CSTR, &gpgpu_stats_csv_filename, 
+               "Export the statistics of each kernel to this file as CSV (default = off)",
+               NULL);
+   option_parser_register(opp, "-gpgpu_stats_sample_freq", OPT_UINT32, &gpgpu_stats_sample_freq, 
+               "Also export the statistics every <n> cycles of a kernel (0 = at the end of each kernel only)",
+               "0");
    option_parser_register(opp, "-gpgpu_flush_l1_cache", OPT_BOOL, &gpgpu_flush_l1_cache,
                 "Flush L1 cache at the end of each kernel call",
                 "0");
@@ -423,6 +456,15 @@ void gpgpu_sim_config::reg_options(option_parser_t opp)
    option_parser_register(opp, "-visualizer_zlevel", OPT_INT32,
                           &g_visualizer_zlevel, "Compression level of the visualizer output log (0=no comp, 9=highest)",
                           "6");
+   option_parser_register(opp, "-visualizer_columnar_file", OPT_CSTR,
+                          &g_visualizer_columnar_filename, "Also write the visualizer samples to this columnar stats log (default = off)",
+                          NULL);
+   option_parser_register(opp, "-gpgpu_mem_trace_file", OPT_CSTR,
+                          &g_mem_trace_filename, "Binary trace of memory requests and replies crossing the interconnect (default = off)",
+                          NULL);
+   option_parser_register(opp, "-gpgpu_mem_trace_zlevel", OPT_INT32,
+                          &g_mem_trace_zlevel, "Compression level of the memory trace blocks (0=no comp, 9=highest)",
+                          "1");
     option_parser_register(opp, "-trace_enabled", OPT_BOOL, 
                           &Trace::enabled, "Turn on traces",
                           "0");
@@ -437,6 +479,18 @@ void gpgpu_sim_config::reg_options(option_parser_t opp)
     option_parser_register(opp, "-trace_sampling_memory_partition", OPT_INT32, 
                           &Trace::sampling_memory_partition, "The memory partition which is printed using MEMPART_DPRINTF. Default -1 (i.e. all)",
                           "-1");
+    option_parser_register(opp, "-trace_event_file", OPT_CSTR, 
+                          &Trace::event_file, "Binary event trace of the streams selected by -trace_components "
+                          "(convert with trace_to_chrome). Default off",
+                          NULL);
+    option_parser_register(opp, "-trace_event_buffer", OPT_INT32, 
+                          &Trace::event_buffer_size, "Records per thread in the event trace ring buffer; "
+                          "events are dropped when it is full. Default 65536",
+                          "65536");
+    option_parser_register(opp, "-trace_event_sampling", OPT_CSTR, 
+                          &Trace::event_sampling_str, "Record events only in the first <on> cycles of "
+                          "every <period> cycles, <on>:<period>. Default 0:0 (always)",
+                          "0:0");
    ptx_file_line_stats_options(opp);
 }
 
@@ -552,7 +606,7 @@ gpgpu_sim::gpgpu_sim( const gpgpu_sim_config &config )
     ptx_file_line_stats_create_exposed_latency_tracker(m_config.num_shader());
 
 #ifdef GPGPUSIM_POWER_MODEL
-        m_gpgpusim_wrapper = new gpgpu_sim_wrapper(config.g_power_simulation_enabled,config.g_power_config_name);
+        m_gpgpusim_wrapper = new gpgpu_sim_wrapper(config.g_power_simulation_enabled,config.g_power_config_name,config.g_power_model_cache);
 #endif
 
     m_shader_stats = new shader_core_stats(m_shader_config);
@@ -566,6 +620,10 @@ gpgpu_sim::gpgpu_sim( const gpgpu_sim_config &config )
     gpu_tot_issued_cta = 0;
     gpu_deadlock = false;
 
+    m_visualizer = NULL;
+    m_mem_trace = NULL;
+    if (m_config.g_mem_trace_filename)
+        m_mem_trace = new mem_trace_writer(m_config.g_mem_trace_filename, m_config.g_mem_trace_zlevel);
 
     m_cluster = new simt_core_cluster*[m_shader_config->n_simt_clusters];
     for (unsigned i=0;i<m_shader_config->n_simt_clusters;i++) 
@@ -585,6 +643,11 @@ gpgpu_sim::gpgpu_sim( const gpgpu_sim_config &config )
     icnt_create(m_shader_config->n_simt_clusters,m_memory_config->m_n_mem_sub_partition);
 
     time_vector_create(NUM_MEM_REQ_STAT);
+
+    m_stats_registry = new stats_registry();
+    register_stats();
+    m_stats_registry->open(m_config.gpgpu_stats_jsonl_filename, m_config.gpgpu_stats_csv_filename);
+
     fprintf(stdout, "GPGPU-Sim uArch: performance model initialization complete.\n");
 
     m_running_kernels.resize( config.max_concurrent_kernel, NULL );
@@ -685,6 +748,7 @@ void gpgpu_sim::init()
     gpu_sim_insn = 0;
     last_gpu_sim_insn = 0;
     m_total_cta_launched=0;
+    g_host_prof.kernel_start(m_config.gpgpu_host_prof_sample);
 
     reinit_clock_domains();
     set_param_gpgpu_num_shaders(m_config.num_shader());
@@ -725,7 +789,16 @@ void gpgpu_sim::update_stats() {
 void gpgpu_sim::print_stats()
 {
     ptx_file_line_stats_write_file();
+    write_stats_record("kernel");
+    m_stats_registry->flush();
     gpu_print_stat();
+    g_host_prof.print(stdout, gpu_sim_cycle, gpu_sim_insn);
+
+    if (m_mem_trace)
+        m_mem_trace->flush();
+    if (m_visualizer)
+        m_visualizer->flush();
+    Trace::events_flush();
 
     if (g_network_mode) {
         printf("----------------------------Interconnect-DETAILS--------------------------------\n" );
@@ -879,6 +952,46 @@ void gpgpu_sim::clear_executed_kernel_info()
    m_executed_kernel_names.clear();
    m_executed_kernel_uids.clear();
 }
+// values of gpu_print_stat() that are not a single counter
+static void gpu_totals( const void *obj, unsigned instance, double *values )
+{
+   const gpgpu_sim *gpu = (const gpgpu_sim*)obj;
+   values[0] = gpu_tot_sim_cycle + gpu_sim_cycle;
+   values[1] = gpu->gpu_tot_sim_insn + gpu->gpu_sim_insn;
+}
+
+static void gpu_rates( const void *obj, unsigned instance, double *values )
+{
+   const gpgpu_sim *gpu = (const gpgpu_sim*)obj;
+   values[0] = (float)gpu->gpu_sim_insn / gpu_sim_cycle;
+   values[1] = (float)(gpu->gpu_tot_sim_insn + gpu->gpu_sim_insn) / (gpu_tot_sim_cycle + gpu_sim_cycle);
+}
+
+void gpgpu_sim::register_stats()
+{
+   static const char *totals_str[] = { "tot_sim_cycle", "tot_sim_insn" };
+   static const char *rates_str[] = { "ipc", "tot_ipc" };
+   m_stats_registry->add("gpu", -1, "sim_cycle", &gpu_sim_cycle);
+   m_stats_registry->add("gpu", -1, "sim_insn", &gpu_sim_insn);
+   m_stats_registry->add_group("gpu", -1, totals_str, 2, true, &gpu_totals, this);
+   m_stats_registry->add_group("gpu", -1, rates_str, 2, false, &gpu_rates, this);
+   m_stats_registry->add("gpu", -1, "tot_issued_cta", &gpu_tot_issued_cta);
+   m_stats_registry->add("gpu", -1, "stall_dramfull", &gpu_stall_dramfull);
+   m_stats_registry->add("gpu", -1, "stall_icnt2sh", &gpu_stall_icnt2sh);
+
+   m_shader_stats->register_stats(*m_stats_registry);
+   for (unsigned i=0;i<m_shader_config->n_simt_clusters;i++) 
+      m_cluster[i]->register_stats(*m_stats_registry);
+   m_memory_stats->register_stats(*m_stats_registry);
+   for (unsigned i=0;i<m_memory_config->m_n_mem;i++)
+      m_memory_partition_unit[i]->register_stats(*m_stats_registry);
+}
+
+void gpgpu_sim::write_stats_record( const char *record )
+{
+   m_stats_registry->write(record, gpu_tot_sim_cycle + gpu_sim_cycle, m_executed_kernel_names, m_executed_kernel_uids);
+}
+
 void gpgpu_sim::gpu_print_stat() 
 {  
    FILE *statfout = stdout; 
@@ -920,6 +1033,7 @@ void gpgpu_sim::gpu_print_stat()
    m_shader_stats->print(stdout);
 #ifdef GPGPUSIM_POWER_MODEL
    if(m_config.g_power_simulation_enabled){
+	   mcpat_flush();
 	   m_gpgpusim_wrapper->print_power_kernel_stats(gpu_sim_cycle, gpu_tot_sim_cycle, gpu_tot_sim_insn + gpu_sim_insn, kernel_info_str, true );
 	   mcpat_reset_perf_count(m_gpgpusim_wrapper);
    }
@@ -1050,6 +1164,7 @@ void shader_core_ctx::mem_instruction_stats(const warp_inst_t &inst)
 
 void shader_core_ctx::issue_block2core( kernel_info_t &kernel ) 
 {
+    wake();
     set_max_cta(kernel);
 
     // find a free CTA context 
@@ -1154,17 +1269,44 @@ void gpgpu_sim::issue_block2core()
 
 unsigned long long g_single_step=0; // set this in gdb to single step the pipeline
 
+// Pull the DRAM, L2 and L1/interconnect counters GPUWattch reads into
+// m_power_stats. These only change inside the owning component's cycle
+// function, so reading them once per power sample gives the same values the
+// per-cycle copies used to.
+void gpgpu_sim::collect_power_stats()
+{
+   power_mem_stat_t *pwr_mem_stat = m_power_stats->pwr_mem_stat;
+   for (unsigned i=0;i<m_memory_config->m_n_mem;i++) {
+      m_memory_partition_unit[i]->set_dram_power_stats(pwr_mem_stat->n_cmd[CURRENT_STAT_IDX][i], pwr_mem_stat->n_activity[CURRENT_STAT_IDX][i],
+                     pwr_mem_stat->n_nop[CURRENT_STAT_IDX][i], pwr_mem_stat->n_act[CURRENT_STAT_IDX][i], pwr_mem_stat->n_pre[CURRENT_STAT_IDX][i],
+                     pwr_mem_stat->n_rd[CURRENT_STAT_IDX][i], pwr_mem_stat->n_wr[CURRENT_STAT_IDX][i], pwr_mem_stat->n_req[CURRENT_STAT_IDX][i]);
+   }
+   pwr_mem_stat->l2_cache_stats[CURRENT_STAT_IDX].clear();
+   for (unsigned i=0;i<m_memory_config->m_n_mem_sub_partition;i++)
+      m_memory_sub_partition[i]->accumulate_L2cache_stats(pwr_mem_stat->l2_cache_stats[CURRENT_STAT_IDX]);
+   pwr_mem_stat->core_cache_stats[CURRENT_STAT_IDX].clear();
+   for (unsigned i=0;i<m_shader_config->n_simt_clusters;i++) {
+      m_cluster[i]->get_icnt_stats(pwr_mem_stat->n_simt_to_mem[CURRENT_STAT_IDX][i], pwr_mem_stat->n_mem_to_simt[CURRENT_STAT_IDX][i]);
+      m_cluster[i]->get_cache_stats(pwr_mem_stat->core_cache_stats[CURRENT_STAT_IDX]);
+   }
+}
+
 void gpgpu_sim::cycle()
 {
+   g_host_prof.begin_cycle();
+   HOST_PROF_SCOPE(CYCLE);
    int clock_mask = next_clock_domain();
+   Trace::events_cycle(gpu_sim_cycle+gpu_tot_sim_cycle);
 
    if (clock_mask & CORE ) {
        // shader core loading (pop from ICNT into core) follows CORE clock
+      HOST_PROF_SCOPE(ICNT_TO_CORE);
       for (unsigned i=0;i<m_shader_config->n_simt_clusters;i++) 
          m_cluster[i]->icnt_cycle(); 
    }
     if (clock_mask & ICNT) {
         // pop from memory controller to interconnect
+        HOST_PROF_SCOPE(MEM_TO_ICNT);
         for (unsigned i=0;i<m_memory_config->m_n_mem_sub_partition;i++) {
             mem_fetch* mf = m_memory_sub_partition[i]->top();
             if (mf) {
@@ -1173,6 +1315,8 @@ void gpgpu_sim::cycle()
                     if (!mf->get_is_write()) 
                        mf->set_return_timestamp(gpu_sim_cycle+gpu_tot_sim_cycle);
                     mf->set_status(IN_ICNT_TO_SHADER,gpu_sim_cycle+gpu_tot_sim_cycle);
+                    if (m_mem_trace)
+                       m_mem_trace->record(MEM_TRACE_REPLY_INJECT, mf, gpu_sim_cycle+gpu_tot_sim_cycle);
                     ::icnt_push( m_shader_config->mem2device(i), mf->get_tpc(), mf, response_size );
                     m_memory_sub_partition[i]->pop();
                 } else {
@@ -1185,18 +1329,15 @@ void gpgpu_sim::cycle()
     }
 
    if (clock_mask & DRAM) {
+      HOST_PROF_SCOPE(DRAM);
       for (unsigned i=0;i<m_memory_config->m_n_mem;i++){
          m_memory_partition_unit[i]->dram_cycle(); // Issue the dram command (scheduler + delay model)
-         // Update performance counters for DRAM
-         m_memory_partition_unit[i]->set_dram_power_stats(m_power_stats->pwr_mem_stat->n_cmd[CURRENT_STAT_IDX][i], m_power_stats->pwr_mem_stat->n_activity[CURRENT_STAT_IDX][i],
-                        m_power_stats->pwr_mem_stat->n_nop[CURRENT_STAT_IDX][i], m_power_stats->pwr_mem_stat->n_act[CURRENT_STAT_IDX][i], m_power_stats->pwr_mem_stat->n_pre[CURRENT_STAT_IDX][i],
-                        m_power_stats->pwr_mem_stat->n_rd[CURRENT_STAT_IDX][i], m_power_stats->pwr_mem_stat->n_wr[CURRENT_STAT_IDX][i], m_power_stats->pwr_mem_stat->n_req[CURRENT_STAT_IDX][i]);
       }
    }
 
    // L2 operations follow L2 clock domain
    if (clock_mask & L2) {
-       m_power_stats->pwr_mem_stat->l2_cache_stats[CURRENT_STAT_IDX].clear();
+      HOST_PROF_SCOPE(L2);
       for (unsigned i=0;i<m_memory_config->m_n_mem_sub_partition;i++) {
           //move memory request from interconnect into memory partition (if not backed up)
           //Note:This needs to be called in DRAM clock domain if there is no L2 cache in the system
@@ -1205,27 +1346,28 @@ void gpgpu_sim::cycle()
           } else {
               mem_fetch* mf = (mem_fetch*) icnt_pop( m_shader_config->mem2device(i) );
               m_memory_sub_partition[i]->push( mf, gpu_sim_cycle + gpu_tot_sim_cycle );
+              if (mf && m_mem_trace)
+                  m_mem_trace->record(MEM_TRACE_REQ_ARRIVE, mf, gpu_sim_cycle + gpu_tot_sim_cycle);
           }
           m_memory_sub_partition[i]->cache_cycle(gpu_sim_cycle+gpu_tot_sim_cycle);
-          m_memory_sub_partition[i]->accumulate_L2cache_stats(m_power_stats->pwr_mem_stat->l2_cache_stats[CURRENT_STAT_IDX]);
        }
    }
 
    if (clock_mask & ICNT) {
+      HOST_PROF_SCOPE(ICNT);
       icnt_transfer();
    }
 
    if (clock_mask & CORE) {
       // L1 cache + shader core pipeline stages
-      m_power_stats->pwr_mem_stat->core_cache_stats[CURRENT_STAT_IDX].clear();
-      for (unsigned i=0;i<m_shader_config->n_simt_clusters;i++) {
-         if (m_cluster[i]->get_not_completed() || get_more_cta_left() ) {
-               m_cluster[i]->core_cycle();
-               *active_sms+=m_cluster[i]->get_n_active_sms();
+      {
+         HOST_PROF_SCOPE(CORE);
+         for (unsigned i=0;i<m_shader_config->n_simt_clusters;i++) {
+            if (m_cluster[i]->get_not_completed() || get_more_cta_left() ) {
+                  m_cluster[i]->core_cycle();
+                  *active_sms+=m_cluster[i]->get_n_active_sms();
+            }
          }
-         // Update core icnt/cache stats for GPUWattch
-         m_cluster[i]->get_icnt_stats(m_power_stats->pwr_mem_stat->n_simt_to_mem[CURRENT_STAT_IDX][i], m_power_stats->pwr_mem_stat->n_mem_to_simt[CURRENT_STAT_IDX][i]);
-         m_cluster[i]->get_cache_stats(m_power_stats->pwr_mem_stat->core_cache_stats[CURRENT_STAT_IDX]);
       }
       float temp=0;
       for (unsigned i=0;i<m_shader_config->num_shader();i++){
@@ -1246,6 +1388,9 @@ void gpgpu_sim::cycle()
       // McPAT main cycle (interface with McPAT)
 #ifdef GPGPUSIM_POWER_MODEL
       if(m_config.g_power_simulation_enabled){
+          HOST_PROF_SCOPE(POWER);
+          if( (gpu_tot_sim_cycle+gpu_sim_cycle) % m_config.gpu_stat_sample_freq == 0 )
+             collect_power_stats();
           mcpat_cycle(m_config, getShaderCoreConfig(), m_gpgpusim_wrapper, m_power_stats, m_config.gpu_stat_sample_freq, gpu_tot_sim_cycle, gpu_sim_cycle, gpu_tot_sim_insn, gpu_sim_insn);
       }
 #endif
@@ -1287,6 +1432,7 @@ void gpgpu_sim::cycle()
       }
 
       if (!(gpu_sim_cycle % m_config.gpu_stat_sample_freq)) {
+         HOST_PROF_SCOPE(STATS);
          time_t days, hrs, minutes, sec;
          time_t curr_time;
          time(&curr_time);
@@ -1323,6 +1469,11 @@ void gpgpu_sim::cycle()
          }
       }
 
+      if (m_config.gpgpu_stats_sample_freq && !(gpu_sim_cycle % m_config.gpgpu_stats_sample_freq)) {
+         HOST_PROF_SCOPE(STATS);
+         write_stats_record("sample");
+      }
+
       if (!(gpu_sim_cycle % 20000)) {
          // deadlock detection 
          if (m_config.gpu_deadlock_detect && gpu_sim_insn == last_gpu_sim_insn) {
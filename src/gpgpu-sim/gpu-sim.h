@@ -117,18 +117,21 @@ struct power_config {
 	void reg_options(class OptionParser * opp);
 
 	char *g_power_config_name;
+	char *g_power_model_cache;
 
 	bool m_valid;
     bool g_power_simulation_enabled;
     bool g_power_trace_enabled;
     bool g_steady_power_levels_enabled;
     bool g_power_per_cycle_dump;
+    bool g_power_async_eval;
     bool g_power_simulator_debug;
     char *g_power_filename;
     char *g_power_trace_filename;
     char *g_metric_trace_filename;
     char * g_steady_state_tracking_filename;
     int g_power_trace_zlevel;
+    char *g_power_columnar_trace_filename;
     char * gpu_steady_state_definition;
     double gpu_steady_power_deviation;
     double gpu_steady_min_period;
@@ -315,6 +318,14 @@ public:
     unsigned num_cluster() const { return m_shader_config.n_simt_clusters; }
     unsigned get_max_concurrent_kernel() const { return max_concurrent_kernel; }
 
+    // for drivers that run part of the timing model without a gpgpu_sim
+    const shader_core_config *get_shader_config() const { return &m_shader_config; }
+    const memory_config *get_memory_config() const { return &m_memory_config; }
+    double get_core_period() const { return core_period; }
+    double get_icnt_period() const { return icnt_period; }
+    double get_l2_period() const { return l2_period; }
+    double get_dram_period() const { return dram_period; }
+
 private:
     void init_clock_domains(void ); 
 
@@ -349,6 +360,11 @@ private:
     bool  g_visualizer_enabled;
     char *g_visualizer_filename;
     int   g_visualizer_zlevel;
+    char *g_visualizer_columnar_filename; // columnar copy of the visualizer log (off when NULL)
+
+    // binary interconnect memory trace (off when NULL)
+    char *g_mem_trace_filename;
+    int   g_mem_trace_zlevel;
 
 
     // statistics collection
@@ -358,6 +374,12 @@ private:
 
 
     unsigned long long liveness_message_freq; 
+    unsigned gpgpu_host_prof_sample; // host profiler sampling period (0 = off)
+
+    // structured statistics export (off when both files are NULL)
+    char *gpgpu_stats_jsonl_filename;
+    char *gpgpu_stats_csv_filename;
+    unsigned gpgpu_stats_sample_freq; // cycles between sample records (0 = per kernel only)
 
     friend class gpgpu_sim;
 };
@@ -394,6 +416,7 @@ public:
    kernel_info_t *select_kernel();
 
    const gpgpu_sim_config &get_config() const { return m_config; }
+   class mem_trace_writer *get_mem_trace() { return m_mem_trace; }
    void gpu_print_stat();
    void dump_pipeline( int mask, int s, int m ) const;
 
@@ -432,6 +455,7 @@ private:
    void shader_print_scheduler_stat( FILE* fout, bool print_dynamic_info ) const;
    void visualizer_printstat();
    void print_shader_cycle_distro( FILE *fout ) const;
+   void collect_power_stats();
 
    void gpgpu_debug();
 
@@ -470,6 +494,9 @@ private:
    class memory_stats_t     *m_memory_stats;
    class power_stat_t *m_power_stats;
    class gpgpu_sim_wrapper *m_gpgpusim_wrapper;
+   class mem_trace_writer *m_mem_trace;
+   class visualizer_writer *m_visualizer;
+   class stats_registry *m_stats_registry;
    unsigned long long  gpu_tot_issued_cta;
    unsigned long long  last_gpu_sim_insn;
 
@@ -481,6 +508,8 @@ private:
    std::vector<unsigned> m_executed_kernel_uids; //< uids of kernel launches for stat printout
    std::string executed_kernel_info_string(); //< format the kernel information into a string for stat printout
    void clear_executed_kernel_info(); //< clear the kernel information after stat printout
+   void register_stats(); //< register the statistics of all components with m_stats_registry
+   void write_stats_record( const char *record ); //< export the registered statistics as one record
 
 public:
    unsigned long long  gpu_sim_insn;
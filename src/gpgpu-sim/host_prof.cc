@@ -0,0 +1,105 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Wilson W.L. Fung
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "host_prof.h"
+
+#include <string.h>
+#include <ctype.h>
+#include <string>
+
+struct host_prof_phase_info {
+   const char *name;
+   unsigned depth;
+};
+
+#define HP_TUP_BEGIN(X) static const host_prof_phase_info host_prof_phases[] = {
+#define HP_TUP(P,DEPTH) { #P, DEPTH },
+#define HP_TUP_END(X) };
+#include "host_prof_phases.tup"
+#undef HP_TUP_BEGIN
+#undef HP_TUP
+#undef HP_TUP_END
+
+host_profiler g_host_prof;
+
+host_profiler::host_profiler()
+{
+   m_rand = 0x9e3779b97f4a7c15ULL;
+   kernel_start(0);
+}
+
+void host_profiler::kernel_start( unsigned period )
+{
+   m_period = period;
+   m_sampling = false;
+   m_calls = 0;
+   m_sampled_calls = 0;
+   m_next_sample = period? next_interval() : 0;
+   memset(m_ticks,0,sizeof(m_ticks));
+   m_start_ticks = host_prof_ticks();
+   m_start_wall = wall_seconds();
+}
+
+// uniform in [1, 2*period-1], so the mean interval is period
+unsigned long long host_profiler::next_interval()
+{
+   if( m_period <= 1 )
+      return 1;
+   m_rand ^= m_rand << 13;
+   m_rand ^= m_rand >> 7;
+   m_rand ^= m_rand << 17;
+   return 1 + m_rand % (2ULL*m_period - 1);
+}
+
+double host_profiler::wall_seconds()
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC,&ts);
+   return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+void host_profiler::print( FILE *fout, unsigned long long cycles, unsigned long long insn ) const
+{
+   if( !m_period )
+      return;
+   double wall = wall_seconds() - m_start_wall;
+   fprintf(fout, "host_prof_kernel_time = %.3f (sec)\n", wall);
+   fprintf(fout, "host_prof_sampled_cycle_calls = %llu of %llu\n", m_sampled_calls, m_calls);
+   if( !m_sampled_calls || wall <= 0 )
+      return;
+   double ticks_per_sec = (host_prof_ticks() - m_start_ticks) / wall;
+   double scale = (double)m_calls / m_sampled_calls / ticks_per_sec;
+   fprintf(fout, "host_prof %-20s %10s %7s %14s %14s\n", "phase", "time(sec)", "share", "cycle/sec", "inst/sec");
+   for( unsigned p=0; p < NUM_HOST_PROF_PHASES; p++ ) {
+      std::string name(2*host_prof_phases[p].depth,' ');
+      for( const char *c=host_prof_phases[p].name; *c; c++ )
+         name += tolower(*c);
+      double t = m_ticks[p] * scale;
+      fprintf(fout, "host_prof %-20s %10.3f %6.1f%% %14.0f %14.0f\n", name.c_str(), t, 100.0*t/wall,
+              t > 0? cycles/t : 0.0, t > 0? insn/t : 0.0);
+   }
+}
@@ -0,0 +1,124 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Wilson W.L. Fung
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef HOST_PROF_H
+#define HOST_PROF_H
+
+#include <stdio.h>
+#include <time.h>
+
+// Sampled profile of where the simulator itself spends host time. On
+// average one gpgpu_sim::cycle() call in -gpgpu_host_prof_sample is timed
+// with the time stamp counter, phase by phase. The sampled times are scaled
+// to the number of cycle() calls and reported by print_stats for each
+// kernel. The sampling interval is randomized so that it does not lock on
+// to the pattern of the clock domains.
+//
+// A phase is timed with HOST_PROF_SCOPE(<phase>) in the block that
+// implements it. Phases nest; a phase's time includes the phases that
+// are listed below it in host_prof_phases.tup and run inside it.
+
+#define HP_TUP_BEGIN(X) enum X {
+#define HP_TUP(P,DEPTH) HP_##P,
+#define HP_TUP_END(X) NUM_HOST_PROF_PHASES };
+#include "host_prof_phases.tup"
+#undef HP_TUP_BEGIN
+#undef HP_TUP
+#undef HP_TUP_END
+
+static inline unsigned long long host_prof_ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+   unsigned lo, hi;
+   __asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi));
+   return ((unsigned long long)hi << 32) | lo;
+#else
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC,&ts);
+   return ts.tv_sec*1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+class host_profiler {
+public:
+   host_profiler();
+
+   // resets the counters; period 0 disables sampling
+   void kernel_start( unsigned period );
+
+   // called at the start of every gpgpu_sim::cycle()
+   void begin_cycle()
+   {
+      m_sampling = false;
+      if( m_period && ++m_calls == m_next_sample ) {
+         m_sampling = true;
+         m_sampled_calls++;
+         m_next_sample = m_calls + next_interval();
+      }
+   }
+   bool sampling() const { return m_sampling; }
+   void add( enum host_prof_phase_t phase, unsigned long long ticks ) { m_ticks[phase] += ticks; }
+
+   void print( FILE *fout, unsigned long long cycles, unsigned long long insn ) const;
+
+private:
+   unsigned long long next_interval();
+   static double wall_seconds();
+
+   unsigned m_period;
+   bool m_sampling;
+   unsigned long long m_calls;
+   unsigned long long m_sampled_calls;
+   unsigned long long m_next_sample;
+   unsigned long long m_rand;
+   unsigned long long m_ticks[NUM_HOST_PROF_PHASES];
+   unsigned long long m_start_ticks;
+   double m_start_wall;
+};
+
+extern host_profiler g_host_prof;
+
+class host_prof_scope {
+public:
+   host_prof_scope( enum host_prof_phase_t phase ) : m_phase(phase), m_start(0)
+   {
+      if( g_host_prof.sampling() )
+         m_start = host_prof_ticks();
+   }
+   ~host_prof_scope()
+   {
+      if( g_host_prof.sampling() )
+         g_host_prof.add(m_phase, host_prof_ticks() - m_start);
+   }
+private:
+   enum host_prof_phase_t m_phase;
+   unsigned long long m_start;
+};
+
+#define HOST_PROF_SCOPE(P) host_prof_scope host_prof_scope_##P(HP_##P)
+
+#endif
@@ -0,0 +1,310 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Wilson W.L. Fung
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "icnt_analytic.h"
+#include "../option_parser.h"
+
+#include <assert.h>
+#include <math.h>
+
+analytic_icnt_config g_analytic_icnt_config;
+
+void analytic_icnt_config::reg_options( class OptionParser *opp )
+{
+   option_parser_register(opp, "-analytic_icnt_latency", OPT_UINT32, &latency,
+                          "analytic interconnect: pipeline latency in interconnect cycles", "8");
+   option_parser_register(opp, "-analytic_icnt_flit_size", OPT_UINT32, &flit_size,
+                          "analytic interconnect: flit size in bytes", "32");
+   option_parser_register(opp, "-analytic_icnt_port_bw", OPT_UINT32, &port_bw,
+                          "analytic interconnect: flits per cycle through each input and output port", "1");
+   option_parser_register(opp, "-analytic_icnt_input_buffer", OPT_UINT32, &input_buffer,
+                          "analytic interconnect: input buffer per port in flits", "64");
+   option_parser_register(opp, "-analytic_icnt_output_buffer", OPT_UINT32, &output_buffer,
+                          "analytic interconnect: output buffer per port in flits", "64");
+   option_parser_register(opp, "-analytic_icnt_validate", OPT_BOOL, &validate,
+                          "run the analytic interconnect next to intersim2 and report its latency error", "0");
+}
+
+analytic_crossbar::analytic_crossbar( const analytic_icnt_config &config, unsigned n_shader, unsigned n_mem, bool shadow )
+   : m_config(config)
+{
+   assert( config.flit_size > 0 && config.port_bw > 0 );
+   m_n_shader = n_shader;
+   m_n_ports = n_shader + n_mem;
+   m_shadow = shadow;
+   m_cycle = 0;
+   m_input_queue.resize(m_n_ports);
+   m_output_queue.resize(m_n_ports);
+   m_input_credits.assign(m_n_ports,config.input_buffer);
+   m_output_credits.assign(m_n_ports,config.output_buffer);
+   m_input_free.assign(m_n_ports,0);
+   m_output_free.assign(m_n_ports,0);
+   m_rr_input = 0;
+   m_wheel_mask = 0;
+   grow_wheel(config.latency + 8);
+   m_n_queued = 0;
+   m_n_packets = 0;
+   for (unsigned i = 0; i < 2; i++) {
+      m_n_delivered[i] = 0;
+      m_n_flits_delivered[i] = 0;
+      m_total_latency[i] = 0;
+      m_total_queueing[i] = 0;
+      m_max_latency[i] = 0;
+   }
+   m_output_stall = 0;
+}
+
+void analytic_crossbar::grow_wheel( unsigned long long min_size )
+{
+   unsigned long long size = m_wheel.size()? m_wheel.size() : 1;
+   while (size < min_size) 
+      size *= 2;
+   if (size == m_wheel.size()) 
+      return;
+   std::vector<std::vector<std::pair<unsigned long long,packet_t> > > old;
+   old.swap(m_wheel);
+   m_wheel.resize(size);
+   m_wheel_mask = size - 1;
+   for (unsigned b = 0; b < old.size(); b++) 
+      for (unsigned i = 0; i < old[b].size(); i++) 
+         m_wheel[old[b][i].first & m_wheel_mask].push_back(old[b][i]);
+}
+
+void analytic_crossbar::schedule( packet_t &p, unsigned long long arrive )
+{
+   if (arrive - m_cycle >= m_wheel.size()) 
+      grow_wheel(arrive - m_cycle + 1);
+   m_wheel[arrive & m_wheel_mask].push_back(std::make_pair(arrive,p));
+}
+
+bool analytic_crossbar::has_buffer( unsigned input, unsigned size ) const
+{
+   return m_shadow || m_input_credits[input] >= (int)n_flits(size);
+}
+
+void analytic_crossbar::push( unsigned input, unsigned output, void *data, unsigned size )
+{
+   assert( has_buffer(input,size) );
+   assert( input < m_n_ports && output < m_n_ports );
+   packet_t p;
+   p.data = data;
+   p.input = input;
+   p.output = output;
+   p.n_flits = n_flits(size);
+   p.push_cycle = m_cycle;
+   p.depart_cycle = 0;
+   m_input_credits[input] -= p.n_flits;
+   m_input_queue[input].push_back(p);
+   m_n_queued++;
+   m_n_packets++;
+}
+
+void *analytic_crossbar::pop( unsigned output )
+{
+   std::deque<packet_t> &q = m_output_queue[output];
+   if (q.empty()) 
+      return NULL;
+   packet_t p = q.front();
+   q.pop_front();
+   m_output_credits[output] += p.n_flits;
+   m_n_packets--;
+   return p.data;
+}
+
+void analytic_crossbar::transfer()
+{
+   m_cycle++;
+
+   // packets reaching their output buffer this cycle
+   std::vector<std::pair<unsigned long long,packet_t> > &bucket = m_wheel[m_cycle & m_wheel_mask];
+   if (!bucket.empty()) {
+      unsigned kept = 0;
+      for (unsigned i = 0; i < bucket.size(); i++) {
+         if (bucket[i].first != m_cycle) {
+            bucket[kept++] = bucket[i];
+            continue;
+         }
+         packet_t &p = bucket[i].second;
+         unsigned dir = is_request(p)? 0 : 1;
+         unsigned long long latency = m_cycle - p.push_cycle;
+         m_n_delivered[dir]++;
+         m_n_flits_delivered[dir] += p.n_flits;
+         m_total_latency[dir] += latency;
+         m_total_queueing[dir] += p.depart_cycle - p.push_cycle;
+         if (latency > m_max_latency[dir]) 
+            m_max_latency[dir] = latency;
+         m_output_queue[p.output].push_back(p);
+      }
+      bucket.resize(kept);
+   }
+
+   if (m_n_queued == 0) 
+      return;
+
+   // each input sends its oldest packet once the input port, the output port
+   // and the output buffer credits allow it; round robin between inputs
+   // resolves output conflicts
+   unsigned first = m_rr_input;
+   bool moved_first = false;
+   for (unsigned n = 0; n < m_n_ports; n++) {
+      unsigned in = first + n;
+      if (in >= m_n_ports) 
+         in -= m_n_ports;
+      if (m_input_queue[in].empty() || m_input_free[in] > m_cycle) 
+         continue;
+      packet_t &p = m_input_queue[in].front();
+      unsigned out = p.output;
+      if (m_output_free[out] > m_cycle) 
+         continue;
+      if (!m_shadow && m_output_credits[out] < (int)p.n_flits) {
+         m_output_stall++;
+         continue;
+      }
+      unsigned serialization = (p.n_flits + m_config.port_bw - 1) / m_config.port_bw;
+      m_input_free[in] = m_cycle + serialization;
+      m_output_free[out] = m_cycle + serialization;
+      m_output_credits[out] -= p.n_flits;
+      m_input_credits[in] += p.n_flits;
+      p.depart_cycle = m_cycle;
+      schedule(p, m_cycle + m_config.latency + serialization);
+      m_input_queue[in].pop_front();
+      m_n_queued--;
+      if (!moved_first) {
+         m_rr_input = (in + 1 == m_n_ports)? 0 : in + 1;
+         moved_first = true;
+      }
+   }
+}
+
+void analytic_crossbar::display_stats( FILE *fp ) const
+{
+   static const char *dir_str[] = { "request", "reply" };
+   fprintf(fp, "analytic icnt: cycles = %llu, output buffer stalls = %llu\n", m_cycle, m_output_stall);
+   for (unsigned i = 0; i < 2; i++) {
+      unsigned long long n = m_n_delivered[i];
+      fprintf(fp, "analytic icnt %-7s: packets = %llu, flits = %llu, avg latency = %.2f, avg queueing = %.2f, max latency = %llu\n",
+              dir_str[i], n, m_n_flits_delivered[i], n? (double)m_total_latency[i] / n : 0.0,
+              n? (double)m_total_queueing[i] / n : 0.0, m_max_latency[i]);
+   }
+}
+
+void analytic_crossbar::display_state( FILE *fp ) const
+{
+   fprintf(fp, "GPGPU-Sim uArch: ICNT:Display State: analytic crossbar, %u packets in network\n", m_n_packets);
+   for (unsigned i = 0; i < m_n_ports; i++) {
+      if (m_input_queue[i].empty() && m_output_queue[i].empty()) 
+         continue;
+      fprintf(fp, "   port %u: %zu queued at input (%d credits), %zu waiting at output (%d credits)\n", i,
+              m_input_queue[i].size(), m_input_credits[i], m_output_queue[i].size(), m_output_credits[i]);
+   }
+}
+
+analytic_icnt_validator::analytic_icnt_validator( const analytic_icnt_config &config, unsigned n_shader, unsigned n_mem )
+   : m_model(config, n_shader, n_mem, true)
+{
+   m_n_shader = n_shader;
+   m_n_ports = n_shader + n_mem;
+   for (unsigned i = 0; i < 2; i++) {
+      m_n_samples[i] = 0;
+      m_intersim_latency[i] = 0;
+      m_model_latency[i] = 0;
+      m_abs_error[i] = 0;
+   }
+   m_n_dropped = 0;
+}
+
+void analytic_icnt_validator::push( unsigned input, unsigned output, void *data, unsigned size )
+{
+   key_t key(data, input < m_n_shader);
+   sample_t s;
+   s.push_cycle = m_model.get_cycle();
+   s.intersim_cycle = 0;
+   s.model_cycle = 0;
+   std::pair<std::map<key_t,sample_t>::iterator,bool> r = m_pending.insert(std::make_pair(key,s));
+   if (!r.second) {
+      // the previous packet with this data pointer never completed in one of the networks
+      r.first->second = s;
+      m_n_dropped++;
+   }
+   m_model.push(input, output, data, size);
+}
+
+void analytic_icnt_validator::record( key_t key, sample_t &s )
+{
+   unsigned dir = key.second? 0 : 1;
+   double intersim = s.intersim_cycle - s.push_cycle;
+   double model = s.model_cycle - s.push_cycle;
+   m_n_samples[dir]++;
+   m_intersim_latency[dir] += intersim;
+   m_model_latency[dir] += model;
+   m_abs_error[dir] += fabs(model - intersim);
+   m_pending.erase(key);
+}
+
+void analytic_icnt_validator::pop( unsigned output, void *data )
+{
+   key_t key(data, output >= m_n_shader);
+   std::map<key_t,sample_t>::iterator s = m_pending.find(key);
+   if (s == m_pending.end()) 
+      return;
+   s->second.intersim_cycle = m_model.get_cycle();
+   if (s->second.model_cycle) 
+      record(key, s->second);
+}
+
+void analytic_icnt_validator::transfer()
+{
+   m_model.transfer();
+   for (unsigned output = 0; output < m_n_ports; output++) {
+      while (void *data = m_model.pop(output)) {
+         key_t key(data, output >= m_n_shader);
+         std::map<key_t,sample_t>::iterator s = m_pending.find(key);
+         if (s == m_pending.end()) 
+            continue;
+         s->second.model_cycle = m_model.get_cycle();
+         if (s->second.intersim_cycle) 
+            record(key, s->second);
+      }
+   }
+}
+
+void analytic_icnt_validator::display_stats( FILE *fp ) const
+{
+   static const char *dir_str[] = { "request", "reply" };
+   m_model.display_stats(fp);
+   for (unsigned i = 0; i < 2; i++) {
+      unsigned long long n = m_n_samples[i];
+      double intersim = n? m_intersim_latency[i] / n : 0.0;
+      double model = n? m_model_latency[i] / n : 0.0;
+      fprintf(fp, "analytic icnt validation %-7s: packets = %llu, intersim2 avg latency = %.2f, analytic avg latency = %.2f, "
+                  "avg error = %+.2f%%, avg abs error = %.2f cycles\n",
+              dir_str[i], n, intersim, model, intersim > 0? 100.0 * (model - intersim) / intersim : 0.0,
+              n? m_abs_error[i] / n : 0.0);
+   }
+   fprintf(fp, "analytic icnt validation: unmatched packets = %llu, still in flight = %zu\n", m_n_dropped, m_pending.size());
+}
@@ -0,0 +1,156 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Wilson W.L. Fung
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef ICNT_ANALYTIC_H
+#define ICNT_ANALYTIC_H
+
+#include <stdio.h>
+#include <deque>
+#include <map>
+#include <vector>
+
+// Analytic crossbar interconnect (-network_mode 2). Every device (shader
+// clusters first, then memory sub partitions) has one input and one output
+// port, each moving -analytic_icnt_port_bw flits per interconnect cycle, and
+// a packet reaches its output -analytic_icnt_latency cycles after it leaves
+// the input. Input and output buffer space is tracked with per-port flit
+// credits and packets in flight wait on a timing wheel, so an interconnect
+// cycle costs one pass over the ports with queued packets instead of routing
+// every flit through intersim2.
+
+struct analytic_icnt_config {
+   void reg_options( class OptionParser *opp );
+
+   unsigned latency;        // cycles from leaving the input to the output buffer
+   unsigned flit_size;      // bytes
+   unsigned port_bw;        // flits per cycle and port
+   unsigned input_buffer;   // flits per input port
+   unsigned output_buffer;  // flits per output port
+   bool     validate;       // run the model next to intersim2 and compare latencies
+};
+
+extern analytic_icnt_config g_analytic_icnt_config;
+
+class analytic_crossbar {
+public:
+   // shadow: pushes are never refused and pops drain everything (validation)
+   analytic_crossbar( const analytic_icnt_config &config, unsigned n_shader, unsigned n_mem, bool shadow );
+
+   bool has_buffer( unsigned input, unsigned size ) const;
+   void push( unsigned input, unsigned output, void *data, unsigned size );
+   void *pop( unsigned output );
+   void transfer();
+   bool busy() const { return m_n_packets > 0; }
+
+   unsigned get_flit_size() const { return m_config.flit_size; }
+   unsigned long long get_cycle() const { return m_cycle; }
+
+   void display_stats( FILE *fp ) const;
+   void display_state( FILE *fp ) const;
+
+private:
+   struct packet_t {
+      void *data;
+      unsigned input;
+      unsigned output;
+      unsigned n_flits;
+      unsigned long long push_cycle;
+      unsigned long long depart_cycle;
+   };
+
+   unsigned n_flits( unsigned size ) const { return (size + m_config.flit_size - 1) / m_config.flit_size; }
+   bool is_request( const packet_t &p ) const { return p.input < m_n_shader; }
+   void schedule( packet_t &p, unsigned long long arrive );
+   void grow_wheel( unsigned long long min_size );
+
+   const analytic_icnt_config &m_config;
+   unsigned m_n_shader;
+   unsigned m_n_ports;
+   bool m_shadow;
+   unsigned long long m_cycle;
+
+   std::vector<std::deque<packet_t> > m_input_queue;
+   std::vector<std::deque<packet_t> > m_output_queue;
+   std::vector<int> m_input_credits;
+   std::vector<int> m_output_credits;
+   std::vector<unsigned long long> m_input_free;  // cycle the input port can send again
+   std::vector<unsigned long long> m_output_free; // cycle the output port can accept again
+   unsigned m_rr_input; // first input port considered in the next cycle
+
+   // in flight packets, bucketed by arrival cycle modulo the wheel size
+   std::vector<std::vector<std::pair<unsigned long long,packet_t> > > m_wheel;
+   unsigned long long m_wheel_mask;
+
+   unsigned m_n_queued;  // in input queues
+   unsigned m_n_packets; // anywhere in the network
+
+   // stats, [0] = requests, [1] = replies
+   unsigned long long m_n_delivered[2];
+   unsigned long long m_n_flits_delivered[2];
+   unsigned long long m_total_latency[2]; // push to arrival at the output
+   unsigned long long m_total_queueing[2]; // push to leaving the input
+   unsigned long long m_max_latency[2];
+   unsigned long long m_output_stall;
+};
+
+// Latency comparison between intersim2 and a shadow analytic_crossbar fed
+// with the same packets (-network_mode 1 -analytic_icnt_validate 1). The
+// intersim2 latency of a packet is taken from its push to the cycle it is
+// popped from the network.
+class analytic_icnt_validator {
+public:
+   analytic_icnt_validator( const analytic_icnt_config &config, unsigned n_shader, unsigned n_mem );
+
+   void push( unsigned input, unsigned output, void *data, unsigned size );
+   void pop( unsigned output, void *data ); // intersim2 delivered data
+   void transfer();
+   void display_stats( FILE *fp ) const;
+
+private:
+   struct sample_t {
+      unsigned long long push_cycle;
+      unsigned long long intersim_cycle; // 0 = not popped yet
+      unsigned long long model_cycle;    // 0 = not arrived yet
+   };
+   typedef std::pair<void*,bool> key_t; // data, is request
+   void record( key_t key, sample_t &s );
+
+   analytic_crossbar m_model;
+   unsigned m_n_shader;
+   unsigned m_n_ports;
+   std::map<key_t,sample_t> m_pending;
+
+   // [0] = requests, [1] = replies
+   unsigned long long m_n_samples[2];
+   double m_intersim_latency[2];
+   double m_model_latency[2];
+   double m_abs_error[2];
+   unsigned long long m_n_dropped;
+};
+
+#endif
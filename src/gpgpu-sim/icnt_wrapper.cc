@@ -26,6 +26,7 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "icnt_wrapper.h"
+#include "icnt_analytic.h"
 #include <assert.h>
 #include "../intersim2/globals.hpp"
 #include "../intersim2/interconnect_interface.hpp"
@@ -105,10 +106,104 @@ static unsigned intersim2_get_flit_size()
    return g_icnt_interface->GetFlitSize();
 }
 
+// intersim2 with a shadow analytic crossbar that measures the analytic model's latency error 
+
+static analytic_icnt_validator *g_analytic_validator = NULL;
+
+static void intersim2_validate_create(unsigned int n_shader, unsigned int n_mem)
+{
+   intersim2_create(n_shader, n_mem);
+   g_analytic_validator = new analytic_icnt_validator(g_analytic_icnt_config, n_shader, n_mem);
+}
+
+static void intersim2_validate_push(unsigned input, unsigned output, void* data, unsigned int size)
+{
+   intersim2_push(input, output, data, size);
+   g_analytic_validator->push(input, output, data, size);
+}
+
+static void* intersim2_validate_pop(unsigned output)
+{
+   void *data = intersim2_pop(output);
+   if (data) 
+      g_analytic_validator->pop(output, data);
+   return data;
+}
+
+static void intersim2_validate_transfer()
+{
+   intersim2_transfer();
+   g_analytic_validator->transfer();
+}
+
+static void intersim2_validate_display_overall_stats()
+{
+   intersim2_display_overall_stats();
+   g_analytic_validator->display_stats(stdout);
+}
+
+// Analytic crossbar 
+
+static analytic_crossbar *g_analytic_icnt = NULL;
+
+static void analytic_create(unsigned int n_shader, unsigned int n_mem)
+{
+   g_analytic_icnt = new analytic_crossbar(g_analytic_icnt_config, n_shader, n_mem, false);
+}
+
+static void analytic_init()
+{
+}
+
+static bool analytic_has_buffer(unsigned input, unsigned int size)
+{
+   return g_analytic_icnt->has_buffer(input, size);
+}
+
+static void analytic_push(unsigned input, unsigned output, void* data, unsigned int size)
+{
+   g_analytic_icnt->push(input, output, data, size);
+}
+
+static void* analytic_pop(unsigned output)
+{
+   return g_analytic_icnt->pop(output);
+}
+
+static void analytic_transfer()
+{
+   g_analytic_icnt->transfer();
+}
+
+static bool analytic_busy()
+{
+   return g_analytic_icnt->busy();
+}
+
+static void analytic_display_stats()
+{
+   g_analytic_icnt->display_stats(stdout);
+}
+
+static void analytic_display_overall_stats()
+{
+}
+
+static void analytic_display_state(FILE *fp)
+{
+   g_analytic_icnt->display_state(fp);
+}
+
+static unsigned analytic_get_flit_size()
+{
+   return g_analytic_icnt->get_flit_size();
+}
+
 void icnt_reg_options( class OptionParser * opp )
 {
-   option_parser_register(opp, "-network_mode", OPT_INT32, &g_network_mode, "Interconnection network mode", "1");
+   option_parser_register(opp, "-network_mode", OPT_INT32, &g_network_mode, "Interconnection network mode (1 = intersim2, 2 = analytic crossbar)", "1");
    option_parser_register(opp, "-inter_config_file", OPT_CSTR, &g_network_config_filename, "Interconnection network config file", "mesh");
+   g_analytic_icnt_config.reg_options(opp);
 }
 
 void icnt_wrapper_init()
@@ -128,6 +223,26 @@ void icnt_wrapper_init()
          icnt_display_overall_stats = intersim2_display_overall_stats;
          icnt_display_state = intersim2_display_state;
          icnt_get_flit_size = intersim2_get_flit_size;
+         if (g_analytic_icnt_config.validate) {
+            icnt_create     = intersim2_validate_create;
+            icnt_push       = intersim2_validate_push;
+            icnt_pop        = intersim2_validate_pop;
+            icnt_transfer   = intersim2_validate_transfer;
+            icnt_display_overall_stats = intersim2_validate_display_overall_stats;
+         }
+         break;
+      case ANALYTIC:
+         icnt_create     = analytic_create;
+         icnt_init       = analytic_init;
+         icnt_has_buffer = analytic_has_buffer;
+         icnt_push       = analytic_push;
+         icnt_pop        = analytic_pop;
+         icnt_transfer   = analytic_transfer;
+         icnt_busy       = analytic_busy;
+         icnt_display_stats = analytic_display_stats;
+         icnt_display_overall_stats = analytic_display_overall_stats;
+         icnt_display_state = analytic_display_state;
+         icnt_get_flit_size = analytic_get_flit_size;
          break;
       default:
          assert(0);
@@ -61,6 +61,7 @@ extern int g_network_mode;
 
 enum network_mode {
    INTERSIM = 1,
+   ANALYTIC = 2,
    N_NETWORK_MODE
 };
 
@@ -44,6 +44,7 @@
 #include "shader.h"
 #include "mem_latency_stat.h"
 #include "l2cache_trace.h"
+#include "stats_registry.h"
 
 
 mem_fetch * partition_mf_allocator::alloc(new_addr_type addr, mem_access_type type, unsigned size, bool wr ) const 
@@ -249,6 +250,17 @@ void memory_partition_unit::dram_cycle()
     }
 }
 
+unsigned long long memory_partition_unit::dram_next_event_cycle() const
+{
+    if (!m_dram_latency_queue.empty()) 
+        return m_dram->get_dram_cycle();
+    for (unsigned p = 0; p < m_config->m_n_sub_partition_per_memory_channel; p++) {
+        if (!m_sub_partition[p]->L2_dram_queue_empty()) 
+            return m_dram->get_dram_cycle();
+    }
+    return m_dram->next_event_cycle();
+}
+
 void memory_partition_unit::set_done( mem_fetch *mf )
 {
     unsigned global_spid = mf->get_sub_partition_id(); 
@@ -273,6 +285,23 @@ void memory_partition_unit::set_dram_power_stats(unsigned &n_cmd,
     m_dram->set_dram_power_stats(n_cmd, n_activity, n_nop, n_act, n_pre, n_rd, n_wr, n_req);
 }
 
+static const char *dram_stat_str[] = { "n_cmd", "n_activity", "n_nop", "n_act", "n_pre", "n_rd", "n_wr", "n_req" };
+
+static void dram_stats( const void *obj, unsigned instance, double *values )
+{
+   unsigned v[8];
+   ((const memory_partition_unit*)obj)->set_dram_power_stats(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]);
+   for (unsigned i = 0; i < 8; i++)
+      values[i] = v[i];
+}
+
+void memory_partition_unit::register_stats( stats_registry &reg ) const
+{
+   reg.add_group("dram", m_id, dram_stat_str, 8, true, &dram_stats, this);
+   for (unsigned p = 0; p < m_config->m_n_sub_partition_per_memory_channel; p++)
+      m_sub_partition[p]->register_stats(reg);
+}
+
 void memory_partition_unit::print( FILE *fp ) const
 {
     fprintf(fp, "Memory Partition %u: \n", m_id); 
@@ -381,6 +410,8 @@ void memory_sub_partition::cache_cycle( unsigned cycle )
             if ( !output_full && port_free ) {
                 std::list<cache_event> events;
                 enum cache_request_status status = m_L2cache->access(mf->get_addr(),mf,gpu_sim_cycle+gpu_tot_sim_cycle,events);
+                if ( status == MISS )
+                    TRACE_EVENT(L2_MISS, m_id, mf->get_addr(), mf->get_access_type());
                 bool write_sent = was_write_sent(events);
                 bool read_sent = was_read_sent(events);
 
@@ -464,6 +495,28 @@ void memory_sub_partition::print_cache_stat(unsigned &accesses, unsigned &misses
        m_L2cache->print(fp,accesses,misses);
 }
 
+static const char *l2_stat_str[] = { "accesses", "misses", "pending_hits", "reservation_fails",
+                                     "port_available_cycles", "data_port_busy_cycles", "fill_port_busy_cycles" };
+
+static void l2_stats( const void *obj, unsigned instance, double *values )
+{
+   struct cache_sub_stats css;
+   ((const memory_sub_partition*)obj)->get_L2cache_sub_stats(css);
+   values[0] = css.accesses;
+   values[1] = css.misses;
+   values[2] = css.pending_hits;
+   values[3] = css.res_fails;
+   values[4] = css.port_available_cycles;
+   values[5] = css.data_port_busy_cycles;
+   values[6] = css.fill_port_busy_cycles;
+}
+
+void memory_sub_partition::register_stats( stats_registry &reg ) const
+{
+   if (!m_config->m_L2_config.disabled())
+      reg.add_group("l2", m_id, l2_stat_str, 7, true, &l2_stats, this);
+}
+
 void memory_sub_partition::print( FILE *fp ) const
 {
     if ( !m_request_tracker.empty() ) {
@@ -65,6 +65,8 @@ public:
 
    void cache_cycle( unsigned cycle );
    void dram_cycle();
+   // DRAM cycle at which dram_cycle() next has work, see dram_device::next_event_cycle()
+   unsigned long long dram_next_event_cycle() const;
 
    void set_done( mem_fetch *mf );
 
@@ -72,6 +74,7 @@ public:
    void print_stat( FILE *fp ) { m_dram->print_stat(fp); }
    void visualize() const { m_dram->visualize(); }
    void print( FILE *fp ) const;
+   void register_stats( class stats_registry &reg ) const;
 
    class memory_sub_partition * get_sub_partition(int sub_partition_id) 
    {
@@ -98,7 +101,7 @@ private:
    const struct memory_config *m_config;
    class memory_stats_t *m_stats;
    class memory_sub_partition **m_sub_partition; 
-   class dram_t *m_dram;
+   class dram_device *m_dram;
 
    class arbitration_metadata
    {
@@ -176,6 +179,7 @@ public:
 
    void accumulate_L2cache_stats(class cache_stats &l2_stats) const;
    void get_L2cache_sub_stats(struct cache_sub_stats &css) const;
+   void register_stats( class stats_registry &reg ) const;
 
 private:
 // data
@@ -37,6 +37,7 @@
 #include "../cuda-sim/ptx-stats.h"
 #include "visualizer.h"
 #include "dram.h"
+#include "stats_registry.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -210,6 +211,45 @@ void memory_stats_t::memlatstat_lat_pw()
 }
 
 
+static void average_mf_latency( const void *obj, unsigned instance, double *values )
+{
+   const memory_stats_t *stats = (const memory_stats_t*)obj;
+   values[0] = stats->num_mfs? (double)(stats->mf_total_lat/stats->num_mfs) : 0;
+}
+
+void memory_stats_t::register_stats( stats_registry &reg ) const
+{
+   static const char *average_str[] = { "average_mf_latency" };
+   reg.add("mem", -1, "max_mrq_latency", &max_mrq_latency);
+   reg.add("mem", -1, "max_dq_latency", &max_dq_latency);
+   reg.add("mem", -1, "max_mf_latency", &max_mf_latency);
+   reg.add("mem", -1, "max_icnt2mem_latency", &max_icnt2mem_latency);
+   reg.add("mem", -1, "max_icnt2sh_latency", &max_icnt2sh_latency);
+   reg.add("mem", -1, "num_mfs", &num_mfs);
+   reg.add("mem", -1, "mf_total_latency", &mf_total_lat);
+   reg.add_group("mem", -1, average_str, 1, true, &average_mf_latency, this);
+   reg.add("mem", -1, "total_n_access", &total_n_access);
+   reg.add("mem", -1, "total_n_reads", &total_n_reads);
+   reg.add("mem", -1, "total_n_writes", &total_n_writes);
+
+   // latency histograms, bin i counts latencies in [2^i, 2^(i+1))
+   char name[32];
+   for (unsigned i=0; i < 32; i++) {
+      snprintf(name, sizeof(name), "mrq_lat_table_%u", i);
+      reg.add("mem", -1, name, &mrq_lat_table[i]);
+      snprintf(name, sizeof(name), "dq_lat_table_%u", i);
+      reg.add("mem", -1, name, &dq_lat_table[i]);
+      snprintf(name, sizeof(name), "mf_lat_table_%u", i);
+      reg.add("mem", -1, name, &mf_lat_table[i]);
+   }
+   for (unsigned i=0; i < 24; i++) {
+      snprintf(name, sizeof(name), "icnt2mem_lat_table_%u", i);
+      reg.add("mem", -1, name, &icnt2mem_lat_table[i]);
+      snprintf(name, sizeof(name), "icnt2sh_lat_table_%u", i);
+      reg.add("mem", -1, name, &icnt2sh_lat_table[i]);
+   }
+}
+
 void memory_stats_t::memlatstat_print( unsigned n_mem, unsigned gpu_mem_n_bk )
 {
    unsigned i,j,k,l,m;
@@ -44,6 +44,7 @@ public:
    void memlatstat_icnt2mem_pop( class mem_fetch *mf);
    void memlatstat_lat_pw();
    void memlatstat_print(unsigned n_mem, unsigned gpu_mem_n_bk);
+   void register_stats( class stats_registry &reg ) const;
 
    void visualizer_print( gzFile visualizer_file );
 
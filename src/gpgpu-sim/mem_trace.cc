@@ -0,0 +1,248 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Wilson W.L. Fung
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "mem_trace.h"
+#include "mem_fetch.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+const char *mem_trace_event_str( enum mem_trace_event event )
+{
+   static const char *str[] = { "REQ_INJECT", "REQ_ARRIVE", "REPLY_INJECT", "REPLY_ARRIVE" };
+   assert( event < NUM_MEM_TRACE_EVENTS );
+   return str[event];
+}
+
+static const unsigned header_size = 12;
+static const unsigned max_record_size = 2 + 6*10; // two bytes and six varints (cycle, addr, uid, sid, sub_partition, size)
+
+static inline unsigned long long zigzag( long long v )
+{
+   return ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63);
+}
+
+static inline long long unzigzag( unsigned long long v )
+{
+   return (long long)(v >> 1) ^ -(long long)(v & 1);
+}
+
+static inline void put_varint( std::vector<unsigned char> &buf, unsigned long long v )
+{
+   while( v >= 0x80 ) {
+      buf.push_back( (unsigned char)(v | 0x80) );
+      v >>= 7;
+   }
+   buf.push_back( (unsigned char)v );
+}
+
+static inline bool get_varint( const std::vector<unsigned char> &buf, unsigned &pos, unsigned long long &v )
+{
+   v = 0;
+   for( unsigned shift=0; shift < 64; shift += 7 ) {
+      if( pos >= buf.size() )
+         return false;
+      unsigned char b = buf[pos++];
+      v |= (unsigned long long)(b & 0x7f) << shift;
+      if( !(b & 0x80) )
+         return true;
+   }
+   return false;
+}
+
+static void put_u32( unsigned char *p, unsigned v )
+{
+   for( unsigned i=0; i < 4; i++ )
+      p[i] = (unsigned char)(v >> (8*i));
+}
+
+static unsigned get_u32( const unsigned char *p )
+{
+   return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned)p[3] << 24);
+}
+
+mem_trace_writer::mem_trace_writer( const char *filename, int zlevel )
+{
+   m_file = fopen(filename,"wb");
+   if( !m_file ) {
+      fprintf(stderr,"GPGPU-Sim: cannot open memory trace file \"%s\"\n", filename);
+      exit(1);
+   }
+   fwrite(MEM_TRACE_MAGIC,1,8,m_file);
+   m_zlevel = zlevel;
+   m_raw.reserve(MEM_TRACE_BLOCK_SIZE + max_record_size);
+   m_compressed.resize(compressBound(MEM_TRACE_BLOCK_SIZE + max_record_size));
+   m_num_records = 0;
+   reset_deltas();
+}
+
+mem_trace_writer::~mem_trace_writer()
+{
+   flush();
+   fclose(m_file);
+}
+
+void mem_trace_writer::reset_deltas()
+{
+   memset(&m_last,0,sizeof(m_last));
+   m_block_records = 0;
+}
+
+void mem_trace_writer::record( enum mem_trace_event event, const mem_fetch *mf, unsigned long long cycle )
+{
+   mem_trace_record r;
+   r.cycle = cycle;
+   r.addr = mf->get_addr();
+   r.request_uid = mf->get_request_uid();
+   r.sid = mf->get_sid();
+   r.sub_partition = mf->get_sub_partition_id();
+   r.size = mf->get_data_size();
+   r.event = event;
+   r.access_type = mf->get_access_type();
+   r.status = mf->get_status();
+   r.is_write = mf->get_is_write();
+   add(r);
+}
+
+void mem_trace_writer::add( const mem_trace_record &r )
+{
+   assert( r.event < NUM_MEM_TRACE_EVENTS && r.access_type < 32 );
+   m_raw.push_back( r.event | (r.is_write << 2) | (r.access_type << 3) );
+   m_raw.push_back( r.status );
+   put_varint( m_raw, zigzag(r.cycle - m_last.cycle) );
+   put_varint( m_raw, zigzag(r.addr - m_last.addr) );
+   put_varint( m_raw, zigzag((long long)r.request_uid - (long long)m_last.request_uid) );
+   put_varint( m_raw, r.sid );
+   put_varint( m_raw, r.sub_partition );
+   put_varint( m_raw, r.size );
+   m_last = r;
+   m_block_records++;
+   m_num_records++;
+   if( m_raw.size() >= MEM_TRACE_BLOCK_SIZE )
+      flush();
+}
+
+void mem_trace_writer::flush()
+{
+   if( m_block_records ) {
+      uLongf comp_len = m_compressed.size();
+      int err = compress2(&m_compressed[0],&comp_len,&m_raw[0],m_raw.size(),m_zlevel);
+      assert( err == Z_OK );
+      unsigned char header[header_size];
+      put_u32(header,m_raw.size());
+      put_u32(header+4,comp_len);
+      put_u32(header+8,m_block_records);
+      fwrite(header,1,header_size,m_file);
+      fwrite(&m_compressed[0],1,comp_len,m_file);
+      m_raw.clear();
+      reset_deltas();
+   }
+   fflush(m_file);
+}
+
+mem_trace_reader::mem_trace_reader( const char *filename )
+{
+   m_file = fopen(filename,"rb");
+   char magic[8];
+   if( m_file && (fread(magic,1,8,m_file) != 8 || memcmp(magic,MEM_TRACE_MAGIC,8)) ) {
+      fclose(m_file);
+      m_file = NULL;
+   }
+   m_pos = 0;
+   m_block_records = 0;
+}
+
+mem_trace_reader::~mem_trace_reader()
+{
+   if( m_file )
+      fclose(m_file);
+}
+
+bool mem_trace_reader::probe( const char *filename )
+{
+   mem_trace_reader reader(filename);
+   return reader.is_open();
+}
+
+void mem_trace_reader::reset_deltas()
+{
+   memset(&m_last,0,sizeof(m_last));
+   m_pos = 0;
+}
+
+bool mem_trace_reader::read_block()
+{
+   unsigned char header[header_size];
+   if( !m_file || fread(header,1,header_size,m_file) != header_size )
+      return false;
+   unsigned raw_len = get_u32(header);
+   unsigned comp_len = get_u32(header+4);
+   m_block_records = get_u32(header+8);
+   m_compressed.resize(comp_len);
+   m_raw.resize(raw_len);
+   if( fread(&m_compressed[0],1,comp_len,m_file) != comp_len )
+      return false;
+   uLongf len = raw_len;
+   if( uncompress(&m_raw[0],&len,&m_compressed[0],comp_len) != Z_OK || len != raw_len ) {
+      fprintf(stderr,"GPGPU-Sim: corrupted memory trace block\n");
+      return false;
+   }
+   reset_deltas();
+   return true;
+}
+
+bool mem_trace_reader::next( mem_trace_record &r )
+{
+   while( m_block_records == 0 ) {
+      if( !read_block() )
+         return false;
+   }
+   if( m_pos + 2 > m_raw.size() )
+      return false;
+   unsigned char flags = m_raw[m_pos++];
+   r.event = flags & 3;
+   r.is_write = (flags >> 2) & 1;
+   r.access_type = flags >> 3;
+   r.status = m_raw[m_pos++];
+   unsigned long long v[6];
+   for( unsigned i=0; i < 6; i++ ) {
+      if( !get_varint(m_raw,m_pos,v[i]) )
+         return false;
+   }
+   r.cycle = m_last.cycle + unzigzag(v[0]);
+   r.addr = m_last.addr + unzigzag(v[1]);
+   r.request_uid = m_last.request_uid + unzigzag(v[2]);
+   r.sid = v[3];
+   r.sub_partition = v[4];
+   r.size = v[5];
+   m_last = r;
+   m_block_records--;
+   return true;
+}
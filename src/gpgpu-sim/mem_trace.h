@@ -0,0 +1,124 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Wilson W.L. Fung
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef MEM_TRACE_H
+#define MEM_TRACE_H
+
+#include <stdio.h>
+#include <vector>
+
+#include "../abstract_hardware_model.h"
+
+// Binary trace of the mem_fetch traffic crossing the interconnect between the
+// core clusters and the memory sub partitions (-gpgpu_mem_trace_file).
+//
+// File layout: an 8 byte magic ("GPUMTRC1") followed by blocks. Each block is
+// a 12 byte header {raw size, compressed size, number of records} (32-bit
+// little endian) and a zlib compressed payload of at most MEM_TRACE_BLOCK_SIZE
+// raw bytes. Records are delta encoded against the previous record of the
+// same block, so every block can be decoded on its own:
+//
+//    byte     event (bits 0-1), is_write (bit 2), access type (bits 3-7)
+//    byte     mem_fetch_status after the event
+//    varint   zigzag cycle delta
+//    varint   zigzag address delta
+//    varint   zigzag request uid delta
+//    varint   sid, sub partition, size
+
+#define MEM_TRACE_MAGIC "GPUMTRC1"
+#define MEM_TRACE_BLOCK_SIZE (64*1024)
+
+enum mem_trace_event {
+   MEM_TRACE_REQ_INJECT = 0,   // core cluster pushes a request into the interconnect
+   MEM_TRACE_REQ_ARRIVE,       // memory sub partition accepts the request
+   MEM_TRACE_REPLY_INJECT,     // memory sub partition pushes the reply into the interconnect
+   MEM_TRACE_REPLY_ARRIVE,     // core cluster accepts the reply
+   NUM_MEM_TRACE_EVENTS
+};
+
+const char *mem_trace_event_str( enum mem_trace_event event );
+
+struct mem_trace_record {
+   unsigned long long cycle;
+   new_addr_type addr;
+   unsigned request_uid;
+   unsigned sid;
+   unsigned sub_partition;
+   unsigned size;
+   unsigned char event;       // mem_trace_event
+   unsigned char access_type; // mem_access_type
+   unsigned char status;      // mem_fetch_status
+   bool is_write;
+};
+
+class mem_trace_writer {
+public:
+   mem_trace_writer( const char *filename, int zlevel );
+   ~mem_trace_writer();
+
+   void record( enum mem_trace_event event, const class mem_fetch *mf, unsigned long long cycle );
+   void add( const mem_trace_record &r );
+   void flush(); // compress and write out the current block
+   unsigned long long num_records() const { return m_num_records; }
+
+private:
+   void reset_deltas();
+
+   FILE *m_file;
+   int m_zlevel;
+   std::vector<unsigned char> m_raw;
+   std::vector<unsigned char> m_compressed;
+   unsigned m_block_records;
+   unsigned long long m_num_records;
+   mem_trace_record m_last;
+};
+
+class mem_trace_reader {
+public:
+   mem_trace_reader( const char *filename );
+   ~mem_trace_reader();
+
+   // true if filename starts with MEM_TRACE_MAGIC
+   static bool probe( const char *filename );
+
+   bool is_open() const { return m_file != NULL; }
+   bool next( mem_trace_record &r ); // false at end of trace
+
+private:
+   bool read_block();
+   void reset_deltas();
+
+   FILE *m_file;
+   std::vector<unsigned char> m_raw;
+   std::vector<unsigned char> m_compressed;
+   unsigned m_pos;
+   unsigned m_block_records;
+   mem_trace_record m_last;
+};
+
+#endif
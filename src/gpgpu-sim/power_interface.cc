@@ -26,9 +26,177 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "power_interface.h"
+#include "stats_log.h"
+
+#include <pthread.h>
+#include <deque>
+
+// Evaluates power samples on a thread of its own (-power_async_eval). The
+// samples are evaluated one at a time in the order they were taken, exactly
+// as the synchronous path would, so every total comes out the same; only
+// per-cycle dumps may interleave differently with the rest of stdout.
+class power_eval_thread {
+public:
+   power_eval_thread( gpgpu_sim_wrapper *wrapper, unsigned max_queued );
+
+   // blocks while max_queued samples are waiting
+   void push( const power_sample_t &sample );
+   void flush();
+
+private:
+   static void *run( void *arg );
+
+   gpgpu_sim_wrapper *m_wrapper;
+   unsigned m_max_queued;
+   std::deque<power_sample_t> m_queue;
+   bool m_busy; // evaluating the sample taken off the queue last
+   pthread_t m_thread;
+   pthread_mutex_t m_lock;
+   pthread_cond_t m_not_empty;
+   pthread_cond_t m_not_full;
+   pthread_cond_t m_idle;
+};
+
+static power_eval_thread *g_power_eval_thread = NULL;
+
+// -power_trace_columnar_file: component 0 holds the power trace columns and
+// component 1 the metric trace columns, named after the text trace headers
+static stats_log_writer *g_power_columnar_trace = NULL;
+
+static std::string trace_label( const char *label )
+{
+	std::string s(label);
+	if( !s.empty() && s[s.size()-1] == ',' )
+		s.erase(s.size()-1);
+	return s;
+}
+
+static void print_columnar_trace( const gpgpu_sim_wrapper *wrapper, unsigned long long cycle )
+{
+	stats_log_writer *log = g_power_columnar_trace;
+	const std::vector<double> &cmp_pwr = wrapper->get_sample_cmp_pwr();
+	const std::vector<double> &perf_counters = wrapper->get_sample_perf_counters();
+	log->begin_sample(cycle);
+	log->set(log->column("power",0,0,6), wrapper->get_proc_power());
+	for(unsigned i=0; i<cmp_pwr.size(); ++i)
+		log->set(log->column(trace_label(gpgpu_sim_wrapper::get_pwr_cmp_label(i)),0,0,6), cmp_pwr[i]);
+	for(unsigned i=0; i<perf_counters.size(); ++i)
+		log->set(log->column(trace_label(perf_count_label[i]),1,0,6), perf_counters[i]);
+	log->end_sample();
+}
+
+static void evaluate_power_sample( gpgpu_sim_wrapper *wrapper, const power_sample_t &s )
+{
+	wrapper->set_inst_power(s.clock_gated_lanes, s.sample_cycles, s.sample_cycles,
+			s.tot_inst, s.int_inst, s.fp_inst, s.l1d_read_accesses, s.l1d_write_accesses, s.committed_inst);
+
+	// Single RF for both int and fp ops
+	wrapper->set_regfile_power(s.regfile_reads, s.regfile_writes, s.non_regfile_operands);
+
+	//Instruction cache stats
+	wrapper->set_icache_power(s.icache_hits, s.icache_misses);
+
+	//Constant Cache, shared memory, texture cache
+	wrapper->set_ccache_power(s.ccache_hits, s.ccache_misses);
+	wrapper->set_tcache_power(s.tcache_hits, s.tcache_misses);
+	wrapper->set_shrd_mem_power(s.shmem_read_access);
+
+	wrapper->set_l1cache_power(s.l1d_read_hits, s.l1d_read_misses, s.l1d_write_hits, s.l1d_write_misses);
+
+	wrapper->set_l2cache_power(s.l2_read_hits, s.l2_read_misses, s.l2_write_hits, s.l2_write_misses);
+
+	wrapper->set_idle_core_power(s.num_idle_core);
+
+	//pipeline power - pipeline_duty_cycle *= percent_active_sms;
+	wrapper->set_duty_cycle_power(s.pipeline_duty_cycle);
+
+	//Memory Controller
+	wrapper->set_mem_ctrl_power(s.dram_rd, s.dram_wr, s.dram_pre);
+
+	//Execution pipeline accesses
+	//FPU (SP) accesses, Integer ALU (not present in Tesla), Sfu accesses
+	wrapper->set_exec_unit_power(s.fpu_accesses, s.ialu_accesses, s.sfu_accesses);
+
+	//Average active lanes for sp and sfu pipelines
+	wrapper->set_active_lanes_power(s.sp_active_lanes, s.sfu_active_lanes);
+
+	wrapper->set_NoC_power(s.icnt_mem_to_simt, s.icnt_simt_to_mem); // Number of flits traversing the interconnect
+
+	wrapper->compute();
+
+	wrapper->update_components_power();
+	wrapper->print_trace_files();
+	if(g_power_columnar_trace)
+		print_columnar_trace(wrapper,s.cycle);
+
+	wrapper->detect_print_steady_state(0,s.tot_sim_insn);
+
+	wrapper->power_metrics_calculations();
+
+	wrapper->dump();
+}
+
+power_eval_thread::power_eval_thread( gpgpu_sim_wrapper *wrapper, unsigned max_queued )
+{
+   m_wrapper = wrapper;
+   m_max_queued = max_queued;
+   m_busy = false;
+   pthread_mutex_init(&m_lock,NULL);
+   pthread_cond_init(&m_not_empty,NULL);
+   pthread_cond_init(&m_not_full,NULL);
+   pthread_cond_init(&m_idle,NULL);
+   if( pthread_create(&m_thread,NULL,run,this) ) {
+      printf("GPGPU-Sim: unable to start the power evaluation thread\n");
+      abort();
+   }
+}
+
+void power_eval_thread::push( const power_sample_t &sample )
+{
+   pthread_mutex_lock(&m_lock);
+   while( m_queue.size() >= m_max_queued )
+      pthread_cond_wait(&m_not_full,&m_lock);
+   m_queue.push_back(sample);
+   pthread_cond_signal(&m_not_empty);
+   pthread_mutex_unlock(&m_lock);
+}
+
+void power_eval_thread::flush()
+{
+   pthread_mutex_lock(&m_lock);
+   while( !m_queue.empty() || m_busy )
+      pthread_cond_wait(&m_idle,&m_lock);
+   pthread_mutex_unlock(&m_lock);
+   fflush(stdout);
+}
+
+void *power_eval_thread::run( void *arg )
+{
+   power_eval_thread *t = (power_eval_thread*)arg;
+   pthread_mutex_lock(&t->m_lock);
+   while( true ) {
+      while( t->m_queue.empty() )
+         pthread_cond_wait(&t->m_not_empty,&t->m_lock);
+      power_sample_t sample = t->m_queue.front();
+      t->m_queue.pop_front();
+      t->m_busy = true;
+      pthread_cond_signal(&t->m_not_full);
+      pthread_mutex_unlock(&t->m_lock);
+
+      evaluate_power_sample(t->m_wrapper,sample);
+
+      pthread_mutex_lock(&t->m_lock);
+      t->m_busy = false;
+      if( t->m_queue.empty() )
+         pthread_cond_broadcast(&t->m_idle);
+   }
+   return NULL;
+}
 
 void init_mcpat(const gpgpu_sim_config &config, class gpgpu_sim_wrapper *wrapper, unsigned stat_sample_freq, unsigned tot_inst, unsigned inst){
 
+	// init_mcpat() runs at every launch and resets the wrapper's counters
+	mcpat_flush();
 	wrapper->init_mcpat(config.g_power_config_name, config.g_power_filename, config.g_power_trace_filename,
 	    			config.g_metric_trace_filename,config.g_steady_state_tracking_filename,config.g_power_simulation_enabled,
 	    			config.g_power_trace_enabled,config.g_steady_power_levels_enabled,config.g_power_per_cycle_dump,
@@ -36,6 +204,10 @@ void init_mcpat(const gpgpu_sim_config &config, class gpgpu_sim_wrapper *wrapper
 	    			tot_inst+inst,stat_sample_freq
 	    			);
 
+	if(config.g_power_async_eval && !g_power_eval_thread)
+		g_power_eval_thread = new power_eval_thread(wrapper, 64);
+	if(config.g_power_columnar_trace_filename && !g_power_columnar_trace)
+		g_power_columnar_trace = new stats_log_writer(config.g_power_columnar_trace_filename, config.g_power_trace_zlevel);
 }
 
 void mcpat_cycle(const gpgpu_sim_config &config, const struct shader_core_config *shdr_config, class gpgpu_sim_wrapper *wrapper, class power_stat_t *power_stats, unsigned stat_sample_freq, unsigned tot_cycle, unsigned cycle, unsigned tot_inst, unsigned inst){
@@ -49,77 +221,85 @@ void mcpat_cycle(const gpgpu_sim_config &config, const struct shader_core_config
 
 	if ((tot_cycle+cycle) % stat_sample_freq == 0) {
 
-		wrapper->set_inst_power(shdr_config->gpgpu_clock_gated_lanes,
-				stat_sample_freq, stat_sample_freq,
-				power_stats->get_total_inst(), power_stats->get_total_int_inst(),
-				power_stats->get_total_fp_inst(), power_stats->get_l1d_read_accesses(),
-				power_stats->get_l1d_write_accesses(), power_stats->get_committed_inst());
-
-		// Single RF for both int and fp ops
-		wrapper->set_regfile_power(power_stats->get_regfile_reads(), power_stats->get_regfile_writes(), power_stats->get_non_regfile_operands());
+		power_sample_t s;
+		s.clock_gated_lanes = shdr_config->gpgpu_clock_gated_lanes;
+		s.sample_cycles = stat_sample_freq;
+		s.tot_inst = power_stats->get_total_inst();
+		s.int_inst = power_stats->get_total_int_inst();
+		s.fp_inst = power_stats->get_total_fp_inst();
+		s.l1d_read_accesses = power_stats->get_l1d_read_accesses();
+		s.l1d_write_accesses = power_stats->get_l1d_write_accesses();
+		s.committed_inst = power_stats->get_committed_inst();
 
-		//Instruction cache stats
-		wrapper->set_icache_power(power_stats->get_inst_c_hits(), power_stats->get_inst_c_misses());
+		s.regfile_reads = power_stats->get_regfile_reads();
+		s.regfile_writes = power_stats->get_regfile_writes();
+		s.non_regfile_operands = power_stats->get_non_regfile_operands();
 
-		//Constant Cache, shared memory, texture cache
-		wrapper->set_ccache_power(power_stats->get_constant_c_hits(), power_stats->get_constant_c_misses());
-		wrapper->set_tcache_power(power_stats->get_texture_c_hits(), power_stats->get_texture_c_misses());
-		wrapper->set_shrd_mem_power(power_stats->get_shmem_read_access());
+		s.icache_hits = power_stats->get_inst_c_hits();
+		s.icache_misses = power_stats->get_inst_c_misses();
+		s.ccache_hits = power_stats->get_constant_c_hits();
+		s.ccache_misses = power_stats->get_constant_c_misses();
+		s.tcache_hits = power_stats->get_texture_c_hits();
+		s.tcache_misses = power_stats->get_texture_c_misses();
+		s.shmem_read_access = power_stats->get_shmem_read_access();
 
-		wrapper->set_l1cache_power(power_stats->get_l1d_read_hits(), power_stats->get_l1d_read_misses(),
-				power_stats->get_l1d_write_hits(), power_stats->get_l1d_write_misses());
-
-
-		wrapper->set_l2cache_power(power_stats->get_l2_read_hits(), power_stats->get_l2_read_misses(),
-				power_stats->get_l2_write_hits(), power_stats->get_l2_write_misses());
+		s.l1d_read_hits = power_stats->get_l1d_read_hits();
+		s.l1d_read_misses = power_stats->get_l1d_read_misses();
+		s.l1d_write_hits = power_stats->get_l1d_write_hits();
+		s.l1d_write_misses = power_stats->get_l1d_write_misses();
 
+		s.l2_read_hits = power_stats->get_l2_read_hits();
+		s.l2_read_misses = power_stats->get_l2_read_misses();
+		s.l2_write_hits = power_stats->get_l2_write_hits();
+		s.l2_write_misses = power_stats->get_l2_write_misses();
 
 		float active_sms=(*power_stats->m_active_sms)/stat_sample_freq;
 		float num_cores = shdr_config->num_shader();
 		float num_idle_core = num_cores - active_sms;
-		wrapper->set_idle_core_power(num_idle_core);
+		s.num_idle_core = num_idle_core;
 
-		//pipeline power - pipeline_duty_cycle *= percent_active_sms;
 		float pipeline_duty_cycle=((*power_stats->m_average_pipeline_duty_cycle/( stat_sample_freq)) < 0.8)?((*power_stats->m_average_pipeline_duty_cycle)/stat_sample_freq):0.8;
-		wrapper->set_duty_cycle_power(pipeline_duty_cycle);
+		s.pipeline_duty_cycle = pipeline_duty_cycle;
 
-		//Memory Controller
-		wrapper->set_mem_ctrl_power(power_stats->get_dram_rd(), power_stats->get_dram_wr(), power_stats->get_dram_pre());
+		s.dram_rd = power_stats->get_dram_rd();
+		s.dram_wr = power_stats->get_dram_wr();
+		s.dram_pre = power_stats->get_dram_pre();
 
-		//Execution pipeline accesses
-		//FPU (SP) accesses, Integer ALU (not present in Tesla), Sfu accesses
-		wrapper->set_exec_unit_power(power_stats->get_tot_fpu_accessess(), power_stats->get_ialu_accessess(), power_stats->get_tot_sfu_accessess());
+		s.fpu_accesses = power_stats->get_tot_fpu_accessess();
+		s.ialu_accesses = power_stats->get_ialu_accessess();
+		s.sfu_accesses = power_stats->get_tot_sfu_accessess();
 
-		//Average active lanes for sp and sfu pipelines
 		float avg_sp_active_lanes=(power_stats->get_sp_active_lanes())/stat_sample_freq;
 		float avg_sfu_active_lanes=(power_stats->get_sfu_active_lanes())/stat_sample_freq;
 		assert(avg_sp_active_lanes<=32);
 		assert(avg_sfu_active_lanes<=32);
-		wrapper->set_active_lanes_power((power_stats->get_sp_active_lanes())/stat_sample_freq,
-				(power_stats->get_sfu_active_lanes())/stat_sample_freq);
-
+		s.sp_active_lanes = avg_sp_active_lanes;
+		s.sfu_active_lanes = avg_sfu_active_lanes;
 
-		double n_icnt_simt_to_mem = (double)power_stats->get_icnt_simt_to_mem(); // # flits from SIMT clusters to memory partitions
-		double n_icnt_mem_to_simt = (double)power_stats->get_icnt_mem_to_simt(); // # flits from memory partitions to SIMT clusters
-		wrapper->set_NoC_power(n_icnt_mem_to_simt, n_icnt_simt_to_mem); // Number of flits traversing the interconnect
+		s.icnt_simt_to_mem = (double)power_stats->get_icnt_simt_to_mem(); // # flits from SIMT clusters to memory partitions
+		s.icnt_mem_to_simt = (double)power_stats->get_icnt_mem_to_simt(); // # flits from memory partitions to SIMT clusters
 
-		wrapper->compute();
+		s.tot_sim_insn = tot_inst+inst;
+		s.cycle = (unsigned long long)tot_cycle+cycle;
 
-
-		wrapper->update_components_power();
-		wrapper->print_trace_files();
 		power_stats->save_stats();
 
-		wrapper->detect_print_steady_state(0,tot_inst+inst);
-
-		wrapper->power_metrics_calculations();
-
-
-		wrapper->dump();
+		if(g_power_eval_thread)
+			g_power_eval_thread->push(s);
+		else
+			evaluate_power_sample(wrapper,s);
 	}
 	//wrapper->close_files();
 }
 
+void mcpat_flush(){
+	if(g_power_eval_thread)
+		g_power_eval_thread->flush();
+	if(g_power_columnar_trace)
+		g_power_columnar_trace->flush();
+}
+
 void mcpat_reset_perf_count(class gpgpu_sim_wrapper *wrapper){
+	mcpat_flush();
 	wrapper->reset_counters();
 }
@@ -35,9 +35,37 @@
 
 #include "gpgpu_sim_wrapper.h"
 
+// The activity of one sampling interval, i.e. everything mcpat_cycle() hands
+// to the McPAT wrapper. Taken on the simulation thread so that it can be
+// evaluated later (and on another thread) without looking at power_stat_t.
+struct power_sample_t {
+   bool clock_gated_lanes;
+   double sample_cycles;
+   double tot_inst, int_inst, fp_inst, committed_inst;
+   double l1d_read_accesses, l1d_write_accesses;
+   double regfile_reads, regfile_writes, non_regfile_operands;
+   double icache_hits, icache_misses;
+   double ccache_hits, ccache_misses;
+   double tcache_hits, tcache_misses;
+   double shmem_read_access;
+   double l1d_read_hits, l1d_read_misses, l1d_write_hits, l1d_write_misses;
+   double l2_read_hits, l2_read_misses, l2_write_hits, l2_write_misses;
+   double num_idle_core;
+   double pipeline_duty_cycle;
+   double dram_rd, dram_wr, dram_pre;
+   double fpu_accesses, ialu_accesses, sfu_accesses;
+   double sp_active_lanes, sfu_active_lanes;
+   double icnt_mem_to_simt, icnt_simt_to_mem;
+   double tot_sim_insn; // for steady state detection
+   unsigned long long cycle; // tot_cycle+cycle, for the columnar trace
+};
+
 void init_mcpat(const gpgpu_sim_config &config, class gpgpu_sim_wrapper *wrapper, unsigned stat_sample_freq, unsigned tot_inst, unsigned inst);
 void mcpat_cycle(const gpgpu_sim_config &config, const struct shader_core_config *shdr_config, class gpgpu_sim_wrapper *wrapper, class power_stat_t *power_stats,
         unsigned stat_sample_freq, unsigned tot_cycle, unsigned cycle, unsigned tot_inst, unsigned inst);
+// Wait until every sample taken so far has been evaluated and written out;
+// needed before reading the wrapper's power totals when -power_async_eval is on.
+void mcpat_flush();
 void mcpat_reset_perf_count(class gpgpu_sim_wrapper *wrapper);
 
 #endif /* POWER_INTERFACE_H_ */
@@ -159,6 +159,23 @@ bool Scoreboard::checkCollision( unsigned wid, const class inst_t *inst ) const
 	return false;
 }
 
+// true if one of the registers of inst waits for a long operation (global,
+// local or texture load); only meaningful when checkCollision() is true
+bool Scoreboard::checkLongOpCollision( unsigned wid, const class inst_t *inst ) const
+{
+	const std::set<unsigned> &longops = longopregs[wid];
+	if( longops.empty() )
+		return false;
+	for( unsigned r=0; r < 4; r++ ) {
+		if( inst->out[r] > 0 && longops.count(inst->out[r]) ) return true;
+		if( inst->in[r] > 0 && longops.count(inst->in[r]) ) return true;
+	}
+	if( inst->pred > 0 && longops.count(inst->pred) ) return true;
+	if( inst->ar1 > 0 && longops.count(inst->ar1) ) return true;
+	if( inst->ar2 > 0 && longops.count(inst->ar2) ) return true;
+	return false;
+}
+
 bool Scoreboard::pendingWrites(unsigned wid) const
 {
 	return !reg_table[wid].empty();
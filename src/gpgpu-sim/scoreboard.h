@@ -45,6 +45,7 @@ public:
     void releaseRegister(unsigned wid, unsigned regnum);
 
     bool checkCollision(unsigned wid, const inst_t *inst) const;
+    bool checkLongOpCollision(unsigned wid, const inst_t *inst) const;
     bool pendingWrites(unsigned wid) const;
     void printContents() const;
     const bool islongop(unsigned warp_id, unsigned regnum);
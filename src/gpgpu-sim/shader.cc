@@ -46,6 +46,9 @@
 #include <limits.h>
 #include "traffic_breakdown.h"
 #include "shader_trace.h"
+#include "mem_trace.h"
+#include "host_prof.h"
+#include "stats_registry.h"
 
 #define PRIORITIZE_MSHR_OVER_WB 1
 #define MAX(a,b) (((a)>(b))?(a):(b))
@@ -76,6 +79,10 @@ shader_core_ctx::shader_core_ctx( class gpgpu_sim *gpu,
      m_barriers( this, config->max_warps_per_shader, config->max_cta_per_core, config->max_barriers_per_cta, config->warp_size ),
      m_dynamic_warp_id(0)
 {
+    m_sleeping = false;
+    m_sleep_stalled_schedulers = 0;
+    m_stall_sample_countdown = config->gpgpu_stall_sample_freq;
+    m_stall_sample_due = false;
     m_cluster = cluster;
     m_config = config;
     m_memory_config = mem_config;
@@ -300,6 +307,7 @@ shader_core_ctx::shader_core_ctx( class gpgpu_sim *gpu,
 
 void shader_core_ctx::reinit(unsigned start_thread, unsigned end_thread, bool reset_not_completed ) 
 {
+   wake();
    if( reset_not_completed ) {
        m_not_completed = 0;
        m_active_threads.reset();
@@ -334,6 +342,7 @@ void shader_core_ctx::init_warps( unsigned cta_id, unsigned start_thread, unsign
             }
             m_simt_stack[i]->launch(start_pc,active_threads);
             m_warp[i].init(start_pc,cta_id,i,active_threads, m_dynamic_warp_id);
+            schedulers[i%m_config->gpgpu_num_sched_per_core]->warp_initialized(i);
             ++m_dynamic_warp_id;
             m_not_completed += n_active;
       }
@@ -453,6 +462,65 @@ void shader_core_stats::print( FILE* fout ) const
    m_incoming_traffic_stats->print(fout); 
 }
 
+void shader_core_stats::register_stats( stats_registry &reg ) const
+{
+   static const struct {
+      const char *name;
+      unsigned *shader_core_stats_pod::*counts;
+   } per_core[] = {
+      { "num_sim_insn", &shader_core_stats_pod::m_num_sim_insn },
+      { "num_sim_winsn", &shader_core_stats_pod::m_num_sim_winsn },
+      { "num_decoded_insn", &shader_core_stats_pod::m_num_decoded_insn },
+      { "num_fp_decoded_insn", &shader_core_stats_pod::m_num_FPdecoded_insn },
+      { "num_int_decoded_insn", &shader_core_stats_pod::m_num_INTdecoded_insn },
+      { "num_sp_committed", &shader_core_stats_pod::m_num_sp_committed },
+      { "num_sfu_committed", &shader_core_stats_pod::m_num_sfu_committed },
+      { "num_mem_committed", &shader_core_stats_pod::m_num_mem_committed },
+      { "num_mem_accesses", &shader_core_stats_pod::m_num_mem_acesses },
+      { "read_regfile_accesses", &shader_core_stats_pod::m_read_regfile_acesses },
+      { "write_regfile_accesses", &shader_core_stats_pod::m_write_regfile_acesses },
+      { "n_diverge", &shader_core_stats_pod::m_n_diverge },
+      { "n_shmem_bank_access", &shader_core_stats_pod::gpgpu_n_shmem_bank_access },
+   };
+   for (unsigned i=0; i < m_config->num_shader(); i++) {
+      reg.add("core", i, "cycles", &shader_cycles[i]);
+      for (unsigned c=0; c < sizeof(per_core)/sizeof(per_core[0]); c++)
+         reg.add("core", i, per_core[c].name, &(this->*per_core[c].counts)[i]);
+      reg.add("core", i, "icnt_pkts_simt_to_mem", &n_simt_to_mem[i]);
+      reg.add("core", i, "icnt_pkts_mem_to_simt", &n_mem_to_simt[i]);
+   }
+
+   reg.add("shader", -1, "n_load_insn", &gpgpu_n_load_insn);
+   reg.add("shader", -1, "n_store_insn", &gpgpu_n_store_insn);
+   reg.add("shader", -1, "n_shmem_insn", &gpgpu_n_shmem_insn);
+   reg.add("shader", -1, "n_tex_insn", &gpgpu_n_tex_insn);
+   reg.add("shader", -1, "n_const_mem_insn", &gpgpu_n_const_insn);
+   reg.add("shader", -1, "n_param_mem_insn", &gpgpu_n_param_insn);
+   reg.add("shader", -1, "n_shmem_bkconflict", &gpgpu_n_shmem_bkconflict);
+   reg.add("shader", -1, "n_cache_bkconflict", &gpgpu_n_cache_bkconflict);
+   reg.add("shader", -1, "n_intrawarp_mshr_merge", &gpgpu_n_intrawarp_mshr_merge);
+   reg.add("shader", -1, "n_cmem_portconflict", &gpgpu_n_cmem_portconflict);
+   reg.add("shader", -1, "n_stall_shd_mem", &gpgpu_n_stall_shd_mem);
+   reg.add("shader", -1, "n_mem_read_local", &gpgpu_n_mem_read_local);
+   reg.add("shader", -1, "n_mem_write_local", &gpgpu_n_mem_write_local);
+   reg.add("shader", -1, "n_mem_read_global", &gpgpu_n_mem_read_global);
+   reg.add("shader", -1, "n_mem_write_global", &gpgpu_n_mem_write_global);
+   reg.add("shader", -1, "n_mem_texture", &gpgpu_n_mem_texture);
+   reg.add("shader", -1, "n_mem_const", &gpgpu_n_mem_const);
+   reg.add("shader", -1, "reg_bank_conflict_stalls", &gpu_reg_bank_conflict_stalls);
+
+   // the full breakdown that print() sums up partially, as stall_shd_mem.<access>_<stall>
+   static const char *access_str[N_MEM_STAGE_ACCESS_TYPE] = { "c_mem", "t_mem", "s_mem", "g_mem_ld", "l_mem_ld", "g_mem_st", "l_mem_st" };
+   static const char *stall_str[N_MEM_STAGE_STALL_TYPE] = { "no_rc_fail", "bk_conf", "mshr_rc", "icnt_rc", "coal_stall",
+                                                             "tlb_stall", "data_port_stall", "wb_icnt_rc", "wb_rsrv_fail" };
+   for (unsigned a=0; a < N_MEM_STAGE_ACCESS_TYPE; a++) {
+      for (unsigned r=1; r < N_MEM_STAGE_STALL_TYPE; r++) {
+         std::string name = std::string(access_str[a]) + "_" + stall_str[r];
+         reg.add("stall_shd_mem", -1, name.c_str(), &gpu_stall_shd_mem_breakdown[a][r]);
+      }
+   }
+}
+
 void shader_core_stats::event_warp_issued( unsigned s_id, unsigned warp_id, unsigned num_issued, unsigned dynamic_warp_id ) {
     assert( warp_id <= m_config->max_warps_per_shader );
     for ( unsigned i = 0; i < num_issued; ++i ) {
@@ -589,6 +657,7 @@ void shader_core_ctx::decode()
                }
            }
         }
+        schedulers[m_inst_fetch_buffer.m_warp_id%m_config->gpgpu_num_sched_per_core]->warp_decoded(m_inst_fetch_buffer.m_warp_id);
         m_inst_fetch_buffer.m_valid = false;
     }
 }
@@ -686,7 +755,11 @@ void shader_core_ctx::issue_warp( register_set& pipe_reg_set, const warp_inst_t*
     **pipe_reg = *next_inst; // static instruction information
     (*pipe_reg)->issue( active_mask, warp_id, gpu_tot_sim_cycle + gpu_sim_cycle, m_warp[warp_id].get_dynamic_warp_id() ); // dynamic instruction information
     m_stats->shader_cycle_distro[2+(*pipe_reg)->active_count()]++;
-    func_exec_inst( **pipe_reg );
+    TRACE_EVENT(WARP_ISSUE, m_sid, warp_id, next_inst->pc);
+    {
+        HOST_PROF_SCOPE(FUNC_EXEC);
+        func_exec_inst( **pipe_reg );
+    }
     if( next_inst->op == BARRIER_OP ){
     	m_warp[warp_id].store_info_of_last_inst_at_barrier(*pipe_reg);
         m_barriers.warp_reaches_barrier(m_warp[warp_id].get_cta_id(),warp_id,const_cast<warp_inst_t*> (next_inst));
@@ -703,7 +776,11 @@ void shader_core_ctx::issue_warp( register_set& pipe_reg_set, const warp_inst_t*
 void shader_core_ctx::issue(){
     //really is issue;
     for (unsigned i = 0; i < schedulers.size(); i++) {
+        if( m_stall_sample_due ) 
+            schedulers[i]->sample_stalls();
         schedulers[i]->cycle();
+        if( m_stall_sample_due ) 
+            schedulers[i]->commit_stall_sample();
     }
 }
 
@@ -806,6 +883,7 @@ void scheduler_unit::cycle()
     bool ready_inst = false;  // of the valid instructions, there was one not waiting for pending register writes
     bool issued_inst = false; // of these we issued one
 
+    m_issued_warp = -1;
     order_warps();
     for ( std::vector< shd_warp_t* >::const_iterator iter = m_next_cycle_prioritized_warps.begin();
           iter != m_next_cycle_prioritized_warps.end();
@@ -891,6 +969,7 @@ void scheduler_unit::cycle()
             checked++;
         }
         if ( issued ) {
+            m_issued_warp = warp_id;
             // This might be a bit inefficient, but we need to maintain
             // two ordered list for proper scheduler execution.
             // We could remove the need for this loop by associating a
@@ -927,6 +1006,92 @@ void scheduler_unit::do_on_warp_issued( unsigned warp_id,
     warp(warp_id).ibuffer_step();
 }
 
+// Mirrors the per-warp checks in cycle(), without changing any state.
+// Warps that have no CTA or have finished their threads are not sampled.
+void scheduler_unit::sample_stalls()
+{
+    m_issued_warp = -1;
+    m_stall_sample.clear();
+    for ( std::vector< shd_warp_t* >::const_iterator iter = m_supervised_warps.begin();
+          iter != m_supervised_warps.end();
+          ++iter ) {
+        shd_warp_t *w = *iter;
+        if ( w->done_exit() || w->functional_done() ) {
+            continue;
+        }
+        stall_sample_t sample;
+        unsigned rpc;
+        sample.warp_id = w->get_warp_id();
+        m_simt_stack[sample.warp_id]->get_pdom_stack_top_info(&sample.pc,&rpc);
+        const warp_inst_t *pI = w->ibuffer_empty()? NULL : w->ibuffer_next_inst();
+        if ( m_shader->warp_waiting_at_barrier(sample.warp_id) ) {
+            sample.reason = PTX_STALL_BARRIER;
+        } else if ( w->waiting() ) {
+            sample.reason = PTX_STALL_MEMBAR;
+        } else if ( w->ibuffer_empty() ) {
+            sample.reason = w->imiss_pending()? PTX_STALL_INST_FETCH : PTX_STALL_IBUFFER_EMPTY;
+        } else if ( !pI ) {
+            sample.reason = w->ibuffer_next_valid()? PTX_STALL_CONTROL_HAZARD : PTX_STALL_IBUFFER_EMPTY;
+        } else if ( sample.pc != pI->pc ) {
+            sample.reason = PTX_STALL_CONTROL_HAZARD;
+        } else if ( m_scoreboard->checkCollision(sample.warp_id, pI) ) {
+            sample.reason = m_scoreboard->checkLongOpCollision(sample.warp_id, pI)? PTX_STALL_SCOREBOARD_LONG : PTX_STALL_SCOREBOARD_SHORT;
+        } else if ( (pI->op == LOAD_OP) || (pI->op == STORE_OP) || (pI->op == MEMORY_BARRIER_OP) ) {
+            sample.reason = m_mem_out->has_free()? PTX_STALL_NOT_SELECTED : PTX_STALL_MEM_PIPE_FULL;
+        } else if ( m_sp_out->has_free() && (pI->op != SFU_OP) ) {
+            sample.reason = PTX_STALL_NOT_SELECTED;
+        } else if ( ((pI->op == SFU_OP) || (pI->op == ALU_SFU_OP)) && m_sfu_out->has_free() ) {
+            sample.reason = PTX_STALL_NOT_SELECTED;
+        } else {
+            sample.reason = PTX_STALL_EXEC_UNIT_BUSY;
+        }
+        m_stall_sample.push_back(sample);
+    }
+}
+
+void scheduler_unit::commit_stall_sample()
+{
+    for ( std::vector< stall_sample_t >::const_iterator s = m_stall_sample.begin(); s != m_stall_sample.end(); ++s ) {
+        enum ptx_stall_reason reason = (enum ptx_stall_reason)s->reason;
+        if ( (int)s->warp_id == m_issued_warp ) {
+            reason = PTX_STALL_ISSUED;
+        }
+        ptx_file_line_stats_add_stall(s->pc, reason);
+    }
+    m_stall_sample.clear();
+}
+
+// Mirrors the per-warp checks in cycle()
+bool scheduler_unit::can_sleep( bool &valid_inst )
+{
+    valid_inst = false;
+    const std::vector< shd_warp_t* > &candidates = issue_candidates();
+    for ( std::vector< shd_warp_t* >::const_iterator iter = candidates.begin();
+          iter != candidates.end();
+          ++iter ) {
+        shd_warp_t *w = *iter;
+        if ( w == NULL || w->done_exit() || w->waiting() || w->ibuffer_empty() ) {
+            continue;
+        }
+        unsigned warp_id = w->get_warp_id();
+        const warp_inst_t *pI = w->ibuffer_next_inst();
+        unsigned pc,rpc;
+        m_simt_stack[warp_id]->get_pdom_stack_top_info(&pc,&rpc);
+        if ( pI ) {
+            if ( pc != pI->pc ) {
+                return false; // control hazard flush
+            }
+            if ( !m_scoreboard->checkCollision(warp_id, pI) ) {
+                return false; // would issue
+            }
+            valid_inst = true;
+        } else if ( w->ibuffer_next_valid() ) {
+            return false; // return from diverged warp flush
+        }
+    }
+    return true;
+}
+
 bool scheduler_unit::sort_warps_by_oldest_dynamic_id(shd_warp_t* lhs, shd_warp_t* rhs)
 {
     if (rhs && lhs) {
@@ -950,14 +1115,54 @@ void lrr_scheduler::order_warps()
                m_supervised_warps.size() );
 }
 
+/**
+ * The greedy-then-oldest order only changes when a different warp issues or
+ * a warp is initialized with a new dynamic_warp_id, so the prioritized list
+ * is rebuilt on those events instead of being copied and re-sorted every cycle.
+ * Unlike sort_warps_by_oldest_dynamic_id, waiting and exited warps keep their
+ * place in age order rather than being moved to the back of the list. The
+ * issue loop in scheduler_unit::cycle() skips them either way, so the warp
+ * that issues is the same.
+ */
 void gto_scheduler::order_warps()
 {
-    order_by_priority( m_next_cycle_prioritized_warps,
-                       m_supervised_warps,
-                       m_last_supervised_issued,
-                       m_supervised_warps.size(),
-                       ORDERING_GREEDY_THEN_PRIORITY_FUNC,
-                       scheduler_unit::sort_warps_by_oldest_dynamic_id );
+    if ( !m_order_dirty ) {
+        return;
+    }
+    m_next_cycle_prioritized_warps.clear();
+    if ( m_greedy_warp ) {
+        m_next_cycle_prioritized_warps.push_back( m_greedy_warp );
+    }
+    for ( std::vector< shd_warp_t* >::const_iterator iter = m_age_ordered_warps.begin();
+          iter != m_age_ordered_warps.end();
+          ++iter ) {
+        if ( *iter != m_greedy_warp ) {
+            m_next_cycle_prioritized_warps.push_back( *iter );
+        }
+    }
+    m_order_dirty = false;
+}
+
+void gto_scheduler::warp_initialized( unsigned warp_id )
+{
+    shd_warp_t* w = &warp(warp_id);
+    std::vector< shd_warp_t* >::iterator iter
+        = std::find( m_age_ordered_warps.begin(), m_age_ordered_warps.end(), w );
+    assert( iter != m_age_ordered_warps.end() );
+    m_age_ordered_warps.erase( iter );
+    m_age_ordered_warps.push_back( w );
+    m_order_dirty = true;
+}
+
+void gto_scheduler::do_on_warp_issued( unsigned warp_id,
+                                       unsigned num_issued,
+                                       const std::vector< shd_warp_t* >::const_iterator& prioritized_iter )
+{
+    scheduler_unit::do_on_warp_issued( warp_id, num_issued, prioritized_iter );
+    if ( m_greedy_warp != &warp(warp_id) ) {
+        m_greedy_warp = &warp(warp_id);
+        m_order_dirty = true;
+    }
 }
 
 void
@@ -966,13 +1171,16 @@ two_level_active_scheduler::do_on_warp_issued( unsigned warp_id,
                                                const std::vector< shd_warp_t* >::const_iterator& prioritized_iter )
 {
     scheduler_unit::do_on_warp_issued( warp_id, num_issued, prioritized_iter );
+    recheck( warp_id );
     if ( SCHEDULER_PRIORITIZATION_LRR == m_inner_level_prioritization ) {
-        std::vector< shd_warp_t* > new_active; 
-        order_lrr( new_active,
-                   m_next_cycle_prioritized_warps,
-                   prioritized_iter,
-                   m_next_cycle_prioritized_warps.size() );
-        m_next_cycle_prioritized_warps = new_active;
+        // Same result as order_lrr() over the active list, rotated in place
+        // so that the issuing warp goes last without building a new vector.
+        std::vector< shd_warp_t* >::iterator new_front
+            = m_next_cycle_prioritized_warps.begin()
+              + ( prioritized_iter - m_next_cycle_prioritized_warps.begin() ) + 1;
+        std::rotate( m_next_cycle_prioritized_warps.begin(),
+                     new_front,
+                     m_next_cycle_prioritized_warps.end() );
     } else {
         fprintf( stderr,
                  "Unimplemented m_inner_level_prioritization: %d\n",
@@ -983,10 +1191,22 @@ two_level_active_scheduler::do_on_warp_issued( unsigned warp_id,
 
 void two_level_active_scheduler::order_warps()
 {
+    // Nothing issued, was decoded or was promoted since the last call, so
+    // no active warp can have started waiting
+    if ( !m_num_recheck )
+        return;
+
     //Move waiting warps to m_pending_warps
     unsigned num_demoted = 0;
     for (   std::vector< shd_warp_t* >::iterator iter = m_next_cycle_prioritized_warps.begin();
-            iter != m_next_cycle_prioritized_warps.end(); ) {
+            m_num_recheck && iter != m_next_cycle_prioritized_warps.end(); ) {
+        unsigned warp_id = (*iter)->get_warp_id();
+        if ( !m_recheck[warp_id] ) {
+            ++iter;
+            continue;
+        }
+        m_recheck[warp_id] = false;
+        --m_num_recheck;
         bool waiting = (*iter)->waiting();
         for (int i=0; i<4; i++){
             const warp_inst_t* inst = (*iter)->ibuffer_next_inst();
@@ -997,11 +1217,12 @@ void two_level_active_scheduler::order_warps()
         }
 
         if( waiting ) {
-            m_pending_warps.push_back(*iter);
-            iter = m_next_cycle_prioritized_warps.erase(iter);
             SCHED_DPRINTF( "DEMOTED warp_id=%d, dynamic_warp_id=%d\n",
                            (*iter)->get_warp_id(),
                            (*iter)->get_dynamic_warp_id() );
+            m_active[warp_id] = false;
+            m_pending_warps.push_back(*iter);
+            iter = m_next_cycle_prioritized_warps.erase(iter);
             ++num_demoted;
         } else {
             ++iter;
@@ -1014,6 +1235,8 @@ void two_level_active_scheduler::order_warps()
         while ( m_next_cycle_prioritized_warps.size() < m_max_active_warps ) {
             m_next_cycle_prioritized_warps.push_back(m_pending_warps.front());
             m_pending_warps.pop_front();
+            m_active[m_next_cycle_prioritized_warps.back()->get_warp_id()] = true;
+            recheck( m_next_cycle_prioritized_warps.back()->get_warp_id() );
             SCHED_DPRINTF( "PROMOTED warp_id=%d, dynamic_warp_id=%d\n",
                            (m_next_cycle_prioritized_warps.back())->get_warp_id(),
                            (m_next_cycle_prioritized_warps.back())->get_dynamic_warp_id() );
@@ -1225,14 +1448,20 @@ void shader_core_ctx::warp_inst_complete(const warp_inst_t &inst)
   inst.completed(gpu_tot_sim_cycle + gpu_sim_cycle);
 }
 
-void shader_core_ctx::writeback()
+// Duty cycle of the instructions committed since the previous cycle, for the
+// power model. Called once per cycle, by writeback() or sleep_cycle().
+void shader_core_ctx::update_pipeline_duty_cycle()
 {
-
 	unsigned max_committed_thread_instructions=m_config->warp_size * (m_config->pipe_widths[EX_WB]); //from the functional units
 	m_stats->m_pipeline_duty_cycle[m_sid]=((float)(m_stats->m_num_sim_insn[m_sid]-m_stats->m_last_num_sim_insn[m_sid]))/max_committed_thread_instructions;
 
     m_stats->m_last_num_sim_insn[m_sid]=m_stats->m_num_sim_insn[m_sid];
     m_stats->m_last_num_sim_winsn[m_sid]=m_stats->m_num_sim_winsn[m_sid];
+}
+
+void shader_core_ctx::writeback()
+{
+    update_pipeline_duty_cycle();
 
     warp_inst_t** preg = m_pipeline_reg[EX_WB].get_ready();
     warp_inst_t* pipe_reg = (preg==NULL)? NULL:*preg;
@@ -1306,7 +1535,7 @@ ldst_unit::process_cache_access( cache_t* cache,
         if ( inst.is_load() ) {
             for ( unsigned r=0; r < 4; r++)
                 if (inst.out[r] > 0)
-                    m_pending_writes[inst.warp_id()][inst.out[r]]--; 
+                    dec_pending_writes( inst.warp_id(), inst.out[r] );
         }
         if( !write_sent ) 
             delete mf;
@@ -1317,6 +1546,8 @@ ldst_unit::process_cache_access( cache_t* cache,
         delete mf;
     } else {
         assert( status == MISS || status == HIT_RESERVED );
+        if ( status == MISS )
+            TRACE_EVENT(L1_MISS, m_sid, address, inst.warp_id());
         //inst.clear_active( access.get_warp_mask() ); // threads in mf writeback when mf returns
         inst.accessq_pop_back();
     }
@@ -1408,7 +1639,7 @@ bool ldst_unit::memory_cycle( warp_inst_t &inst, mem_stage_stall_type &stall_rea
            if( inst.is_load() ) { 
               for( unsigned r=0; r < 4; r++) 
                   if(inst.out[r] > 0) 
-                      assert( m_pending_writes[inst.warp_id()][inst.out[r]] > 0 );
+                      assert( get_pending_writes(inst.warp_id(),inst.out[r]) > 0 );
            } else if( inst.is_store() ) 
               m_core->inc_store_req( inst.warp_id() );
        }
@@ -1586,6 +1817,44 @@ void ldst_unit::init( mem_fetch_interface *icnt,
     m_next_global=NULL;
     m_last_inst_gpu_sim_cycle=0;
     m_last_inst_gpu_tot_sim_cycle=0;
+    assert( m_config->max_warps_per_shader <= WARP_PER_CTA_MAX );
+    m_pending_writes_regs=0;
+    m_num_pending_regs.assign(m_config->max_warps_per_shader,0);
+    m_warps_with_pending_writes.reset();
+}
+
+void ldst_unit::add_pending_writes( unsigned warp_id, unsigned reg_id, unsigned count )
+{
+    if( count == 0 ) 
+        return;
+    if( reg_id >= m_pending_writes_regs ) 
+        grow_pending_writes(reg_id);
+    unsigned &pending = m_pending_writes[warp_id*m_pending_writes_regs+reg_id];
+    if( pending == 0 && m_num_pending_regs[warp_id]++ == 0 ) 
+        m_warps_with_pending_writes.set(warp_id);
+    pending += count;
+}
+
+// returns the number of writes still pending for the register
+unsigned ldst_unit::dec_pending_writes( unsigned warp_id, unsigned reg_id )
+{
+    assert( get_pending_writes(warp_id,reg_id) > 0 );
+    unsigned &pending = m_pending_writes[warp_id*m_pending_writes_regs+reg_id];
+    if( --pending == 0 && --m_num_pending_regs[warp_id] == 0 ) 
+        m_warps_with_pending_writes.reset(warp_id);
+    return pending;
+}
+
+void ldst_unit::grow_pending_writes( unsigned reg_id )
+{
+    unsigned num_regs = std::max( reg_id+1, 2*m_pending_writes_regs );
+    std::vector<unsigned> table( m_num_pending_regs.size()*num_regs, 0 );
+    for( unsigned w=0; w < m_num_pending_regs.size(); w++ ) 
+        std::copy( m_pending_writes.begin() + w*m_pending_writes_regs,
+                   m_pending_writes.begin() + (w+1)*m_pending_writes_regs,
+                   table.begin() + w*num_regs );
+    m_pending_writes.swap(table);
+    m_pending_writes_regs = num_regs;
 }
 
 
@@ -1660,7 +1929,7 @@ void ldst_unit:: issue( register_set &reg_set )
       for (unsigned r = 0; r < 4; r++) {
          unsigned reg_id = inst->out[r];
          if (reg_id > 0) {
-            m_pending_writes[warp_id][reg_id] += n_accesses;
+            add_pending_writes(warp_id, reg_id, n_accesses);
          }
       }
    }
@@ -1682,10 +1951,8 @@ void ldst_unit::writeback()
             for( unsigned r=0; r < 4; r++ ) {
                 if( m_next_wb.out[r] > 0 ) {
                     if( m_next_wb.space.get_type() != shared_space ) {
-                        assert( m_pending_writes[m_next_wb.warp_id()][m_next_wb.out[r]] > 0 );
-                        unsigned still_pending = --m_pending_writes[m_next_wb.warp_id()][m_next_wb.out[r]];
+                        unsigned still_pending = dec_pending_writes( m_next_wb.warp_id(), m_next_wb.out[r] );
                         if( !still_pending ) {
-                            m_pending_writes[m_next_wb.warp_id()].erase(m_next_wb.out[r]);
                             m_scoreboard->releaseRegister( m_next_wb.warp_id(), m_next_wb.out[r] );
                             insn_completed = true; 
                         }
@@ -1769,6 +2036,24 @@ unsigned ldst_unit::clock_multiplier() const
 { 
     return m_config->mem_warp_parts; 
 }
+
+bool ldst_unit::idle() const
+{
+    // occupied is never shifted for this unit, so it is not checked here
+    if( !m_dispatch_reg->empty() || !m_next_wb.empty() || m_next_global || !m_response_fifo.empty() )
+        return false;
+    for( unsigned stage=0; stage<m_pipeline_depth; stage++ )
+        if( !m_pipeline_reg[stage]->empty() )
+            return false;
+    return m_L1T->idle() && m_L1C->idle() && (!m_L1D || m_L1D->idle());
+}
+
+void ldst_unit::idle_cycle()
+{
+    m_operand_collector->idle_cycle();
+    m_L1C->idle_cycle();
+    if( m_L1D ) m_L1D->idle_cycle();
+}
 /*
 void ldst_unit::issue( register_set &reg_set )
 {
@@ -1784,7 +2069,7 @@ void ldst_unit::issue( register_set &reg_set )
       for (unsigned r = 0; r < 4; r++) {
          unsigned reg_id = inst->out[r]; 
          if (reg_id > 0) {
-            m_pending_writes[warp_id][reg_id] += n_accesses; 
+            add_pending_writes(warp_id, reg_id, n_accesses);
          }
       }
    }
@@ -1884,14 +2169,9 @@ void ldst_unit::cycle()
                for( unsigned r=0; r<4; r++ ) {
                    unsigned reg_id = pipe_reg.out[r];
                    if( reg_id > 0 ) {
-                       if( m_pending_writes[warp_id].find(reg_id) != m_pending_writes[warp_id].end() ) {
-                           if ( m_pending_writes[warp_id][reg_id] > 0 ) {
-                               pending_requests=true;
-                               break;
-                           } else {
-                               // this instruction is done already
-                               m_pending_writes[warp_id].erase(reg_id); 
-                           }
+                       if( get_pending_writes(warp_id,reg_id) > 0 ) {
+                           pending_requests=true;
+                           break;
                        }
                    }
                }
@@ -2269,16 +2549,14 @@ void ldst_unit::print(FILE *fout) const
     fprintf(fout, "Last LD/ST writeback @ %llu + %llu (gpu_sim_cycle+gpu_tot_sim_cycle)\n",
                   m_last_inst_gpu_sim_cycle, m_last_inst_gpu_tot_sim_cycle );
     fprintf(fout,"Pending register writes:\n");
-    std::map<unsigned/*warp_id*/, std::map<unsigned/*regnum*/,unsigned/*count*/> >::const_iterator w;
-    for( w=m_pending_writes.begin(); w!=m_pending_writes.end(); w++ ) {
-        unsigned warp_id = w->first;
-        const std::map<unsigned/*regnum*/,unsigned/*count*/> &warp_info = w->second;
-        if( warp_info.empty() ) 
+    for( unsigned warp_id=0; warp_id < m_num_pending_regs.size(); warp_id++ ) {
+        if( !m_warps_with_pending_writes.test(warp_id) ) 
             continue;
         fprintf(fout,"  w%2u : ", warp_id );
-        std::map<unsigned/*regnum*/,unsigned/*count*/>::const_iterator r;
-        for( r=warp_info.begin(); r!=warp_info.end(); ++r ) {
-            fprintf(fout,"  %u(%u)", r->first, r->second );
+        for( unsigned r=0; r < m_pending_writes_regs; r++ ) {
+            unsigned count = get_pending_writes(warp_id,r);
+            if( count ) 
+                fprintf(fout,"  %u(%u)", r, count );
         }
         fprintf(fout,"\n");
     }
@@ -2442,12 +2720,86 @@ unsigned int shader_core_config::max_cta( const kernel_info_t &k ) const
 void shader_core_ctx::cycle()
 {
 	m_stats->shader_cycles[m_sid]++;
-    writeback();
-    execute();
-    read_operands();
-    issue();
-    decode();
-    fetch();
+    m_stall_sample_due = false;
+    if( m_config->gpgpu_stall_sample_freq && --m_stall_sample_countdown == 0 ) {
+        m_stall_sample_countdown = m_config->gpgpu_stall_sample_freq;
+        m_stall_sample_due = true;
+    }
+    if( m_sleeping ) {
+        sleep_cycle();
+        return;
+    }
+    { HOST_PROF_SCOPE(WRITEBACK); writeback(); }
+    { HOST_PROF_SCOPE(EXECUTE); execute(); }
+    { HOST_PROF_SCOPE(READ_OPERANDS); read_operands(); }
+    { HOST_PROF_SCOPE(ISSUE); issue(); }
+    { HOST_PROF_SCOPE(DECODE); decode(); }
+    { HOST_PROF_SCOPE(FETCH); fetch(); }
+    if( m_config->gpgpu_shader_core_sleep )
+        m_sleeping = can_sleep();
+}
+
+/*
+ * A core may sleep when running the pipeline again would not change any state
+ * other than per-cycle statistics: nothing is in the pipeline or in flight
+ * inside the core, no warp can fetch or exit, and every warp that could issue
+ * is blocked on the scoreboard, at a barrier or on outstanding memory
+ * operations. Only a fill (accept_fetch_response/accept_ldst_unit_response) or
+ * a new CTA can change that; barriers are released by an issuing warp, which
+ * cannot happen while asleep.
+ */
+bool shader_core_ctx::can_sleep()
+{
+    if( m_inst_fetch_buffer.m_valid )
+        return false;
+    for( unsigned i=0; i < m_pipeline_reg.size(); i++ )
+        if( m_pipeline_reg[i].has_ready() )
+            return false;
+    for( unsigned i=0; i < num_result_bus; i++ )
+        if( m_result_bus[i]->any() )
+            return false;
+    for( unsigned n=0; n < m_num_function_units; n++ )
+        if( !m_fu[n]->idle() )
+            return false;
+    if( !m_operand_collector.idle() || !m_L1I->idle() )
+        return false;
+
+    for( unsigned i=0; i < m_config->max_warps_per_shader; i++ ) {
+        // see fetch(): would exit or fetch
+        if( m_warp[i].hardware_done() && !m_scoreboard->pendingWrites(i) && !m_warp[i].done_exit() )
+            return false;
+        if( !m_warp[i].functional_done() && !m_warp[i].imiss_pending() && m_warp[i].ibuffer_empty() )
+            return false;
+    }
+
+    unsigned stalled_schedulers = 0;
+    for( unsigned i=0; i < schedulers.size(); i++ ) {
+        bool valid_inst = false;
+        if( !schedulers[i]->can_sleep(valid_inst) )
+            return false;
+        if( valid_inst )
+            stalled_schedulers++;
+    }
+    m_sleep_stalled_schedulers = stalled_schedulers;
+    return true;
+}
+
+// Charges the statistics and round-robin state an idle cycle() would have
+void shader_core_ctx::sleep_cycle()
+{
+    update_pipeline_duty_cycle();
+    for( unsigned c=0; c < m_ldst_unit->clock_multiplier(); c++ )
+        m_ldst_unit->idle_cycle();
+    m_stats->shader_cycle_distro[0] += schedulers.size() - m_sleep_stalled_schedulers;
+    m_stats->shader_cycle_distro[1] += m_sleep_stalled_schedulers;
+    m_L1I->idle_cycle();
+    if( m_stall_sample_due ) {
+        // nothing can issue while asleep
+        for( unsigned i=0; i < schedulers.size(); i++ ) {
+            schedulers[i]->sample_stalls();
+            schedulers[i]->commit_stall_sample();
+        }
+    }
 }
 
 // Flushes all content of the cache to memory
@@ -2785,6 +3137,7 @@ bool shader_core_ctx::fetch_unit_response_buffer_full() const
 
 void shader_core_ctx::accept_fetch_response( mem_fetch *mf )
 {
+    wake();
     mf->set_status(IN_SHADER_FETCHED,gpu_sim_cycle+gpu_tot_sim_cycle);
     m_L1I->fill(mf,gpu_sim_cycle+gpu_tot_sim_cycle);
 }
@@ -2796,6 +3149,7 @@ bool shader_core_ctx::ldst_unit_response_buffer_full() const
 
 void shader_core_ctx::accept_ldst_unit_response(mem_fetch * mf) 
 {
+   wake();
    m_ldst_unit->fill(mf);
 }
 
@@ -3082,6 +3436,14 @@ void opndcoll_rfu_t::allocate_reads()
   }
 } 
 
+bool opndcoll_rfu_t::idle() const
+{
+   for( unsigned n=0; n < m_cu.size(); n++ )
+      if( !m_cu[n]->is_free() )
+         return false;
+   return true;
+}
+
 bool opndcoll_rfu_t::collector_unit_t::ready() const 
 { 
    return (!m_free) && m_not_ready.none() && (*m_output_register).has_free(); 
@@ -3294,6 +3656,8 @@ void simt_core_cluster::icnt_inject_request_packet(class mem_fetch *mf)
    m_stats->m_outgoing_traffic_stats->record_traffic(mf, packet_size); 
    unsigned destination = mf->get_sub_partition_id();
    mf->set_status(IN_ICNT_TO_MEM,gpu_sim_cycle+gpu_tot_sim_cycle);
+   if (m_gpu->get_mem_trace())
+      m_gpu->get_mem_trace()->record(MEM_TRACE_REQ_INJECT,mf,gpu_sim_cycle+gpu_tot_sim_cycle);
    if (!mf->get_is_write() && !mf->isatomic())
       ::icnt_push(m_cluster_id, m_config->mem2device(destination), (void*)mf, mf->get_ctrl_size() );
    else 
@@ -3333,6 +3697,8 @@ void simt_core_cluster::icnt_cycle()
         unsigned int packet_size = (mf->get_is_write())? mf->get_ctrl_size() : mf->size(); 
         m_stats->m_incoming_traffic_stats->record_traffic(mf, packet_size); 
         mf->set_status(IN_CLUSTER_TO_SHADER_QUEUE,gpu_sim_cycle+gpu_tot_sim_cycle);
+        if (m_gpu->get_mem_trace())
+            m_gpu->get_mem_trace()->record(MEM_TRACE_REPLY_ARRIVE,mf,gpu_sim_cycle+gpu_tot_sim_cycle);
         //m_memory_stats->memlatstat_read_done(mf,m_shader_config->max_warps_per_shader);
         m_response_fifo.push_back(mf);
         m_stats->n_mem_to_simt[m_cluster_id] += mf->get_num_flits(false);
@@ -3380,6 +3746,35 @@ void simt_core_cluster::get_cache_stats(cache_stats &cs) const{
     }
 }
 
+enum { CLUSTER_L1I, CLUSTER_L1D, CLUSTER_L1C, CLUSTER_L1T, NUM_CLUSTER_L1 };
+
+static const char *cluster_cache_stat_str[] = { "accesses", "misses", "pending_hits", "reservation_fails" };
+
+template<int L1>
+static void cluster_cache_stats( const void *obj, unsigned instance, double *values )
+{
+   const simt_core_cluster *cluster = (const simt_core_cluster*)obj;
+   struct cache_sub_stats css;
+   switch (L1) {
+   case CLUSTER_L1I: cluster->get_L1I_sub_stats(css); break;
+   case CLUSTER_L1D: cluster->get_L1D_sub_stats(css); break;
+   case CLUSTER_L1C: cluster->get_L1C_sub_stats(css); break;
+   case CLUSTER_L1T: cluster->get_L1T_sub_stats(css); break;
+   }
+   values[0] = css.accesses;
+   values[1] = css.misses;
+   values[2] = css.pending_hits;
+   values[3] = css.res_fails;
+}
+
+void simt_core_cluster::register_stats( stats_registry &reg ) const
+{
+   reg.add_group("l1i", m_cluster_id, cluster_cache_stat_str, 4, true, &cluster_cache_stats<CLUSTER_L1I>, this);
+   reg.add_group("l1d", m_cluster_id, cluster_cache_stat_str, 4, true, &cluster_cache_stats<CLUSTER_L1D>, this);
+   reg.add_group("l1c", m_cluster_id, cluster_cache_stat_str, 4, true, &cluster_cache_stats<CLUSTER_L1C>, this);
+   reg.add_group("l1t", m_cluster_id, cluster_cache_stat_str, 4, true, &cluster_cache_stats<CLUSTER_L1T>, this);
+}
+
 void simt_core_cluster::get_L1I_sub_stats(struct cache_sub_stats &css) const{
     struct cache_sub_stats temp_css;
     struct cache_sub_stats total_css;
@@ -309,7 +309,7 @@ public:
                    int id) 
         : m_supervised_warps(), m_stats(stats), m_shader(shader),
         m_scoreboard(scoreboard), m_simt_stack(simt), /*m_pipeline_reg(pipe_regs),*/ m_warp(warp),
-        m_sp_out(sp_out),m_sfu_out(sfu_out),m_mem_out(mem_out), m_id(id){}
+        m_sp_out(sp_out),m_sfu_out(sfu_out),m_mem_out(mem_out), m_id(id), m_issued_warp(-1){}
     virtual ~scheduler_unit(){}
     virtual void add_supervised_warp_id(int i) {
         m_supervised_warps.push_back(&warp(i));
@@ -317,6 +317,13 @@ public:
     virtual void done_adding_supervised_warps() {
         m_last_supervised_issued = m_supervised_warps.end();
     }
+    // Called after a supervised warp has been (re)initialized with a new
+    // dynamic_warp_id. Schedulers that keep their ordering incrementally
+    // use this to update it.
+    virtual void warp_initialized( unsigned warp_id ) {}
+    // Called after decode placed new instructions in a supervised warp's
+    // instruction buffer.
+    virtual void warp_decoded( unsigned warp_id ) {}
 
 
     // The core scheduler cycle method is meant to be common between
@@ -355,6 +362,21 @@ public:
     // m_supervised_warps with their scheduling policies
     virtual void order_warps() = 0;
 
+    // Returns true if cycle() can neither issue nor change any state until
+    // something outside the scheduler changes (e.g. a register is released).
+    // valid_inst is set to the value cycle() would compute for the issue
+    // stall statistics.
+    virtual bool can_sleep( bool &valid_inst );
+    // The warps cycle() would consider for issue; can_sleep() checks only these
+    virtual const std::vector< shd_warp_t* >& issue_candidates() { return m_supervised_warps; }
+
+    // Stall sampling (-gpgpu_stall_sample_freq): sample_stalls() records why
+    // each supervised warp could or could not issue, before cycle() changes
+    // any state; commit_stall_sample() charges the sample to each warp's pc
+    // once cycle() has picked the warp that issues.
+    void sample_stalls();
+    void commit_stall_sample();
+
 protected:
     virtual void do_on_warp_issued( unsigned warp_id,
                                     unsigned num_issued,
@@ -385,6 +407,14 @@ protected:
     register_set* m_mem_out;
 
     int m_id;
+
+    int m_issued_warp; // warp that issued in the last cycle(), -1 if none
+    struct stall_sample_t {
+        unsigned warp_id;
+        address_type pc;
+        unsigned reason; // enum ptx_stall_reason
+    };
+    std::vector< stall_sample_t > m_stall_sample;
 };
 
 class lrr_scheduler : public scheduler_unit {
@@ -413,13 +443,32 @@ public:
                     register_set* sfu_out,
                     register_set* mem_out,
                     int id )
-	: scheduler_unit ( stats, shader, scoreboard, simt, warp, sp_out, sfu_out, mem_out, id ){}
+	: scheduler_unit ( stats, shader, scoreboard, simt, warp, sp_out, sfu_out, mem_out, id ),
+	  m_age_ordered_warps(), m_greedy_warp(NULL), m_order_dirty(true) {}
 	virtual ~gto_scheduler () {}
 	virtual void order_warps ();
     virtual void done_adding_supervised_warps() {
         m_last_supervised_issued = m_supervised_warps.begin();
+        m_age_ordered_warps = m_supervised_warps;
+        m_greedy_warp = m_supervised_warps.empty() ? NULL : m_supervised_warps.front();
+        m_order_dirty = true;
     }
+    virtual void warp_initialized( unsigned warp_id );
+
+protected:
+    virtual void do_on_warp_issued( unsigned warp_id,
+                                    unsigned num_issued,
+                                    const std::vector< shd_warp_t* >::const_iterator& prioritized_iter );
 
+private:
+    // The supervised warps, oldest dynamic_warp_id first. Dynamic ids only
+    // grow, so a newly initialized warp simply moves to the back.
+    std::vector< shd_warp_t* > m_age_ordered_warps;
+    // The warp that issued last; it gets the highest priority
+    shd_warp_t* m_greedy_warp;
+    // Set when m_greedy_warp or m_age_ordered_warps changed since the
+    // prioritized list was last built
+    bool m_order_dirty;
 };
 
 
@@ -434,7 +483,7 @@ public:
                           int id,
                           char* config_str )
 	: scheduler_unit ( stats, shader, scoreboard, simt, warp, sp_out, sfu_out, mem_out, id ),
-	  m_pending_warps() 
+	  m_pending_warps(), m_active(), m_recheck(), m_num_recheck(0)
     {
         unsigned inner_level_readin;
         unsigned outer_level_readin; 
@@ -450,8 +499,14 @@ public:
 	virtual ~two_level_active_scheduler () {}
     virtual void order_warps();
 	void add_supervised_warp_id(int i) {
+        if ( m_recheck.size() <= (unsigned)i ) {
+            m_active.resize( i + 1, false );
+            m_recheck.resize( i + 1, false );
+        }
         if ( m_next_cycle_prioritized_warps.size() < m_max_active_warps ) {
             m_next_cycle_prioritized_warps.push_back( &warp(i) );
+            m_active[i] = true;
+            recheck( i );
         } else {
 		    m_pending_warps.push_back(&warp(i));
         }
@@ -459,6 +514,10 @@ public:
     virtual void done_adding_supervised_warps() {
         m_last_supervised_issued = m_supervised_warps.begin();
     }
+    virtual void warp_initialized( unsigned warp_id ) { recheck( warp_id ); }
+    virtual void warp_decoded( unsigned warp_id ) { recheck( warp_id ); }
+    // order_warps() keeps demoting and promoting warps while they stall
+    virtual bool can_sleep( bool &valid_inst ) { return false; }
 
 protected:
     virtual void do_on_warp_issued( unsigned warp_id,
@@ -466,7 +525,23 @@ protected:
                                     const std::vector< shd_warp_t* >::const_iterator& prioritized_iter );
 
 private:
+    void recheck( unsigned warp_id ) {
+        if ( m_active[warp_id] && !m_recheck[warp_id] ) {
+            m_recheck[warp_id] = true;
+            ++m_num_recheck;
+        }
+    }
+
 	std::deque< shd_warp_t* > m_pending_warps;
+    // Active warps whose demotion test has to be evaluated again. An active
+    // warp only starts waiting (at a barrier or membar, on an atomic, on a
+    // long-latency register or because its threads exited) when it issues
+    // or when decode refills its instruction buffer; barrier and scoreboard
+    // releases only ever end a wait. Both are indexed by warp id; pending
+    // warps are not tested, so they are never marked.
+    std::vector<bool> m_active;
+    std::vector<bool> m_recheck;
+    unsigned m_num_recheck;
     scheduler_prioritization_type m_inner_level_prioritization;
     scheduler_prioritization_type m_outer_level_prioritization;
 	unsigned m_max_active_warps;
@@ -488,6 +563,11 @@ public:
     virtual void done_adding_supervised_warps() {
         m_last_supervised_issued = m_supervised_warps.begin();
     }
+    // only the first m_num_warps_to_limit warps in priority order may issue
+    virtual const std::vector< shd_warp_t* >& issue_candidates() {
+        order_warps();
+        return m_next_cycle_prioritized_warps;
+    }
 
 protected:
     scheduler_prioritization_type m_prioritization;
@@ -536,6 +616,11 @@ public:
 
    shader_core_ctx *shader_core() { return m_shader; }
 
+   // true if no collector unit is allocated
+   bool idle() const;
+   // account for a step() with no collector unit allocated
+   void idle_cycle() { m_arbiter.idle_cycle(); }
+
 private:
 
    void process_banks()
@@ -746,6 +831,11 @@ private:
          for( unsigned b=0; b < m_num_banks; b++ ) 
             m_allocated_bank[b].reset();
       }
+      // allocate_reads() rotates the priority diagonal even with no requests
+      void idle_cycle()
+      {
+         m_last_cu = ( m_last_cu + 1 ) % std::max( m_num_banks, m_num_collectors );
+      }
 
    private:
       unsigned m_num_banks;
@@ -970,6 +1060,8 @@ public:
     virtual unsigned clock_multiplier() const { return 1; }
     virtual bool can_issue( const warp_inst_t &inst ) const { return m_dispatch_reg->empty() && !occupied.test(inst.latency); }
     virtual bool stallable() const = 0;
+    // true if cycle() would not change any state
+    virtual bool idle() const { return m_dispatch_reg->empty() && occupied.none(); }
     virtual void print( FILE *fp ) const
     {
         fprintf(fp,"%s dispatch= ", m_name.c_str() );
@@ -1015,6 +1107,13 @@ public:
     {
         return simd_function_unit::can_issue(inst);
     }
+    virtual bool idle() const
+    {
+        for( unsigned stage=0; stage<m_pipeline_depth; stage++ )
+            if( !m_pipeline_reg[stage]->empty() )
+                return false;
+        return simd_function_unit::idle();
+    }
     virtual void print(FILE *fp) const
     {
         simd_function_unit::print(fp);
@@ -1109,6 +1208,9 @@ public:
 
     virtual void active_lanes_in_pipeline();
     virtual bool stallable() const { return true; }
+    virtual bool idle() const;
+    // account for a cycle() on an idle unit without running it
+    void idle_cycle();
     bool response_buffer_full() const;
     void print(FILE *fout) const;
     void print_cache_stats( FILE *fp, unsigned& dl1_accesses, unsigned& dl1_misses );
@@ -1156,6 +1258,15 @@ protected:
                                                       enum cache_request_status status );
    mem_stage_stall_type process_memory_access_queue( cache_t *cache, warp_inst_t &inst );
 
+   // pending register writes
+   unsigned get_pending_writes( unsigned warp_id, unsigned reg_id ) const
+   {
+      return reg_id < m_pending_writes_regs ? m_pending_writes[warp_id*m_pending_writes_regs+reg_id] : 0;
+   }
+   void add_pending_writes( unsigned warp_id, unsigned reg_id, unsigned count );
+   unsigned dec_pending_writes( unsigned warp_id, unsigned reg_id );
+   void grow_pending_writes( unsigned reg_id );
+
    const memory_config *m_memory_config;
    class mem_fetch_interface *m_icnt;
    shader_core_mem_fetch_allocator *m_mf_allocator;
@@ -1166,7 +1277,13 @@ protected:
    tex_cache *m_L1T; // texture cache
    read_only_cache *m_L1C; // constant cache
    l1_cache *m_L1D; // data cache
-   std::map<unsigned/*warp_id*/, std::map<unsigned/*regnum*/,unsigned/*count*/> > m_pending_writes;
+   // Outstanding memory accesses per destination register, as a dense
+   // [warp][regnum] table. Rows are widened at issue when a higher register
+   // number shows up, so the load completion path never allocates.
+   std::vector<unsigned> m_pending_writes;
+   unsigned m_pending_writes_regs; // row length of m_pending_writes
+   std::vector<unsigned> m_num_pending_regs; // per warp: registers with a nonzero count
+   warp_set_t m_warps_with_pending_writes;
    std::list<mem_fetch*> m_response_fifo;
    opndcoll_rfu_t *m_operand_collector;
    Scoreboard *m_scoreboard;
@@ -1325,6 +1442,8 @@ struct shader_core_config : public core_config
     unsigned ldst_unit_response_queue_size;
 
     int simt_core_sim_order; 
+    bool gpgpu_shader_core_sleep;
+    unsigned gpgpu_stall_sample_freq; // cycles between stall reason samples (0 = off)
     
     unsigned mem2device(unsigned memid) const { return memid + n_simt_clusters; }
 };
@@ -1486,6 +1605,7 @@ public:
     void visualizer_print( gzFile visualizer_file );
 
     void print( FILE *fout ) const;
+    void register_stats( class stats_registry &reg ) const;
 
     const std::vector< std::vector<unsigned> >& get_dynamic_warp_issue() const
     {
@@ -1575,6 +1695,7 @@ public:
     void reinit(unsigned start_thread, unsigned end_thread, bool reset_not_completed );
     void issue_block2core( class kernel_info_t &kernel );
     void cache_flush();
+    void wake() { m_sleeping = false; }
     void accept_fetch_response( mem_fetch *mf );
     void accept_ldst_unit_response( class mem_fetch * mf );
     void broadcast_barrier_reduction(unsigned cta_id, unsigned bar_id,warp_set_t warps);
@@ -1768,6 +1889,10 @@ public:
     void execute();
     
     void writeback();
+
+    bool can_sleep();
+    void sleep_cycle();
+    void update_pipeline_duty_cycle();
     
     // used in display_pipeline():
     void dump_warp_state( FILE *fout ) const;
@@ -1831,6 +1956,15 @@ public:
     // is that the dynamic_warp_id is a running number unique to every warp
     // run on this shader, where the warp_id is the static warp slot.
     unsigned m_dynamic_warp_id;
+
+    // sleep state: set when the core provably cannot make progress until a
+    // memory response arrives or a CTA is issued to it
+    bool m_sleeping;
+    unsigned m_sleep_stalled_schedulers; // schedulers with a valid but blocked instruction
+
+    // stall sampling, see scheduler_unit::sample_stalls()
+    unsigned m_stall_sample_countdown;
+    bool m_stall_sample_due; // this cycle is sampled
 };
 
 class simt_core_cluster {
@@ -1877,6 +2011,7 @@ public:
     void get_L1T_sub_stats(struct cache_sub_stats &css) const;
 
     void get_icnt_stats(long &n_simt_to_mem, long &n_mem_to_simt) const;
+    void register_stats( class stats_registry &reg ) const;
 
 private:
     unsigned m_cluster_id;
@@ -0,0 +1,528 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Wilson W.L. Fung
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "stats_log.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <zlib.h>
+#include <algorithm>
+
+static const unsigned trailer_size = 16; // u64 footer offset + magic
+
+static inline unsigned long long zigzag( long long v )
+{
+   return ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63);
+}
+
+static inline long long unzigzag( unsigned long long v )
+{
+   return (long long)(v >> 1) ^ -(long long)(v & 1);
+}
+
+static inline void put_varint( std::vector<unsigned char> &buf, unsigned long long v )
+{
+   while( v >= 0x80 ) {
+      buf.push_back( (unsigned char)(v | 0x80) );
+      v >>= 7;
+   }
+   buf.push_back( (unsigned char)v );
+}
+
+static inline bool get_varint( const std::vector<unsigned char> &buf, unsigned &pos, unsigned long long &v )
+{
+   v = 0;
+   for( unsigned shift=0; shift < 64; shift += 7 ) {
+      if( pos >= buf.size() )
+         return false;
+      unsigned char b = buf[pos++];
+      v |= (unsigned long long)(b & 0x7f) << shift;
+      if( !(b & 0x80) )
+         return true;
+   }
+   return false;
+}
+
+static void put_u32( std::vector<unsigned char> &buf, unsigned v )
+{
+   for( unsigned i=0; i < 4; i++ )
+      buf.push_back( (unsigned char)(v >> (8*i)) );
+}
+
+static void put_u64( std::vector<unsigned char> &buf, unsigned long long v )
+{
+   for( unsigned i=0; i < 8; i++ )
+      buf.push_back( (unsigned char)(v >> (8*i)) );
+}
+
+static bool get_u32( const std::vector<unsigned char> &buf, unsigned &pos, unsigned &v )
+{
+   if( pos + 4 > buf.size() )
+      return false;
+   v = 0;
+   for( unsigned i=0; i < 4; i++ )
+      v |= (unsigned)buf[pos++] << (8*i);
+   return true;
+}
+
+static bool get_u64( const std::vector<unsigned char> &buf, unsigned &pos, unsigned long long &v )
+{
+   if( pos + 8 > buf.size() )
+      return false;
+   v = 0;
+   for( unsigned i=0; i < 8; i++ )
+      v |= (unsigned long long)buf[pos++] << (8*i);
+   return true;
+}
+
+static void put_block( std::vector<unsigned char> &buf, const stats_log_block &b )
+{
+   put_u64(buf,b.offset);
+   put_u32(buf,b.compressed_size);
+   put_u32(buf,b.raw_size);
+}
+
+static bool get_block( const std::vector<unsigned char> &buf, unsigned &pos, stats_log_block &b )
+{
+   return get_u64(buf,pos,b.offset) && get_u32(buf,pos,b.compressed_size) && get_u32(buf,pos,b.raw_size);
+}
+
+static double scale_factor( unsigned scale )
+{
+   double f = 1.0;
+   while( scale-- )
+      f *= 10.0;
+   return f;
+}
+
+stats_log_writer::stats_log_writer( const char *filename, int zlevel )
+{
+   m_file = fopen(filename,"wb");
+   if( !m_file ) {
+      fprintf(stderr,"GPGPU-Sim: cannot open stats log file \"%s\"\n", filename);
+      exit(1);
+   }
+   fwrite(STATS_LOG_MAGIC,1,8,m_file);
+   m_offset = 8;
+   m_zlevel = zlevel;
+   m_first_cycle = 0;
+   m_last_cycle = 0;
+   m_samples = 0;
+   m_lines = 0;
+   m_in_sample = false;
+}
+
+stats_log_writer::~stats_log_writer()
+{
+   flush();
+   fclose(m_file);
+}
+
+unsigned stats_log_writer::column( const std::string &metric, int component, int index, unsigned scale )
+{
+   std::pair<std::string,std::pair<int,int> > key(metric,std::make_pair(component,index));
+   std::map<std::pair<std::string,std::pair<int,int> >,unsigned>::iterator i = m_column_ids.find(key);
+   if( i != m_column_ids.end() )
+      return i->second;
+   stats_log_column col;
+   col.metric = metric;
+   col.component = component;
+   col.index = index;
+   col.scale = scale;
+   column_state s;
+   s.last_sample = 0;
+   s.last_value = 0;
+   s.set = false;
+   m_columns.push_back(col);
+   m_state.push_back(s);
+   m_column_ids[key] = m_columns.size()-1;
+   return m_columns.size()-1;
+}
+
+void stats_log_writer::begin_sample( unsigned long long cycle )
+{
+   if( m_in_sample )
+      end_sample();
+   if( m_samples == STATS_LOG_CHUNK_SAMPLES )
+      write_chunk();
+   put_varint( m_cycles, zigzag(cycle - (m_samples? m_last_cycle : 0)) );
+   if( m_samples == 0 )
+      m_first_cycle = cycle;
+   m_last_cycle = cycle;
+   m_line_count.clear();
+   m_lines = 0;
+   m_in_sample = true;
+}
+
+void stats_log_writer::set( unsigned column, long long value )
+{
+   assert( column < m_columns.size() );
+   long long factor = 1;
+   for( unsigned s=m_columns[column].scale; s; s-- )
+      factor *= 10;
+   if( value > LLONG_MAX/factor || value < LLONG_MIN/factor )
+      return;
+   put( column, value*factor );
+}
+
+void stats_log_writer::set( unsigned column, double value )
+{
+   assert( column < m_columns.size() );
+   double scaled = value * scale_factor(m_columns[column].scale);
+   if( !(fabs(scaled) < 9.2e18) ) 
+      return; // NaN, infinite or out of range
+   put( column, (long long)llround(scaled) );
+}
+
+void stats_log_writer::put( unsigned column, long long value )
+{
+   assert( m_in_sample && column < m_state.size() );
+   column_state &s = m_state[column];
+   if( s.set && s.last_sample == m_samples )
+      return; // first value of the sample wins
+   put_varint( s.raw, m_samples - s.last_sample );
+   put_varint( s.raw, zigzag(value - s.last_value) );
+   s.last_sample = m_samples;
+   s.last_value = value;
+   s.set = true;
+}
+
+void stats_log_writer::add_line( const char *line, unsigned length )
+{
+   const char *colon = (const char*)memchr(line,':',length);
+   if( !colon || colon == line )
+      return;
+   std::string metric(line,colon-line);
+   int n = m_line_count[metric]++;
+   unsigned count_column = column(metric,n,-1);
+   set( column(metric,n,-2), (long long)m_lines++ );
+
+   std::string values(colon+1,line+length);
+   const char *p = values.c_str();
+   int index = 0;
+   for(;;) {
+      while( *p == ' ' || *p == '\t' || *p == '\r' || *p == '\n' )
+         p++;
+      if( !*p )
+         break;
+      char *end;
+      long long v = strtoll(p,&end,10);
+      if( *end && *end != ' ' && *end != '\t' && *end != '\r' && *end != '\n' ) {
+         double d = strtod(p,&end);
+         if( end != p ) 
+            set( column(metric,n,index,6), d );
+         while( *end && *end != ' ' && *end != '\t' && *end != '\r' && *end != '\n' )
+            end++; // not a number, skip the token
+      } else {
+         set( column(metric,n,index), v ); // scaled if the position held fractions first
+      }
+      p = end;
+      index++;
+   }
+   set( count_column, (long long)index );
+}
+
+void stats_log_writer::end_sample()
+{
+   assert( m_in_sample );
+   m_samples++;
+   m_in_sample = false;
+}
+
+void stats_log_writer::write_block( const std::vector<unsigned char> &raw, stats_log_block &block )
+{
+   uLongf comp_len = compressBound(raw.size());
+   if( m_compressed.size() < comp_len )
+      m_compressed.resize(comp_len);
+   int err = compress2(&m_compressed[0],&comp_len,raw.empty()? NULL : &raw[0],raw.size(),m_zlevel);
+   assert( err == Z_OK );
+   fseeko(m_file,m_offset,SEEK_SET);
+   fwrite(&m_compressed[0],1,comp_len,m_file);
+   block.offset = m_offset;
+   block.compressed_size = comp_len;
+   block.raw_size = raw.size();
+   m_offset += comp_len;
+}
+
+void stats_log_writer::write_chunk()
+{
+   if( m_samples == 0 )
+      return;
+   stats_log_chunk chunk;
+   chunk.first_cycle = m_first_cycle;
+   chunk.last_cycle = m_last_cycle;
+   chunk.num_samples = m_samples;
+   write_block(m_cycles,chunk.cycles);
+   for( unsigned c=0; c < m_state.size(); c++ ) {
+      column_state &s = m_state[c];
+      if( !s.set )
+         continue;
+      stats_log_block block;
+      write_block(s.raw,block);
+      chunk.columns.push_back(std::make_pair(c,block));
+      s.raw.clear();
+      s.last_sample = 0;
+      s.last_value = 0;
+      s.set = false;
+   }
+   m_chunks.push_back(chunk);
+   m_cycles.clear();
+   m_samples = 0;
+}
+
+void stats_log_writer::flush()
+{
+   if( m_in_sample )
+      end_sample();
+   write_chunk();
+
+   std::vector<unsigned char> footer;
+   put_u32(footer,m_columns.size());
+   for( unsigned c=0; c < m_columns.size(); c++ ) {
+      const stats_log_column &col = m_columns[c];
+      put_u32(footer,col.metric.size());
+      footer.insert(footer.end(),col.metric.begin(),col.metric.end());
+      put_u32(footer,(unsigned)col.component);
+      put_u32(footer,(unsigned)col.index);
+      put_u32(footer,col.scale);
+   }
+   put_u32(footer,m_chunks.size());
+   for( unsigned k=0; k < m_chunks.size(); k++ ) {
+      const stats_log_chunk &chunk = m_chunks[k];
+      put_u64(footer,chunk.first_cycle);
+      put_u64(footer,chunk.last_cycle);
+      put_u32(footer,chunk.num_samples);
+      put_block(footer,chunk.cycles);
+      put_u32(footer,chunk.columns.size());
+      for( unsigned i=0; i < chunk.columns.size(); i++ ) {
+         put_u32(footer,chunk.columns[i].first);
+         put_block(footer,chunk.columns[i].second);
+      }
+   }
+   put_u64(footer,m_offset);
+   footer.insert(footer.end(),STATS_LOG_MAGIC,STATS_LOG_MAGIC+8);
+
+   // the footer is overwritten by the next chunk and written again after it
+   fseeko(m_file,m_offset,SEEK_SET);
+   fwrite(&footer[0],1,footer.size(),m_file);
+   fflush(m_file);
+}
+
+stats_log_reader::stats_log_reader( const char *filename )
+{
+   m_file = fopen(filename,"rb");
+   if( !m_file )
+      return;
+   char magic[8];
+   std::vector<unsigned char> trailer(trailer_size);
+   unsigned long long size = 0;
+   bool ok = fread(magic,1,8,m_file) == 8 && !memcmp(magic,STATS_LOG_MAGIC,8) &&
+             fseeko(m_file,0,SEEK_END) == 0;
+   if( ok ) {
+      size = ftello(m_file);
+      ok = size >= 8 + trailer_size && fseeko(m_file,size-trailer_size,SEEK_SET) == 0 &&
+           fread(&trailer[0],1,trailer_size,m_file) == trailer_size &&
+           !memcmp(&trailer[8],STATS_LOG_MAGIC,8);
+   }
+   unsigned long long footer_offset = 0;
+   unsigned pos = 0;
+   ok = ok && get_u64(trailer,pos,footer_offset) && footer_offset >= 8 && footer_offset <= size - trailer_size;
+
+   std::vector<unsigned char> footer;
+   if( ok ) {
+      footer.resize(size - trailer_size - footer_offset);
+      ok = fseeko(m_file,footer_offset,SEEK_SET) == 0 &&
+           (footer.empty() || fread(&footer[0],1,footer.size(),m_file) == footer.size());
+   }
+   pos = 0;
+   unsigned num_columns = 0, num_chunks = 0;
+   ok = ok && get_u32(footer,pos,num_columns);
+   for( unsigned c=0; ok && c < num_columns; c++ ) {
+      stats_log_column col;
+      unsigned len = 0, component = 0, index = 0;
+      ok = get_u32(footer,pos,len) && pos + len <= footer.size();
+      if( !ok )
+         break;
+      col.metric.assign((const char*)&footer[pos],len);
+      pos += len;
+      ok = get_u32(footer,pos,component) && get_u32(footer,pos,index) && get_u32(footer,pos,col.scale);
+      col.component = (int)component;
+      col.index = (int)index;
+      m_column_ids[std::make_pair(col.metric,std::make_pair(col.component,col.index))] = m_columns.size();
+      m_columns.push_back(col);
+   }
+   ok = ok && get_u32(footer,pos,num_chunks);
+   for( unsigned k=0; ok && k < num_chunks; k++ ) {
+      stats_log_chunk chunk;
+      unsigned n = 0;
+      ok = get_u64(footer,pos,chunk.first_cycle) && get_u64(footer,pos,chunk.last_cycle) &&
+           get_u32(footer,pos,chunk.num_samples) && get_block(footer,pos,chunk.cycles) &&
+           get_u32(footer,pos,n);
+      for( unsigned i=0; ok && i < n; i++ ) {
+         std::pair<unsigned,stats_log_block> col;
+         ok = get_u32(footer,pos,col.first) && get_block(footer,pos,col.second) && col.first < m_columns.size();
+         chunk.columns.push_back(col);
+      }
+      m_chunks.push_back(chunk);
+   }
+   if( !ok ) {
+      fprintf(stderr,"GPGPU-Sim: \"%s\" is not a valid stats log\n", filename);
+      fclose(m_file);
+      m_file = NULL;
+      m_columns.clear();
+      m_column_ids.clear();
+      m_chunks.clear();
+   }
+}
+
+stats_log_reader::~stats_log_reader()
+{
+   if( m_file )
+      fclose(m_file);
+}
+
+int stats_log_reader::find( const std::string &metric, int component, int index ) const
+{
+   std::map<std::pair<std::string,std::pair<int,int> >,unsigned>::const_iterator i =
+      m_column_ids.find(std::make_pair(metric,std::make_pair(component,index)));
+   return (i == m_column_ids.end())? -1 : (int)i->second;
+}
+
+unsigned long long stats_log_reader::num_samples() const
+{
+   unsigned long long n = 0;
+   for( unsigned k=0; k < m_chunks.size(); k++ )
+      n += m_chunks[k].num_samples;
+   return n;
+}
+
+double stats_log_reader::to_double( const stats_log_column &col, long long value )
+{
+   return value / scale_factor(col.scale);
+}
+
+bool stats_log_reader::read_block( const stats_log_block &block, std::vector<unsigned char> &raw )
+{
+   m_compressed.resize(block.compressed_size);
+   raw.resize(block.raw_size);
+   if( fseeko(m_file,block.offset,SEEK_SET) != 0 ||
+       fread(&m_compressed[0],1,block.compressed_size,m_file) != block.compressed_size )
+      return false;
+   uLongf len = block.raw_size;
+   if( uncompress(raw.empty()? NULL : &raw[0],&len,&m_compressed[0],block.compressed_size) != Z_OK || len != block.raw_size ) {
+      fprintf(stderr,"GPGPU-Sim: corrupted stats log block\n");
+      return false;
+   }
+   return true;
+}
+
+bool stats_log_reader::decode_cycles( const stats_log_chunk &chunk, std::vector<unsigned long long> &cycles )
+{
+   if( !read_block(chunk.cycles,m_raw) )
+      return false;
+   cycles.clear();
+   unsigned pos = 0;
+   unsigned long long cycle = 0, v;
+   for( unsigned i=0; i < chunk.num_samples; i++ ) {
+      if( !get_varint(m_raw,pos,v) )
+         return false;
+      cycle += unzigzag(v);
+      cycles.push_back(cycle);
+   }
+   return true;
+}
+
+bool stats_log_reader::decode_column( const stats_log_block &block, std::vector<std::pair<unsigned,long long> > &values )
+{
+   if( !read_block(block,m_raw) )
+      return false;
+   values.clear();
+   unsigned pos = 0;
+   unsigned sample = 0;
+   long long value = 0;
+   unsigned long long d, v;
+   while( pos < m_raw.size() ) {
+      if( !get_varint(m_raw,pos,d) || !get_varint(m_raw,pos,v) )
+         return false;
+      sample += d;
+      value += unzigzag(v);
+      values.push_back(std::make_pair(sample,value));
+   }
+   return true;
+}
+
+static bool column_less( const std::pair<unsigned,stats_log_block> &a, unsigned c )
+{
+   return a.first < c;
+}
+
+bool stats_log_reader::read( unsigned c, unsigned long long begin, unsigned long long end, std::vector<stats_log_value> &out )
+{
+   std::vector<unsigned long long> cycles;
+   std::vector<std::pair<unsigned,long long> > values;
+   out.clear();
+   for( unsigned k=0; k < m_chunks.size(); k++ ) {
+      const stats_log_chunk &chunk = m_chunks[k];
+      if( chunk.last_cycle < begin || chunk.first_cycle > end )
+         continue;
+      // column blocks are stored in column order
+      std::vector<std::pair<unsigned,stats_log_block> >::const_iterator i =
+         std::lower_bound(chunk.columns.begin(),chunk.columns.end(),c,column_less);
+      if( i == chunk.columns.end() || i->first != c )
+         continue;
+      if( !decode_cycles(chunk,cycles) || !decode_column(i->second,values) )
+         return false;
+      for( unsigned j=0; j < values.size(); j++ ) {
+         if( values[j].first >= cycles.size() )
+            return false;
+         stats_log_value v;
+         v.cycle = cycles[values[j].first];
+         v.value = values[j].second;
+         if( v.cycle >= begin && v.cycle <= end )
+            out.push_back(v);
+      }
+   }
+   return true;
+}
+
+bool stats_log_reader::read_chunk( unsigned k, std::vector<unsigned long long> &cycles,
+                                   std::vector<std::vector<std::pair<unsigned,long long> > > &values )
+{
+   const stats_log_chunk &chunk = m_chunks[k];
+   if( !decode_cycles(chunk,cycles) )
+      return false;
+   values.assign(m_columns.size(),std::vector<std::pair<unsigned,long long> >());
+   for( unsigned i=0; i < chunk.columns.size(); i++ ) {
+      if( !decode_column(chunk.columns[i].second,values[chunk.columns[i].first]) )
+         return false;
+   }
+   return true;
+}
@@ -0,0 +1,195 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Wilson W.L. Fung
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef STATS_LOG_H
+#define STATS_LOG_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <map>
+
+// Columnar binary time series log. It is written next to the text
+// visualizer log (-visualizer_columnar_file) and the power/metric traces
+// (-power_trace_columnar_file) and can be queried without decompressing
+// the rest of the log.
+//
+// Every sample has a cycle and a set of columns. A column is identified by
+// {metric, component, index} and holds signed 64-bit integers; columns with
+// a non-zero scale hold fixed point values with that many decimal digits.
+// Lines of the text visualizer log ("metric: v0 v1 ...") map to the columns
+// {metric, n, i}, where n counts earlier lines with the same metric in the
+// sample (the DRAM partition, for example). The column {metric, n, -1}
+// holds the number of values on that line and {metric, n, -2} its position
+// among the lines of the sample. The first value seen at a position sets the
+// column's scale (6 for a fraction, 0 for an integer); later integers in a
+// fractional column are scaled to it and later fractions in an integer column
+// are rounded. Tokens that are not numbers, NaN and infinities are skipped.
+//
+// File layout (all integers little endian):
+//
+//    "GPUSLOG1"
+//    chunk blocks     zlib compressed, STATS_LOG_CHUNK_SAMPLES samples per chunk
+//    footer           column table and chunk index
+//    u64 footer offset, "GPUSLOG1"
+//
+// Each chunk has one block with the sample cycles (zigzag varint deltas) and
+// one block per column that has values in the chunk. Column blocks are lists
+// of {varint sample delta, zigzag varint value delta}, so columns can be
+// sparse and every block decodes on its own. The footer is:
+//
+//    u32 number of columns
+//       u32 name length, name, i32 component, i32 index, u32 scale
+//    u32 number of chunks
+//       u64 first cycle, u64 last cycle, u32 samples, block (cycles),
+//       u32 number of column blocks
+//          u32 column, block
+//
+// where a block is {u64 offset, u32 compressed size, u32 raw size}. The
+// footer is rewritten on every flush(), so the log is readable after each
+// kernel even if the simulator does not exit cleanly.
+
+#define STATS_LOG_MAGIC "GPUSLOG1"
+#define STATS_LOG_CHUNK_SAMPLES 256
+
+struct stats_log_column {
+   std::string metric;
+   int component;
+   int index;
+   unsigned scale; // decimal digits of fixed point values
+};
+
+struct stats_log_block {
+   unsigned long long offset;
+   unsigned compressed_size;
+   unsigned raw_size;
+};
+
+struct stats_log_chunk {
+   unsigned long long first_cycle;
+   unsigned long long last_cycle;
+   unsigned num_samples;
+   stats_log_block cycles;
+   std::vector<std::pair<unsigned,stats_log_block> > columns;
+};
+
+struct stats_log_value {
+   unsigned long long cycle;
+   long long value;
+};
+
+class stats_log_writer {
+public:
+   stats_log_writer( const char *filename, int zlevel );
+   ~stats_log_writer();
+
+   // returns the column id, creating the column on first use; the scale is
+   // fixed when the column is created and ignored on later calls
+   unsigned column( const std::string &metric, int component, int index, unsigned scale=0 );
+
+   void begin_sample( unsigned long long cycle );
+   // values are converted to the column's fixed point; NaN, infinities and
+   // values that do not fit in 64 bits after scaling are dropped, leaving
+   // the column without a value in this sample
+   void set( unsigned column, long long value );
+   void set( unsigned column, double value ); // rounded to the column's scale
+   void add_line( const char *line, unsigned length ); // one "metric: v0 v1 ..." text line
+   void end_sample();
+
+   void flush(); // write out the current chunk and the footer
+
+private:
+   struct column_state {
+      std::vector<unsigned char> raw;
+      unsigned last_sample;
+      long long last_value;
+      bool set;
+   };
+
+   void put( unsigned column, long long fixed_point_value );
+   void write_chunk();
+   void write_block( const std::vector<unsigned char> &raw, stats_log_block &block );
+
+   FILE *m_file;
+   int m_zlevel;
+   unsigned long long m_offset; // where the next block (and the footer) goes
+   std::vector<stats_log_column> m_columns;
+   std::map<std::pair<std::string,std::pair<int,int> >,unsigned> m_column_ids;
+   std::vector<column_state> m_state;
+   std::vector<stats_log_chunk> m_chunks;
+
+   // current chunk
+   std::vector<unsigned char> m_cycles;
+   unsigned long long m_first_cycle;
+   unsigned long long m_last_cycle;
+   unsigned m_samples;
+   bool m_in_sample;
+   std::map<std::string,int> m_line_count; // lines per metric in the current sample
+   unsigned m_lines;                        // lines in the current sample
+   std::vector<unsigned char> m_compressed;
+};
+
+class stats_log_reader {
+public:
+   stats_log_reader( const char *filename );
+   ~stats_log_reader();
+
+   bool is_open() const { return m_file != NULL; }
+
+   unsigned num_columns() const { return m_columns.size(); }
+   const stats_log_column &get_column( unsigned c ) const { return m_columns[c]; }
+   int find( const std::string &metric, int component, int index ) const; // -1 if there is no such column
+
+   unsigned num_chunks() const { return m_chunks.size(); }
+   const stats_log_chunk &get_chunk( unsigned k ) const { return m_chunks[k]; }
+   unsigned long long num_samples() const;
+
+   // values of column c in samples with begin <= cycle <= end; only the
+   // chunks overlapping the range are read
+   bool read( unsigned c, unsigned long long begin, unsigned long long end, std::vector<stats_log_value> &out );
+
+   // all of chunk k: the sample cycles and, per column, {sample, value} pairs
+   bool read_chunk( unsigned k, std::vector<unsigned long long> &cycles,
+                    std::vector<std::vector<std::pair<unsigned,long long> > > &values );
+
+   static double to_double( const stats_log_column &col, long long value );
+
+private:
+   bool read_block( const stats_log_block &block, std::vector<unsigned char> &raw );
+   bool decode_cycles( const stats_log_chunk &chunk, std::vector<unsigned long long> &cycles );
+   bool decode_column( const stats_log_block &block, std::vector<std::pair<unsigned,long long> > &values );
+
+   FILE *m_file;
+   std::vector<stats_log_column> m_columns;
+   std::map<std::pair<std::string,std::pair<int,int> >,unsigned> m_column_ids;
+   std::vector<stats_log_chunk> m_chunks;
+   std::vector<unsigned char> m_raw;
+   std::vector<unsigned char> m_compressed;
+};
+
+#endif
@@ -0,0 +1,221 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Wilson W.L. Fung
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "stats_registry.h"
+
+#include <stdlib.h>
+#include <math.h>
+
+stats_registry::stats_registry()
+{
+   m_jsonl = NULL;
+   m_csv = NULL;
+   m_frozen = false;
+}
+
+stats_registry::~stats_registry()
+{
+   if (m_jsonl)
+      fclose(m_jsonl);
+   if (m_csv)
+      fclose(m_csv);
+}
+
+std::string stats_registry::key( const char *component, int instance, const char *name ) const
+{
+   char buf[32];
+   std::string k = component;
+   if (instance >= 0) {
+      snprintf(buf, sizeof(buf), "[%d]", instance);
+      k += buf;
+   }
+   k += '.';
+   k += name;
+   return k;
+}
+
+void stats_registry::add_stat( const char *component, int instance, const char *name, bool integer,
+                               double (*read)(const void*), const void *ptr )
+{
+   if (m_frozen) {
+      printf("GPGPU-Sim uArch: ERROR ** statistic %s registered after the first stats record\n",
+             key(component, instance, name).c_str());
+      abort();
+   }
+   source s;
+   s.read = read;
+   s.fill = NULL;
+   s.obj = ptr;
+   s.instance = 0;
+   s.first = m_keys.size();
+   m_sources.push_back(s);
+   m_keys.push_back(key(component, instance, name));
+   m_integer.push_back(integer);
+}
+
+void stats_registry::add_group( const char *component, int instance, const char *const *names, unsigned n,
+                                bool integer, stats_group_fn fill, const void *obj )
+{
+   if (m_frozen) {
+      printf("GPGPU-Sim uArch: ERROR ** statistics of %s registered after the first stats record\n",
+             key(component, instance, "*").c_str());
+      abort();
+   }
+   source s;
+   s.read = NULL;
+   s.fill = fill;
+   s.obj = obj;
+   s.instance = (instance >= 0)? instance : 0;
+   s.first = m_keys.size();
+   m_sources.push_back(s);
+   for (unsigned i = 0; i < n; i++) {
+      m_keys.push_back(key(component, instance, names[i]));
+      m_integer.push_back(integer);
+   }
+}
+
+void stats_registry::open( const char *jsonl_filename, const char *csv_filename )
+{
+   if (jsonl_filename) {
+      m_jsonl = fopen(jsonl_filename, "w");
+      if (!m_jsonl) {
+         printf("GPGPU-Sim uArch: ERROR ** could not open stats file %s\n", jsonl_filename);
+         exit(1);
+      }
+   }
+   if (csv_filename) {
+      m_csv = fopen(csv_filename, "w");
+      if (!m_csv) {
+         printf("GPGPU-Sim uArch: ERROR ** could not open stats file %s\n", csv_filename);
+         exit(1);
+      }
+   }
+}
+
+void stats_registry::snapshot()
+{
+   m_values.resize(m_keys.size());
+   for (std::vector<source>::const_iterator s = m_sources.begin(); s != m_sources.end(); s++) {
+      if (s->read)
+         m_values[s->first] = s->read(s->obj);
+      else
+         s->fill(s->obj, s->instance, &m_values[s->first]);
+   }
+}
+
+void stats_registry::print_value( FILE *fp, unsigned i, const char *non_finite ) const
+{
+   double v = m_values[i];
+   if (!isfinite(v))
+      fputs(non_finite, fp);
+   else if (m_integer[i])
+      fprintf(fp, "%.0f", v);
+   else
+      fprintf(fp, "%.9g", v);
+}
+
+// kernel names are mangled C++ identifiers, only quotes and backslashes
+// could need escaping
+static void print_json_string( FILE *fp, const std::string &s )
+{
+   fputc('"', fp);
+   for (unsigned i = 0; i < s.size(); i++) {
+      if (s[i] == '"' || s[i] == '\\')
+         fputc('\\', fp);
+      fputc(s[i], fp);
+   }
+   fputc('"', fp);
+}
+
+void stats_registry::write_jsonl( const char *record, unsigned long long cycle,
+                                  const std::vector<std::string> &kernel_names, const std::vector<unsigned> &kernel_uids )
+{
+   fprintf(m_jsonl, "{\"record\":\"%s\",\"cycle\":%llu,\"kernels\":[", record, cycle);
+   for (unsigned k = 0; k < kernel_names.size(); k++) {
+      fprintf(m_jsonl, "%s{\"name\":", k? "," : "");
+      print_json_string(m_jsonl, kernel_names[k]);
+      fprintf(m_jsonl, ",\"uid\":%u}", (k < kernel_uids.size())? kernel_uids[k] : 0);
+   }
+   fprintf(m_jsonl, "],\"stats\":{");
+   for (unsigned i = 0; i < m_keys.size(); i++) {
+      fprintf(m_jsonl, "%s\"%s\":", i? "," : "", m_keys[i].c_str());
+      print_value(m_jsonl, i, "null");
+   }
+   fprintf(m_jsonl, "}}\n");
+}
+
+void stats_registry::write_csv( const char *record, unsigned long long cycle,
+                                const std::vector<std::string> &kernel_names, const std::vector<unsigned> &kernel_uids )
+{
+   // kernels are written as "name:uid name:uid ..." in one quoted field
+   fprintf(m_csv, "%s,%llu,\"", record, cycle);
+   for (unsigned k = 0; k < kernel_names.size(); k++) {
+      if (k)
+         fputc(' ', m_csv);
+      for (unsigned i = 0; i < kernel_names[k].size(); i++) {
+         if (kernel_names[k][i] == '"')
+            fputc('"', m_csv);
+         fputc(kernel_names[k][i], m_csv);
+      }
+      fprintf(m_csv, ":%u", (k < kernel_uids.size())? kernel_uids[k] : 0);
+   }
+   fputc('"', m_csv);
+   for (unsigned i = 0; i < m_keys.size(); i++) {
+      fputc(',', m_csv);
+      print_value(m_csv, i, "");
+   }
+   fputc('\n', m_csv);
+}
+
+void stats_registry::write( const char *record, unsigned long long cycle,
+                            const std::vector<std::string> &kernel_names, const std::vector<unsigned> &kernel_uids )
+{
+   if (!is_open())
+      return;
+   if (!m_frozen) {
+      m_frozen = true;
+      if (m_csv) {
+         fprintf(m_csv, "record,cycle,kernels");
+         for (unsigned i = 0; i < m_keys.size(); i++)
+            fprintf(m_csv, ",%s", m_keys[i].c_str());
+         fputc('\n', m_csv);
+      }
+   }
+   snapshot();
+   if (m_jsonl)
+      write_jsonl(record, cycle, kernel_names, kernel_uids);
+   if (m_csv)
+      write_csv(record, cycle, kernel_names, kernel_uids);
+}
+
+void stats_registry::flush()
+{
+   if (m_jsonl)
+      fflush(m_jsonl);
+   if (m_csv)
+      fflush(m_csv);
+}
@@ -0,0 +1,116 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Wilson W.L. Fung
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STATS_REGISTRY_H
+#define STATS_REGISTRY_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <limits>
+
+// Registry of the end-of-kernel statistics for machine-readable export.
+// Components register their counters once, when the gpgpu_sim is built, and
+// every record reads them from the storage the text printers use, so the
+// structured and the text output cannot disagree. A statistic is named
+// "component.name", or "component[i].name" for one instance of a component
+// (a core cluster, a memory partition, ...).
+//
+// Two kinds of statistics can be registered:
+//  - add(): a counter read through a pointer to the component's own field
+//  - add_group(): several values computed by a callback, for statistics that
+//    are not stored in one field (cache sub stats, derived rates)
+//
+// write() emits one record with the current value of every statistic:
+//
+//    JSON Lines  {"record":"kernel","cycle":N,"kernels":[{"name":..,"uid":..}],
+//                 "stats":{"gpu.sim_cycle":N,...}}
+//    CSV         record,cycle,kernels,<one column per statistic>, where kernels
+//                is "name:uid name:uid ..."
+//
+// The CSV header is written with the first record, so all statistics must
+// be registered before then. Values that are not finite are written as null
+// (JSON) or left empty (CSV).
+
+typedef void (*stats_group_fn)( const void *obj, unsigned instance, double *values );
+
+class stats_registry {
+public:
+   stats_registry();
+   ~stats_registry();
+
+   template<class T>
+   void add( const char *component, int instance, const char *name, const T *value )
+   {
+      add_stat(component, instance, name, std::numeric_limits<T>::is_integer, &read_value<T>, value);
+   }
+   void add_group( const char *component, int instance, const char *const *names, unsigned n, bool integer,
+                   stats_group_fn fill, const void *obj );
+
+   // either file may be NULL
+   void open( const char *jsonl_filename, const char *csv_filename );
+   bool is_open() const { return m_jsonl || m_csv; }
+
+   // kernels are "name uid" pairs of the kernels the record covers
+   void write( const char *record, unsigned long long cycle,
+               const std::vector<std::string> &kernel_names, const std::vector<unsigned> &kernel_uids );
+   void flush();
+
+   unsigned num_stats() const { return m_keys.size(); }
+
+private:
+   template<class T>
+   static double read_value( const void *p ) { return (double)*(const T*)p; }
+
+   void add_stat( const char *component, int instance, const char *name, bool integer,
+                  double (*read)(const void*), const void *ptr );
+   std::string key( const char *component, int instance, const char *name ) const;
+   void snapshot();
+   void write_jsonl( const char *record, unsigned long long cycle,
+                     const std::vector<std::string> &kernel_names, const std::vector<unsigned> &kernel_uids );
+   void write_csv( const char *record, unsigned long long cycle,
+                   const std::vector<std::string> &kernel_names, const std::vector<unsigned> &kernel_uids );
+   void print_value( FILE *fp, unsigned i, const char *non_finite ) const;
+
+   struct source {
+      double (*read)(const void*);   // single counter, NULL for a group
+      stats_group_fn fill;           // group callback
+      const void *obj;
+      unsigned instance;
+      unsigned first;                // index of the first value
+   };
+   std::vector<source> m_sources;
+   std::vector<std::string> m_keys;
+   std::vector<bool> m_integer;
+   std::vector<double> m_values;
+
+   FILE *m_jsonl;
+   FILE *m_csv;
+   bool m_frozen; // a record has been written, no more statistics can be added
+};
+
+#endif
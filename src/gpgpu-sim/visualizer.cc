@@ -36,29 +36,182 @@
 //#include "../../../mcpat/processor.h"
 #include "stat-tool.h"
 #include "gpu-cache.h"
+#include "stats_log.h"
 
 #include <time.h>
 #include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
 #include <zlib.h>
 
 static void time_vector_print_interval2gzfile(gzFile outfile);
 
-void gpgpu_sim::visualizer_printstat()
+#define VISUALIZER_BUFFER_SIZE (256*1024)
+
+visualizer_writer::visualizer_writer( const char *filename, int zlevel, const char *columnar_filename )
 {
-   gzFile visualizer_file = NULL; // gzFile is basically a pointer to a struct, so it is fine to initialize it as NULL
-   if ( !m_config.g_visualizer_enabled )
-      return;
+   m_filename = filename;
+   m_zlevel = zlevel;
+   m_first = true;
+   m_in = NULL;
+   m_out = NULL;
+   m_pipe = -1;
+   m_columns = columnar_filename? new stats_log_writer(columnar_filename, zlevel) : NULL;
+   pthread_mutex_init(&m_lock,NULL);
+   m_line_start = 0;
+   m_column_sample = false;
+}
 
-   // clean the content of the visualizer log if it is the first time, otherwise attach at the end
-   static bool visualizer_first_printstat = true;
+visualizer_writer::~visualizer_writer()
+{
+   flush();
+   delete m_columns;
+   pthread_mutex_destroy(&m_lock);
+}
+
+gzFile visualizer_writer::file()
+{
+   if (m_in)
+      return m_in;
 
-   visualizer_file = gzopen(m_config.g_visualizer_filename, (visualizer_first_printstat)? "w" : "a");
-   if (visualizer_file == NULL) {
+   // clean the content of the visualizer log if it is the first time, otherwise attach at the end
+   m_out = gzopen(m_filename, m_first? "w" : "a");
+   if (m_out == NULL) {
       printf("error - could not open visualizer trace file.\n");
       exit(1);
    }
-   gzsetparams(visualizer_file, m_config.g_visualizer_zlevel, Z_DEFAULT_STRATEGY);
-   visualizer_first_printstat = false;
+   gzsetparams(m_out, m_zlevel, Z_DEFAULT_STRATEGY);
+   m_first = false;
+
+#if ZLIB_VERNUM >= 0x1252
+   // m_in is a transparent ("T", zlib 1.2.5.2+) gz stream on a pipe: gzprintf
+   // only formats into its buffer and the compress thread does the deflating
+   int fd[2];
+   if (pipe(fd) == 0) {
+      m_in = gzdopen(fd[1], "wT");
+      if (m_in == NULL) {
+         close(fd[0]);
+         close(fd[1]);
+      } else {
+         gzbuffer(m_in, VISUALIZER_BUFFER_SIZE);
+         m_pipe = fd[0];
+         if (pthread_create(&m_thread, NULL, compress_thread, this) != 0) {
+            gzclose(m_in);
+            close(m_pipe);
+            m_in = NULL;
+            m_pipe = -1;
+         }
+      }
+   }
+#endif
+   if (m_in == NULL) {
+      m_in = m_out; // no pipe or thread, compress on the simulation thread
+      if (m_columns) {
+         printf("GPGPU-Sim: cannot run the visualizer log thread, not writing the columnar log\n");
+         delete m_columns;
+         m_columns = NULL;
+      }
+   }
+   return m_in;
+}
+
+void visualizer_writer::begin_sample( unsigned long long cycle )
+{
+   if (m_columns == NULL || m_in == NULL)
+      return;
+   pthread_mutex_lock(&m_lock);
+   m_sample_starts.push_back(std::make_pair((unsigned long long)gztell(m_in), cycle));
+   pthread_mutex_unlock(&m_lock);
+}
+
+void visualizer_writer::flush()
+{
+   if (m_in == NULL)
+      return;
+   if (m_in != m_out) {
+      gzclose(m_in); // the compress thread sees end of file and exits
+      pthread_join(m_thread, NULL);
+      m_pipe = -1;
+   }
+   gzclose(m_out);
+   m_in = NULL;
+   m_out = NULL;
+   if (m_columns)
+      m_columns->flush();
+}
+
+void *visualizer_writer::compress_thread( void *arg )
+{
+   ((visualizer_writer*)arg)->compress();
+   return NULL;
+}
+
+void visualizer_writer::compress()
+{
+   char *buf = (char*)malloc(VISUALIZER_BUFFER_SIZE);
+   unsigned long long offset = 0;
+   for (;;) {
+      ssize_t n = read(m_pipe, buf, VISUALIZER_BUFFER_SIZE);
+      if (n < 0 && errno == EINTR)
+         continue;
+      if (n <= 0)
+         break;
+      gzwrite(m_out, buf, n);
+      if (m_columns) {
+         // split into lines, remembering where each one starts in the stream
+         const char *p = buf;
+         const char *e = buf + n;
+         while (p < e) {
+            const char *nl = (const char*)memchr(p, '\n', e - p);
+            const char *stop = nl? nl + 1 : e;
+            if (m_line.empty())
+               m_line_start = offset + (p - buf);
+            m_line.append(p, stop - p);
+            if (nl) {
+               add_column_line();
+               m_line.clear();
+            }
+            p = stop;
+         }
+      }
+      offset += n;
+   }
+   if (m_columns) {
+      if (!m_line.empty())
+         add_column_line();
+      m_line.clear();
+      m_line_start = offset;
+      add_column_line(); // samples that printed nothing
+      m_column_sample = false;
+   }
+   close(m_pipe);
+   free(buf);
+}
+
+void visualizer_writer::add_column_line()
+{
+   pthread_mutex_lock(&m_lock);
+   while (!m_sample_starts.empty() && m_sample_starts.front().first <= m_line_start) {
+      m_columns->begin_sample(m_sample_starts.front().second);
+      m_sample_starts.pop_front();
+      m_column_sample = true;
+   }
+   pthread_mutex_unlock(&m_lock);
+   if (m_column_sample && !m_line.empty())
+      m_columns->add_line(m_line.data(), m_line.size());
+}
+
+void gpgpu_sim::visualizer_printstat()
+{
+   if ( !m_config.g_visualizer_enabled )
+      return;
+
+   if (m_visualizer == NULL)
+      m_visualizer = new visualizer_writer(m_config.g_visualizer_filename, m_config.g_visualizer_zlevel,
+                                           m_config.g_visualizer_columnar_filename);
+   gzFile visualizer_file = m_visualizer->file();
+   m_visualizer->begin_sample(gpu_tot_sim_cycle + gpu_sim_cycle);
    
    cflog_visualizer_gzprint(visualizer_file);
    shader_CTA_count_visualizer_gzprint(visualizer_file);
@@ -75,8 +228,6 @@ void gpgpu_sim::visualizer_printstat()
    gzprintf(visualizer_file, "globaltotinsncount: %lld\n", gpu_tot_sim_insn);
 
    time_vector_print_interval2gzfile(visualizer_file);
-
-   gzclose(visualizer_file);
 /*
    gzprintf(visualizer_file, "CacheMissRate_GlobalLocalL1_All: ");
    for (unsigned i=0;i<m_n_shader;i++) 
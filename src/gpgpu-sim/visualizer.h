@@ -30,10 +30,50 @@
 
 #include <stdio.h>
 #include <zlib.h>
+#include <pthread.h>
+#include <string>
+#include <deque>
 
 void time_vector_create(int size);
 void time_vector_print(void);
 void time_vector_update(unsigned int uid,int slot ,long int cycle,int type);
 void check_time_vector_update(unsigned int uid,int slot ,long int latency,int type); 
 
+// Keeps the visualizer log open across samples. Samples are gzprintf'ed into
+// an uncompressed in-memory stream and deflated into the log by a background
+// thread, so the simulator only pays for the text formatting. flush() ends
+// the current gzip member; the next sample appends a new one, which is how
+// AerialVision has always read multi-kernel logs. With a columnar file the
+// same thread also parses the samples into a stats_log_writer.
+class visualizer_writer {
+public:
+   visualizer_writer( const char *filename, int zlevel, const char *columnar_filename );
+   ~visualizer_writer();
+
+   gzFile file(); // stream for the next sample
+   void begin_sample( unsigned long long cycle ); // everything written after this belongs to the sample
+   void flush();  // wait until everything written so far is in the log
+
+private:
+   static void *compress_thread( void *arg );
+   void compress();
+   void add_column_line();
+
+   const char *m_filename;
+   int m_zlevel;
+   bool m_first;
+   gzFile m_in;   // what the visualizer_print functions write to
+   gzFile m_out;  // the log itself, written by m_thread
+   int m_pipe;    // read end of the pipe behind m_in
+   pthread_t m_thread;
+
+   // columnar copy of the log, only touched by m_thread while it runs
+   class stats_log_writer *m_columns;
+   pthread_mutex_t m_lock;
+   std::deque<std::pair<unsigned long long,unsigned long long> > m_sample_starts; // {offset in m_in, cycle}
+   std::string m_line;
+   unsigned long long m_line_start;
+   bool m_column_sample;
+};
+
 #endif
@@ -35,7 +35,7 @@ endif
 
 SRCS  = area.cc bank.cc mat.cc main.cc Ucache.cc io.cc technology.cc basic_circuit.cc parameter.cc \
 		decoder.cc component.cc uca.cc subarray.cc wire.cc htree2.cc \
-		cacti_interface.cc router.cc nuca.cc crossbar.cc arbiter.cc 
+		cacti_interface.cc router.cc nuca.cc crossbar.cc arbiter.cc solution_cache.cc 
 
 OBJS = $(patsubst %.cc,$(OUTPUT_DIR)/%.o,$(SRCS))
 PYTHONLIB_SRCS = $(patsubst main.cc, ,$(SRCS)) $(OUTPUT_DIR)/cacti_wrap.cc
@@ -41,6 +41,7 @@
 #include "basic_circuit.h"
 #include "parameter.h"
 #include "Ucache.h"
+#include "solution_cache.h"
 #include "nuca.h"
 #include "crossbar.h"
 #include "arbiter.h"
@@ -2296,7 +2297,11 @@ uca_org_t cacti_interface(InputParameter  * const local_interface)
   init_tech_params(g_ip->F_sz_um, false);
   Wire winit; // Do not delete this line. It initializes wires.
 
-  solve(&fin_res);
+  if (!solution_cache_lookup(*g_ip, &fin_res))
+  {
+    solve(&fin_res);
+    solution_cache_store(*g_ip, fin_res);
+  }
 
 //  g_ip->display_ip();
 //  output_UCA(&fin_res);
@@ -0,0 +1,282 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Tayler Hetherington, Ahmed ElTantawy,
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "solution_cache.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <iostream>
+
+using namespace std;
+
+static const char cache_magic[8] = { 'C','A','C','T','I','S','C','1' };
+
+static int cache_fd = -1;
+static bool cache_writable = false;
+static string cache_filename;
+static map<string,string> cache_entries;
+static unsigned cache_hits = 0;
+static unsigned cache_misses = 0;
+
+template<class T> static void put( string &s, const T &v )
+{
+  s.append((const char*)&v, sizeof(T));
+}
+
+template<class T> static void get( const char *&p, T &v )
+{
+  memcpy(&v, p, sizeof(T));
+  p += sizeof(T);
+}
+
+static unsigned checksum( const string &key, const string &val )
+{
+  unsigned h = 2166136261u;
+  for (size_t i = 0; i < key.size(); i++) h = (h ^ (unsigned char)key[i]) * 16777619u;
+  for (size_t i = 0; i < val.size(); i++) h = (h ^ (unsigned char)val[i]) * 16777619u;
+  return h;
+}
+
+// Field by field rather than the raw object so that padding does not make
+// equal parameters look different.
+static string make_key( const InputParameter &ip )
+{
+  string k;
+  put(k,ip.cache_sz); put(k,ip.line_sz); put(k,ip.assoc); put(k,ip.nbanks);
+  put(k,ip.out_w); put(k,ip.specific_tag); put(k,ip.tag_w); put(k,ip.access_mode);
+  put(k,ip.obj_func_dyn_energy); put(k,ip.obj_func_dyn_power);
+  put(k,ip.obj_func_leak_power); put(k,ip.obj_func_cycle_t);
+  put(k,ip.F_sz_nm); put(k,ip.F_sz_um);
+  put(k,ip.num_rw_ports); put(k,ip.num_rd_ports); put(k,ip.num_wr_ports);
+  put(k,ip.num_se_rd_ports); put(k,ip.num_search_ports);
+  put(k,ip.is_main_mem); put(k,ip.is_cache); put(k,ip.pure_ram); put(k,ip.pure_cam);
+  put(k,ip.rpters_in_htree); put(k,ip.ver_htree_wires_over_array);
+  put(k,ip.broadcast_addr_din_over_ver_htrees); put(k,ip.temp);
+  put(k,ip.ram_cell_tech_type); put(k,ip.peri_global_tech_type);
+  put(k,ip.data_arr_ram_cell_tech_type); put(k,ip.data_arr_peri_global_tech_type);
+  put(k,ip.tag_arr_ram_cell_tech_type); put(k,ip.tag_arr_peri_global_tech_type);
+  put(k,ip.burst_len); put(k,ip.int_prefetch_w); put(k,ip.page_sz_bits);
+  put(k,ip.ic_proj_type); put(k,ip.wire_is_mat_type); put(k,ip.wire_os_mat_type);
+  put(k,ip.wt); put(k,ip.force_wiretype); put(k,ip.print_input_args);
+  put(k,ip.nuca_cache_sz);
+  put(k,ip.ndbl); put(k,ip.ndwl); put(k,ip.nspd); put(k,ip.ndsam1); put(k,ip.ndsam2);
+  put(k,ip.ndcm); put(k,ip.force_cache_config);
+  put(k,ip.cache_level); put(k,ip.cores); put(k,ip.nuca_bank_count);
+  put(k,ip.force_nuca_bank);
+  put(k,ip.delay_wt); put(k,ip.dynamic_power_wt); put(k,ip.leakage_power_wt);
+  put(k,ip.cycle_time_wt); put(k,ip.area_wt);
+  put(k,ip.delay_wt_nuca); put(k,ip.dynamic_power_wt_nuca);
+  put(k,ip.leakage_power_wt_nuca); put(k,ip.cycle_time_wt_nuca); put(k,ip.area_wt_nuca);
+  put(k,ip.delay_dev); put(k,ip.dynamic_power_dev); put(k,ip.leakage_power_dev);
+  put(k,ip.cycle_time_dev); put(k,ip.area_dev);
+  put(k,ip.delay_dev_nuca); put(k,ip.dynamic_power_dev_nuca);
+  put(k,ip.leakage_power_dev_nuca); put(k,ip.cycle_time_dev_nuca); put(k,ip.area_dev_nuca);
+  put(k,ip.ed); put(k,ip.nuca);
+  put(k,ip.fast_access); put(k,ip.block_sz); put(k,ip.tag_assoc); put(k,ip.data_assoc);
+  put(k,ip.is_seq_acc); put(k,ip.fully_assoc); put(k,ip.nsets); put(k,ip.print_detail);
+  put(k,ip.add_ecc_b_);
+  put(k,ip.throughput); put(k,ip.latency); put(k,ip.pipelinable);
+  put(k,ip.pipeline_stages); put(k,ip.per_stage_vector); put(k,ip.with_clock_grid);
+  return k;
+}
+
+// mem_array and results_mem_array hold only numbers (arr_min points into
+// solve()'s scratch data and is dead once solve() returns), so they are
+// stored as is
+static string make_value( const uca_org_t &r )
+{
+  string v;
+  put(v,r.access_time); put(v,r.cycle_time); put(v,r.area); put(v,r.area_efficiency);
+  put(v,r.power); put(v,r.leak_power_with_sleep_transistors_in_mats);
+  put(v,r.cache_ht); put(v,r.cache_len); put(v,r.file_n);
+  put(v,r.vdd_periph_global); put(v,r.valid);
+  put(v,r.tag_array); put(v,r.data_array);
+  bool has_tag = (r.tag_array2 != NULL);
+  bool has_data = (r.data_array2 != NULL);
+  put(v,has_tag); put(v,has_data);
+  if (has_tag) put(v,*r.tag_array2);
+  if (has_data) put(v,*r.data_array2);
+  return v;
+}
+
+static mem_array *get_mem_array( const char *&p )
+{
+  mem_array *m = new mem_array();
+  get(p,*m);
+  m->arr_min = NULL;
+  return m;
+}
+
+static void load_value( const string &v, uca_org_t *r )
+{
+  const char *p = v.data();
+  get(p,r->access_time); get(p,r->cycle_time); get(p,r->area); get(p,r->area_efficiency);
+  get(p,r->power); get(p,r->leak_power_with_sleep_transistors_in_mats);
+  get(p,r->cache_ht); get(p,r->cache_len); get(p,r->file_n);
+  get(p,r->vdd_periph_global); get(p,r->valid);
+  get(p,r->tag_array); get(p,r->data_array);
+  bool has_tag, has_data;
+  get(p,has_tag); get(p,has_data);
+  r->tag_array2 = has_tag ? get_mem_array(p) : NULL;
+  r->data_array2 = has_data ? get_mem_array(p) : NULL;
+}
+
+// header: magic, then the sizes of the stored structures so that a file
+// written by a different build is not misread
+static string make_header()
+{
+  string h(cache_magic, sizeof(cache_magic));
+  unsigned sizes[4] = { sizeof(InputParameter), sizeof(uca_org_t),
+                        sizeof(mem_array), sizeof(results_mem_array) };
+  h.append((const char*)sizes, sizeof(sizes));
+  return h;
+}
+
+static bool read_all( int fd, string &contents )
+{
+  char buf[65536];
+  ssize_t n;
+  while ((n = read(fd, buf, sizeof(buf))) > 0)
+    contents.append(buf, n);
+  return n == 0;
+}
+
+// Records are appended with a single write() each, so runs sharing the file
+// do not interleave them; a record cut short by a crash fails its checksum and
+// ends the usable part of the file.
+void solution_cache_open( const char *filename )
+{
+  solution_cache_close();
+  if (filename == NULL || filename[0] == '\0')
+    return;
+  cache_filename = filename;
+  const string header = make_header();
+
+  int fd = open(filename, O_RDWR | O_APPEND | O_CREAT | O_EXCL, 0644);
+  if (fd >= 0) {
+    if (write(fd, header.data(), header.size()) != (ssize_t)header.size()) {
+      cout << "CACTI solution cache: cannot write " << filename << endl;
+      close(fd);
+      return;
+    }
+    cache_fd = fd;
+    cache_writable = true;
+    return;
+  }
+  if (errno != EEXIST || (fd = open(filename, O_RDWR | O_APPEND)) < 0) {
+    cout << "CACTI solution cache: cannot open " << filename
+         << " (" << strerror(errno) << ")" << endl;
+    return;
+  }
+
+  string contents;
+  if (!read_all(fd, contents) || contents.compare(0, header.size(), header) != 0) {
+    cout << "CACTI solution cache: " << filename
+         << " was written by a different build, not using it" << endl;
+    close(fd);
+    return;
+  }
+  size_t pos = header.size();
+  bool intact = true;
+  while (pos < contents.size()) {
+    unsigned len[3];
+    if (contents.size() - pos < sizeof(len)) {
+      intact = false;
+      break;
+    }
+    memcpy(len, contents.data() + pos, sizeof(len));
+    if (contents.size() - pos - sizeof(len) < (size_t)len[0] + len[1]) {
+      intact = false;
+      break;
+    }
+    string key = contents.substr(pos + sizeof(len), len[0]);
+    string val = contents.substr(pos + sizeof(len) + len[0], len[1]);
+    if (checksum(key, val) != len[2]) {
+      intact = false;
+      break;
+    }
+    cache_entries[key] = val;
+    pos += sizeof(len) + len[0] + len[1];
+  }
+  if (!intact)
+    cout << "CACTI solution cache: " << filename << " is damaged after "
+         << cache_entries.size() << " entries, not adding to it" << endl;
+  cache_fd = fd;
+  cache_writable = intact;
+}
+
+void solution_cache_close()
+{
+  if (cache_fd < 0)
+    return;
+  cout << "CACTI solution cache: " << cache_hits << " hits, " << cache_misses
+       << " misses (" << cache_filename << ")" << endl;
+  close(cache_fd);
+  cache_fd = -1;
+  cache_writable = false;
+  cache_entries.clear();
+  cache_hits = cache_misses = 0;
+}
+
+bool solution_cache_lookup( const InputParameter &ip, uca_org_t *fin_res )
+{
+  if (cache_fd < 0)
+    return false;
+  map<string,string>::const_iterator e = cache_entries.find(make_key(ip));
+  if (e == cache_entries.end()) {
+    cache_misses++;
+    return false;
+  }
+  cache_hits++;
+  load_value(e->second, fin_res);
+  return true;
+}
+
+void solution_cache_store( const InputParameter &ip, const uca_org_t &fin_res )
+{
+  if (cache_fd < 0)
+    return;
+  string key = make_key(ip);
+  string val = make_value(fin_res);
+  cache_entries[key] = val;
+  if (!cache_writable)
+    return;
+  unsigned len[3] = { (unsigned)key.size(), (unsigned)val.size(), checksum(key, val) };
+  string record((const char*)len, sizeof(len));
+  record += key;
+  record += val;
+  if (write(cache_fd, record.data(), record.size()) != (ssize_t)record.size()) {
+    cout << "CACTI solution cache: cannot append to " << cache_filename << endl;
+    cache_writable = false;
+  }
+}
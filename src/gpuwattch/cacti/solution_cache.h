@@ -0,0 +1,54 @@
+// Copyright (c) 2009-2011, Tor M. Aamodt, Tayler Hetherington, Ahmed ElTantawy,
+// The University of British Columbia
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// Redistributions of source code must retain the above copyright notice, this
+// list of conditions and the following disclaimer.
+// Redistributions in binary form must reproduce the above copyright notice, this
+// list of conditions and the following disclaimer in the documentation and/or
+// other materials provided with the distribution.
+// Neither the name of The University of British Columbia nor the names of its
+// contributors may be used to endorse or promote products derived from this
+// software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// On-disk memo of CACTI array solutions.
+//
+// Building the McPAT model runs solve() (the full CACTI design-space search)
+// for every array of every component, and a run repeats it all even when the
+// XML is unchanged. With a cache file open, cacti_interface() first looks the
+// InputParameter up and only calls solve() on a miss; the new solution is
+// appended to the file so the next run with the same configuration skips it.
+// Entries are keyed by every InputParameter field, so a changed XML simply
+// adds entries. The file does not track the CACTI sources: delete it after
+// changing the technology tables or the solver.
+
+#ifndef __SOLUTION_CACHE_H__
+#define __SOLUTION_CACHE_H__
+
+#include "cacti_interface.h"
+
+// Open (or create) the cache file. A NULL or empty filename turns it off.
+void solution_cache_open(const char *filename);
+// Report hits/misses and stop using the cache.
+void solution_cache_close();
+
+// On a hit fill in *fin_res (with newly allocated tag_array2/data_array2)
+bool solution_cache_lookup(const InputParameter &ip, uca_org_t *fin_res);
+void solution_cache_store(const InputParameter &ip, const uca_org_t &fin_res);
+
+#endif
@@ -26,6 +26,7 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "gpgpu_sim_wrapper.h"
+#include "cacti/solution_cache.h"
 #include <sys/stat.h>
 #define SP_BASE_POWER 0
 #define SFU_BASE_POWER  0
@@ -58,7 +59,7 @@ enum pwr_cmp_t {
 };
 
 
-gpgpu_sim_wrapper::gpgpu_sim_wrapper( bool power_simulation_enabled, char* xmlfile) {
+gpgpu_sim_wrapper::gpgpu_sim_wrapper( bool power_simulation_enabled, char* xmlfile, char* model_cache) {
 	   kernel_sample_count=0;
 	   total_sample_count=0;
 
@@ -102,7 +103,10 @@ gpgpu_sim_wrapper::gpgpu_sim_wrapper( bool power_simulation_enabled, char* xmlfi
 	   if (g_power_simulation_enabled){
 	       p->parse(xml_filename);
 	   }
+	   // the CACTI searches dominate construction; reuse earlier runs' results
+	   solution_cache_open(model_cache);
 	   proc = new Processor(p);
+	   solution_cache_close();
 	   power_trace_file = NULL;
 	   metric_trace_file = NULL;
 	   steady_state_tacking_file = NULL;
@@ -454,6 +458,11 @@ void gpgpu_sim_wrapper::print_trace_files()
 
 }
 
+const char *gpgpu_sim_wrapper::get_pwr_cmp_label(unsigned i)
+{
+	return pwr_cmp_label[i];
+}
+
 void gpgpu_sim_wrapper::update_coefficients()
 {
 
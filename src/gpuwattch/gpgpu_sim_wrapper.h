@@ -52,7 +52,7 @@ struct avg_max_min_counters{
 
 class gpgpu_sim_wrapper {
 public:
-	gpgpu_sim_wrapper(bool power_simulation_enabled, char* xmlfile);
+	gpgpu_sim_wrapper(bool power_simulation_enabled, char* xmlfile, char* model_cache=NULL);
 	~gpgpu_sim_wrapper();
 
 	void init_mcpat(char* xmlfile, char* powerfile, char* power_trace_file,char* metric_trace_file,
@@ -86,6 +86,12 @@ public:
 	void set_NoC_power(double noc_tot_reads, double noc_tot_write);
 	bool sanity_check(double a, double b);
 
+	// The current sample, as print_trace_files() writes it out
+	double get_proc_power() const { return proc_power; }
+	const std::vector<double> &get_sample_cmp_pwr() const { return sample_cmp_pwr; }
+	const std::vector<double> &get_sample_perf_counters() const { return sample_perf_counters; }
+	static const char *get_pwr_cmp_label(unsigned i);
+
 private:
 
 	void print_steady_state(int position, double init_val);
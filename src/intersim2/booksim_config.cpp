@@ -47,6 +47,13 @@ BookSimConfig::BookSimConfig( )
   // Physical sub-networks
   _int_map["subnets"] = 1;
 
+  // Only step routers and channels that hold flits or credits
+  _int_map["skip_idle_modules"] = 1;
+
+  // Threads that step the routers and channels of each (sub)network; 0 steps
+  // them on the caller with the global random number generator
+  _int_map["network_threads"] = 0;
+
   //==== Topology options =======================
   AddStrField( "topology", "torus" );
   _int_map["k"] = 8; //network radix
@@ -66,17 +66,23 @@ public:
   virtual void Evaluate() {}
   virtual void WriteOutputs();
 
+  virtual bool Idle() const { return !_input && !_output && _wait_queue.empty(); }
+
+  // module to wake when data leaves the channel
+  void SetReceiver(TimedModule * receiver) { _receiver = receiver; }
+
 protected:
   int _delay;
   T * _input;
   T * _output;
   queue<pair<int, T *> > _wait_queue;
+  TimedModule * _receiver;
 
 };
 
 template<typename T>
 Channel<T>::Channel(Module * parent, string const & name)
-  : TimedModule(parent, name), _delay(1), _input(0), _output(0) {
+  : TimedModule(parent, name), _delay(1), _input(0), _output(0), _receiver(0) {
 }
 
 template<typename T>
@@ -90,6 +96,9 @@ void Channel<T>::SetLatency(int cycles) {
 template<typename T>
 void Channel<T>::Send(T * data) {
   _input = data;
+  if(data) {
+    Wake();
+  }
 }
 
 template<typename T>
@@ -120,6 +129,9 @@ void Channel<T>::WriteOutputs() {
   _output = item.second;
   assert(_output);
   _wait_queue.pop();
+  if(_receiver) {
+    _receiver->Wake();
+  }
 }
 
 #endif
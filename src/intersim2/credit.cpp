@@ -36,6 +36,9 @@
 stack<Credit *> Credit::_all;
 stack<Credit *> Credit::_free;
 
+bool Credit::_thread_safe = false;
+pthread_mutex_t Credit::_lock = PTHREAD_MUTEX_INITIALIZER;
+
 Credit::Credit()
 {
   Reset();
@@ -51,6 +54,9 @@ void Credit::Reset()
 
 Credit * Credit::New() {
   Credit * c;
+  if(_thread_safe) {
+    pthread_mutex_lock(&_lock);
+  }
   if(_free.empty()) {
     c = new Credit();
     _all.push(c);
@@ -59,11 +65,20 @@ Credit * Credit::New() {
     c->Reset();
     _free.pop();
   }
+  if(_thread_safe) {
+    pthread_mutex_unlock(&_lock);
+  }
   return c;
 }
 
 void Credit::Free() {
+  if(_thread_safe) {
+    pthread_mutex_lock(&_lock);
+  }
   _free.push(this);
+  if(_thread_safe) {
+    pthread_mutex_unlock(&_lock);
+  }
 }
 
 void Credit::FreeAll() {
@@ -30,6 +30,7 @@
 
 #include <set>
 #include <stack>
+#include <pthread.h>
 
 class Credit {
 
@@ -47,11 +48,18 @@ public:
   void Free();
   static void FreeAll();
   static int OutStanding();
+
+  // routers stepped on several threads allocate and free credits
+  // concurrently; this makes New() and Free() take a lock
+  static void SetThreadSafe(bool thread_safe) { _thread_safe = thread_safe; }
 private:
 
   static stack<Credit *> _all;
   static stack<Credit *> _free;
 
+  static bool _thread_safe;
+  static pthread_mutex_t _lock;
+
   Credit();
   ~Credit() {}
 
@@ -34,6 +34,8 @@
 
 #include <cassert>
 #include <sstream>
+#include <set>
+#include <sched.h>
 
 #include "booksim.hpp"
 #include "network.hpp"
@@ -56,10 +58,31 @@ Network::Network( const Configuration &config, const string & name ) :
   _nodes    = -1; 
   _channels = -1;
   _classes  = config.GetInt("classes");
+  _skip_idle = (config.GetInt("skip_idle_modules") > 0);
+  _threads  = config.GetInt("network_threads");
+  _random_seed = config.GetInt("seed");
+  _phase    = 0;
+  _shutdown = false;
+  _sense    = 0;
+  _barrier_count = 0;
+  _barrier_sense = 0;
+  _barrier_sleepers = 0;
+  _barrier_spin = 0;
+  pthread_mutex_init( &_barrier_lock, NULL );
+  pthread_cond_init( &_barrier_wake, NULL );
 }
 
 Network::~Network( )
 {
+  if ( !_workers.empty() ) {
+    _shutdown = true;
+    _Barrier( _sense );
+    for ( size_t t = 0; t < _workers.size(); ++t ) {
+      pthread_join( _workers[t], NULL );
+    }
+  }
+  pthread_cond_destroy( &_barrier_wake );
+  pthread_mutex_destroy( &_barrier_lock );
   for ( int r = 0; r < _size; ++r ) {
     if ( _routers[r] ) delete _routers[r];
   }
@@ -121,6 +144,10 @@ Network * Network::New(const Configuration & config, const string & name)
   if ( n && ( config.GetInt( "link_failures" ) > 0 ) ) {
     n->InsertRandomFaults( config );
   }
+  if ( n ) {
+    n->_StartThreads( );
+    n->_TrackActivity( );
+  }
   return n;
 }
 
@@ -179,30 +206,199 @@ void Network::_Alloc( )
   }
 }
 
-void Network::ReadInputs( )
+/*GPU traffic is bursty and most routers and channels are empty most of the
+ *time, so with skip_idle_modules only the modules that hold flits or credits
+ *(or were just handed some by a channel) are stepped. A module is dropped
+ *after a cycle in which it was idle; skipping it is exactly what stepping it
+ *would have done, so statistics and power counters are unchanged
+ */
+void Network::_TrackActivity( )
 {
-  for(deque<TimedModule *>::const_iterator iter = _timed_modules.begin();
-      iter != _timed_modules.end();
-      ++iter) {
-    (*iter)->ReadInputs( );
+  if ( _skip_idle ) {
+    if ( _threads > 0 ) {
+      // indices have to follow _step_order so threads can step slices of it
+      for ( size_t i = 0; i < _step_order.size(); ++i ) {
+        _activity.Add( _step_order[i] );
+      }
+      return;
+    }
+    for(deque<TimedModule *>::const_iterator iter = _timed_modules.begin();
+        iter != _timed_modules.end();
+        ++iter) {
+      _activity.Add( *iter );
+    }
   }
 }
 
-void Network::Evaluate( )
+/*with network_threads > 0 each phase is split across that many threads (the
+ *calling thread included). Within a phase routers and channels only touch
+ *their own state; they talk through channel latches that are written and
+ *read in different phases. What is shared is the random number generator, so
+ *every router gets its own stream, seeded from the seed option, the network
+ *name and the router id: results depend on the seed but not on the number of
+ *threads. They do differ from network_threads = 0, which keeps the single
+ *global generator
+ */
+void Network::_StartThreads( )
 {
+  if ( _threads <= 0 ) {
+    return;
+  }
+
+  unsigned long long hash = 14695981039346656037ULL;
+  string const & name = Name();
+  for ( size_t i = 0; i < name.size(); ++i ) {
+    hash = ( hash ^ (unsigned char)name[i] ) * 1099511628211ULL;
+  }
+  _random.resize( _size );
+  set<TimedModule *> routers;
+  for ( int r = 0; r < _size; ++r ) {
+    if ( _routers[r] ) {
+      _random[r].Seed( hash + ( (unsigned long long)_random_seed << 32 ) + r );
+      _routers[r]->SetRandomStream( &_random[r] );
+      routers.insert( _routers[r] );
+    }
+  }
+
+  // routers and the (much cheaper) channels are each split into contiguous
+  // blocks, one per thread
+  vector<TimedModule *> router_order;
+  vector<TimedModule *> other_order;
   for(deque<TimedModule *>::const_iterator iter = _timed_modules.begin();
       iter != _timed_modules.end();
       ++iter) {
-    (*iter)->Evaluate( );
+    if ( routers.count( *iter ) ) {
+      router_order.push_back( *iter );
+    } else {
+      other_order.push_back( *iter );
+    }
+  }
+  _thread_begin.push_back( 0 );
+  for ( int t = 0; t < _threads; ++t ) {
+    _step_order.insert( _step_order.end(),
+                        router_order.begin() + router_order.size() * t / _threads,
+                        router_order.begin() + router_order.size() * ( t + 1 ) / _threads );
+    _step_order.insert( _step_order.end(),
+                        other_order.begin() + other_order.size() * t / _threads,
+                        other_order.begin() + other_order.size() * ( t + 1 ) / _threads );
+    _thread_begin.push_back( _step_order.size() );
+  }
+
+  Credit::SetThreadSafe( true );
+
+  // spinning only pays off when every thread has a CPU of its own
+  cpu_set_t cpus;
+  if ( sched_getaffinity( 0, sizeof( cpus ), &cpus ) == 0 && CPU_COUNT( &cpus ) >= _threads ) {
+    _barrier_spin = 2000;
+  }
+
+  _worker_args.resize( _threads - 1 );
+  _workers.resize( _threads - 1 );
+  for ( int t = 1; t < _threads; ++t ) {
+    _worker_args[t-1] = make_pair( this, t );
+    if ( pthread_create( &_workers[t-1], NULL, _Worker, &_worker_args[t-1] ) ) {
+      Error( "Unable to start network thread" );
+    }
+  }
+}
+
+void * Network::_Worker( void * arg )
+{
+  pair<Network *, int> const * const worker = (pair<Network *, int> const *)arg;
+  Network * const net = worker->first;
+  int sense = 0;
+  while ( true ) {
+    net->_Barrier( sense );
+    if ( net->_shutdown ) {
+      break;
+    }
+    net->_StepSlice( worker->second );
+    net->_Barrier( sense );
+  }
+  return NULL;
+}
+
+/*sense-reversing barrier; the phases are a few microseconds long, so the
+ *threads spin briefly first (if they have enough CPUs). Between network
+ *cycles the workers wait here for the rest of the GPU cycle, so after the
+ *spin they sleep on a condition variable rather than compete with the
+ *simulation thread for the CPU
+ */
+void Network::_Barrier( int & sense )
+{
+  sense = !sense;
+  if ( __sync_add_and_fetch( &_barrier_count, 1 ) == _threads ) {
+    _barrier_count = 0;
+    pthread_mutex_lock( &_barrier_lock );
+    _barrier_sense = sense;
+    if ( _barrier_sleepers > 0 ) {
+      pthread_cond_broadcast( &_barrier_wake );
+    }
+    pthread_mutex_unlock( &_barrier_lock );
+  } else {
+    for ( int spin = 0; _barrier_sense != sense; ++spin ) {
+      if ( spin >= _barrier_spin ) {
+        pthread_mutex_lock( &_barrier_lock );
+        ++_barrier_sleepers;
+        while ( _barrier_sense != sense ) {
+          pthread_cond_wait( &_barrier_wake, &_barrier_lock );
+        }
+        --_barrier_sleepers;
+        pthread_mutex_unlock( &_barrier_lock );
+        break;
+      }
+    }
+    __sync_synchronize( );
+  }
+}
+
+void Network::_StepSlice( int thread )
+{
+  int const begin = _thread_begin[thread];
+  int const end = _thread_begin[thread+1];
+  if ( _skip_idle ) {
+    _activity.Step( _phase, begin, end );
+  } else {
+    for ( int i = begin; i < end; ++i ) {
+      _step_order[i]->Step( _phase );
+    }
+  }
+}
+
+void Network::_Step( void (TimedModule::*phase)() )
+{
+  if ( _threads > 0 ) {
+    _phase = phase;
+    _Barrier( _sense );
+    _StepSlice( 0 );
+    _Barrier( _sense );
+    gRandomStream = 0;
+  } else if ( _skip_idle ) {
+    _activity.Step( phase );
+  } else {
+    for(deque<TimedModule *>::const_iterator iter = _timed_modules.begin();
+        iter != _timed_modules.end();
+        ++iter) {
+      ((*iter)->*phase)( );
+    }
   }
 }
 
+void Network::ReadInputs( )
+{
+  _Step( &TimedModule::ReadInputs );
+}
+
+void Network::Evaluate( )
+{
+  _Step( &TimedModule::Evaluate );
+}
+
 void Network::WriteOutputs( )
 {
-  for(deque<TimedModule *>::const_iterator iter = _timed_modules.begin();
-      iter != _timed_modules.end();
-      ++iter) {
-    (*iter)->WriteOutputs( );
+  _Step( &TimedModule::WriteOutputs );
+  if ( _skip_idle ) {
+    _activity.Prune( );
   }
 }
 
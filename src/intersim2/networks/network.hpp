@@ -30,6 +30,7 @@
 
 #include <vector>
 #include <deque>
+#include <pthread.h>
 
 #include "module.hpp"
 #include "flit.hpp"
@@ -66,10 +67,42 @@ protected:
 
   deque<TimedModule *> _timed_modules;
 
+  // when set, only the modules on _activity are stepped (skip_idle_modules)
+  bool _skip_idle;
+  ActivityList _activity;
+
+  // parallel stepping (network_threads): _step_order lists the timed modules
+  // grouped by the thread that steps them, thread t owns the slice
+  // [_thread_begin[t],_thread_begin[t+1]); thread 0 is the caller
+  int _threads;
+  int _random_seed;
+  vector<RandomStream> _random;
+  vector<TimedModule *> _step_order;
+  vector<int> _thread_begin;
+  vector<pthread_t> _workers;
+  vector<pair<Network *, int> > _worker_args;
+  void (TimedModule::*_phase)();
+  bool _shutdown;
+  int _sense;
+  volatile int _barrier_count;
+  volatile int _barrier_sense;
+  // threads that stopped spinning in _Barrier and sleep on _barrier_wake,
+  // after _barrier_spin polls
+  int _barrier_sleepers;
+  int _barrier_spin;
+  pthread_mutex_t _barrier_lock;
+  pthread_cond_t _barrier_wake;
+
   virtual void _ComputeSize( const Configuration &config ) = 0;
   virtual void _BuildNet( const Configuration &config ) = 0;
 
   void _Alloc( );
+  void _TrackActivity( );
+  void _StartThreads( );
+  void _Step( void (TimedModule::*phase)() );
+  void _StepSlice( int thread );
+  void _Barrier( int & sense );
+  static void * _Worker( void * arg );
 
 public:
   Network( const Configuration &config, const string & name );
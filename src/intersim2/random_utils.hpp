@@ -34,28 +34,65 @@ long   ran_next( );
 void   ranf_start(long seed);
 double ranf_next( );
 
+// A small independent generator (xorshift64*) for code that has to draw
+// random numbers in a fixed order regardless of what other threads do, e.g.
+// one stream per router when routers are stepped in parallel. Values have the
+// same ranges as the global generator.
+class RandomStream {
+  unsigned long long _state;
+
+public:
+  RandomStream( ) : _state( 0x9e3779b97f4a7c15ULL ) {}
+
+  void Seed( unsigned long long seed ) {
+    // splitmix64 scrambling so that nearby seeds give unrelated streams
+    unsigned long long z = seed + 0x9e3779b97f4a7c15ULL;
+    z = ( z ^ ( z >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+    z = ( z ^ ( z >> 27 ) ) * 0x94d049bb133111ebULL;
+    z = z ^ ( z >> 31 );
+    _state = z ? z : 0x9e3779b97f4a7c15ULL;
+  }
+
+  unsigned long long Next( ) {
+    _state ^= _state >> 12;
+    _state ^= _state << 25;
+    _state ^= _state >> 27;
+    return _state * 0x2545f4914f6cdd1dULL;
+  }
+
+  // [0,2^30), like ran_next()
+  long NextInt( ) { return (long)( Next( ) >> 34 ); }
+
+  // [0,1), like ranf_next()
+  double NextFloat( ) { return ( Next( ) >> 11 ) * ( 1.0 / 9007199254740992.0 ); }
+};
+
+// Stream used by the calling thread instead of the global generator; set
+// while a module with its own stream is being stepped, 0 otherwise.
+extern __thread RandomStream * gRandomStream;
+
 inline void RandomSeed( long seed ) {
   ran_start( seed );
   ranf_start( seed );
 }
 
 inline unsigned long RandomIntLong( ) {
-  return ran_next( );
+  return gRandomStream ? gRandomStream->NextInt( ) : ran_next( );
 }
 
 // Returns a random integer in the range [0,max]
 inline int RandomInt( int max ) {
-  return ( ran_next( ) % (max+1) );
+  return ( RandomIntLong( ) % (max+1) );
 }
 
 // Returns a random floating-point value in the rage [0,1]
 inline double RandomFloat(  ) {
-  return ranf_next( );
+  return gRandomStream ? gRandomStream->NextFloat( ) : ranf_next( );
 }
 
 // Returns a random floating-point value in the rage [0,max]
 inline double RandomFloat( double max ) {
-  return ( ranf_next( ) * max );
+  return ( RandomFloat( ) * max );
 }
 
 #endif
@@ -28,6 +28,10 @@
 #define main rng_main
 #include "rng.c"
 
+#include "random_utils.hpp"
+
+__thread RandomStream * gRandomStream = 0;
+
 long ran_next( )
 {
   return ran_arr_next( );
@@ -34,6 +34,7 @@
 #include <cstdlib>
 #include <cassert>
 #include <limits>
+#include <cmath>
 
 #include "globals.hpp"
 #include "random_utils.hpp"
@@ -288,6 +289,29 @@ void IQRouter::WriteOutputs( )
   _SendCredits( );
 }
 
+bool IQRouter::Idle( ) const
+{
+  // _InternalStep does nothing while the router is inactive, but with a
+  // fractional internal speedup skipping Evaluate would shift its phase
+  if(_active || (_internal_speedup != floor(_internal_speedup))) {
+    return false;
+  }
+  if(!_in_queue_flits.empty() || !_proc_credits.empty()) {
+    return false;
+  }
+  for(int output = 0; output < _outputs; ++output) {
+    if(!_output_buffer[output].empty()) {
+      return false;
+    }
+  }
+  for(int input = 0; input < _inputs; ++input) {
+    if(!_credit_buffer[input].empty()) {
+      return false;
+    }
+  }
+  return true;
+}
+
 
 //------------------------------------------------------------------------------
 // read inputs
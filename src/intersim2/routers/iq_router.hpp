@@ -160,6 +160,8 @@ public:
 
   virtual void ReadInputs( );
   virtual void WriteOutputs( );
+
+  virtual bool Idle( ) const;
   
   void Display( ostream & os = cout ) const;
 
@@ -29,16 +29,129 @@
 #define _TIMED_MODULE_HPP_
 
 #include "module.hpp"
+#include "random_utils.hpp"
+
+#include <vector>
+
+class ActivityList;
 
 class TimedModule : public Module {
 
+  friend class ActivityList;
+
+  ActivityList * _activity_list;
+  int _activity_index;
+  bool _woken; // woken since the list was last pruned
+
+  RandomStream * _random; // 0: draws from the global generator
+
 public:
-  TimedModule(Module * parent, string const & name) : Module(parent, name) {}
+  TimedModule(Module * parent, string const & name) : Module(parent, name),
+    _activity_list(0), _activity_index(-1), _woken(false), _random(0) {}
   virtual ~TimedModule() {}
   
   virtual void ReadInputs() = 0;
   virtual void Evaluate() = 0;
   virtual void WriteOutputs() = 0;
+
+  // True if stepping the module does nothing until new input arrives, i.e.
+  // until a channel feeding it calls Wake(). Modules that cannot tell are
+  // always stepped.
+  virtual bool Idle() const { return false; }
+
+  inline void Wake();
+
+  // Give the module its own random number stream, used for everything it
+  // draws while being stepped by Step() below or by ActivityList.
+  void SetRandomStream(RandomStream * random) { _random = random; }
+
+  void Step(void (TimedModule::*phase)()) {
+    gRandomStream = _random;
+    (this->*phase)();
+  }
 };
 
+// The modules of a network that need to be stepped. Every module starts
+// active; it is dropped at the end of a cycle in which it was idle and not
+// woken, and comes back as soon as it is woken. Active modules are stepped in
+// the order they were added: routing and allocation draw from the global
+// random number generator, so the order has to match full stepping.
+// Wake() may be called from several threads during a phase; Prune() may not.
+class ActivityList {
+  std::vector<TimedModule *> _modules;
+  std::vector<unsigned long long> _active; // one bit per module
+
+public:
+  void Add(TimedModule * m) {
+    m->_activity_list = this;
+    m->_activity_index = _modules.size();
+    _modules.push_back(m);
+    if(_modules.size() > 64 * _active.size()) {
+      _active.push_back(0);
+    }
+    Wake(m);
+  }
+
+  int Size() const { return _modules.size(); }
+
+  void Wake(TimedModule * m) {
+    m->_woken = true;
+    unsigned long long & word = _active[m->_activity_index / 64];
+    unsigned long long const bit = 1ULL << (m->_activity_index % 64);
+    if(!(word & bit)) {
+      __sync_fetch_and_or(&word, bit);
+    }
+  }
+
+  // A module woken during a phase may or may not be stepped in that phase;
+  // either is fine since stepping an idle module changes nothing.
+  void Step(void (TimedModule::*phase)()) {
+    Step(phase, 0, _modules.size());
+  }
+
+  // step the active modules with index in [begin,end)
+  void Step(void (TimedModule::*phase)(), int begin, int end) {
+    if(begin >= end) {
+      return;
+    }
+    int const last = (end - 1) / 64;
+    for(int w = begin / 64; w <= last; ++w) {
+      unsigned long long bits = _active[w];
+      if(w == begin / 64) {
+        bits &= ~0ULL << (begin % 64);
+      }
+      if(w == last && (end % 64)) {
+        bits &= ~(~0ULL << (end % 64));
+      }
+      while(bits) {
+        int const b = __builtin_ctzll(bits);
+        bits &= bits - 1;
+        _modules[64 * w + b]->Step(phase);
+      }
+    }
+  }
+
+  void Prune() {
+    for(size_t w = 0; w < _active.size(); ++w) {
+      unsigned long long bits = _active[w];
+      while(bits) {
+        int const b = __builtin_ctzll(bits);
+        bits &= bits - 1;
+        TimedModule * const m = _modules[64 * w + b];
+        if(m->_woken) {
+          m->_woken = false;
+        } else if(m->Idle()) {
+          _active[w] &= ~(1ULL << b);
+        }
+      }
+    }
+  }
+};
+
+inline void TimedModule::Wake() {
+  if(_activity_list) {
+    _activity_list->Wake(this);
+  }
+}
+
 #endif
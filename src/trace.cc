@@ -27,6 +27,10 @@
 
 #include "trace.h"
 #include "string.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
 
 namespace Trace {
 
@@ -39,11 +43,26 @@ namespace Trace {
 #undef TS_TUP
 #undef TS_TUP_END
 
+#define TE_TUP_BEGIN(X) const event_info trace_events_info[] = {
+#define TE_TUP(E,S,C,A0,A1) { #E, S, #C, { #A0, #A1 } },
+#define TE_TUP_END(X) };
+#include "trace_events.tup"
+#undef TE_TUP_BEGIN
+#undef TE_TUP
+#undef TE_TUP_END
+
     bool enabled = false;
     int sampling_core = 0;
     int sampling_memory_partition = -1;
     bool trace_streams_enabled[NUM_TRACE_STREAMS] = {false};
     const char* config_str;
+    const char* event_file = NULL;
+    int event_buffer_size = 65536;
+    const char* event_sampling_str;
+    bool events_on = false;
+    bool trace_events_enabled[NUM_TRACE_EVENTS] = {false};
+
+    static void events_init();
 
     void init()
     {
@@ -52,5 +71,187 @@ namespace Trace {
                 trace_streams_enabled[ i ] = true;
             }
         }
+        if ( event_file != NULL && event_file[0] != '\0' ) {
+            events_init();
+        }
+    }
+
+    // Single-producer/single-consumer ring. head is only written by the
+    // owning simulator thread, tail only by the consumer (the drain thread or
+    // events_flush(), serialized by s_drain_lock).
+    struct event_ring {
+        event_record *buf;
+        unsigned long long mask;
+        volatile unsigned long long head;
+        volatile unsigned long long tail;
+        unsigned long long dropped;
+        event_ring *next;
+    };
+
+    static FILE *s_file = NULL;
+    static event_ring *s_rings = NULL;
+    static pthread_mutex_t s_drain_lock = PTHREAD_MUTEX_INITIALIZER;
+    static pthread_t s_drain_thread;
+    static volatile bool s_stop = false;
+    static unsigned long long s_sampling_on = 0;
+    static unsigned long long s_sampling_period = 0;
+    static __thread event_ring *s_ring = NULL;
+
+    static event_ring *register_ring()
+    {
+        unsigned long long size = 1;
+        while ( size < (unsigned long long)event_buffer_size )
+            size <<= 1;
+        event_ring *ring = new event_ring;
+        ring->buf = new event_record[size];
+        ring->mask = size - 1;
+        ring->head = 0;
+        ring->tail = 0;
+        ring->dropped = 0;
+        pthread_mutex_lock( &s_drain_lock );
+        ring->next = s_rings;
+        s_rings = ring;
+        pthread_mutex_unlock( &s_drain_lock );
+        s_ring = ring;
+        return ring;
+    }
+
+    void record_event( trace_events_type e, unsigned component,
+                       unsigned long long arg0, unsigned long long arg1 )
+    {
+        event_ring *ring = s_ring ? s_ring : register_ring();
+        unsigned long long head = ring->head;
+        if ( head - ring->tail > ring->mask ) {
+            ring->dropped++;
+            return;
+        }
+        event_record &r = ring->buf[ head & ring->mask ];
+        r.cycle = gpu_sim_cycle + gpu_tot_sim_cycle;
+        r.stream = trace_events_info[e].stream;
+        r.event = e;
+        r.component = component;
+        r.arg[0] = arg0;
+        r.arg[1] = arg1;
+        __sync_synchronize(); // publish the record before the new head
+        ring->head = head + 1;
+    }
+
+    // caller holds s_drain_lock; returns the number of records written
+    static unsigned long long drain_rings()
+    {
+        unsigned long long n = 0;
+        for ( event_ring *ring = s_rings; ring != NULL; ring = ring->next ) {
+            unsigned long long head = ring->head;
+            unsigned long long tail = ring->tail;
+            __sync_synchronize();
+            while ( tail != head ) {
+                unsigned long long begin = tail & ring->mask;
+                unsigned long long count = head - tail;
+                if ( begin + count > ring->mask + 1 )
+                    count = ring->mask + 1 - begin;
+                fwrite( ring->buf + begin, sizeof(event_record), count, s_file );
+                tail += count;
+                n += count;
+            }
+            __sync_synchronize(); // records are copied out before the slots are reused
+            ring->tail = tail;
+        }
+        return n;
+    }
+
+    static void *drain_thread( void * )
+    {
+        for (;;) {
+            bool stop = s_stop;
+            pthread_mutex_lock( &s_drain_lock );
+            unsigned long long n = drain_rings();
+            pthread_mutex_unlock( &s_drain_lock );
+            if ( stop )
+                break;
+            if ( n == 0 )
+                usleep( 1000 );
+        }
+        return NULL;
+    }
+
+    static void write_string( const char *str )
+    {
+        unsigned len = strlen( str );
+        fwrite( &len, sizeof(len), 1, s_file );
+        fwrite( str, 1, len, s_file );
+    }
+
+    static void events_close()
+    {
+        s_stop = true;
+        pthread_join( s_drain_thread, NULL );
+        unsigned long long dropped = 0;
+        for ( event_ring *ring = s_rings; ring != NULL; ring = ring->next )
+            dropped += ring->dropped;
+        if ( dropped )
+            printf( "GPGPU-Sim: %llu trace events dropped (ring buffer full, see -trace_event_buffer)\n", dropped );
+        fclose( s_file );
+        s_file = NULL;
+        events_on = false;
+    }
+
+    // File layout: "GPUEVTR1", u32 record size, u32 stream count and the
+    // stream names, u32 event count and for each event its name, u32 stream,
+    // component kind and two argument names, followed by raw event_records.
+    // Strings are a u32 length followed by the characters.
+    static void events_init()
+    {
+        if ( sscanf( event_sampling_str, "%llu:%llu", &s_sampling_on, &s_sampling_period ) != 2
+             || (s_sampling_period != 0 && s_sampling_on > s_sampling_period) ) {
+            printf( "GPGPU-Sim: invalid -trace_event_sampling \"%s\" (expected <on cycles>:<period>)\n", event_sampling_str );
+            abort();
+        }
+        s_file = fopen( event_file, "wb" );
+        if ( s_file == NULL ) {
+            printf( "GPGPU-Sim: cannot open event trace file %s\n", event_file );
+            abort();
+        }
+        fwrite( "GPUEVTR1", 1, 8, s_file );
+        unsigned n = sizeof(event_record);
+        fwrite( &n, sizeof(n), 1, s_file );
+        n = NUM_TRACE_STREAMS;
+        fwrite( &n, sizeof(n), 1, s_file );
+        for ( unsigned i = 0; i < NUM_TRACE_STREAMS; ++i )
+            write_string( trace_streams_str[i] );
+        n = NUM_TRACE_EVENTS;
+        fwrite( &n, sizeof(n), 1, s_file );
+        for ( unsigned i = 0; i < NUM_TRACE_EVENTS; ++i ) {
+            const event_info &info = trace_events_info[i];
+            write_string( info.name );
+            n = info.stream;
+            fwrite( &n, sizeof(n), 1, s_file );
+            write_string( info.component );
+            write_string( info.arg[0] );
+            write_string( info.arg[1] );
+            trace_events_enabled[i] = trace_streams_enabled[ info.stream ];
+        }
+        events_on = (s_sampling_period == 0);
+        if ( pthread_create( &s_drain_thread, NULL, drain_thread, NULL ) != 0 ) {
+            printf( "GPGPU-Sim: cannot start the event trace drain thread\n" );
+            abort();
+        }
+        atexit( events_close );
+    }
+
+    void events_cycle( unsigned long long cycle )
+    {
+        if ( s_file != NULL && s_sampling_period != 0 ) {
+            events_on = (cycle % s_sampling_period) < s_sampling_on;
+        }
+    }
+
+    void events_flush()
+    {
+        if ( s_file == NULL )
+            return;
+        pthread_mutex_lock( &s_drain_lock );
+        drain_rings();
+        fflush( s_file );
+        pthread_mutex_unlock( &s_drain_lock );
     }
 } 
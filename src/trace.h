@@ -44,6 +44,14 @@ namespace Trace {
 #undef TS_TUP
 #undef TS_TUP_END
 
+#define TE_TUP_BEGIN(X) enum X {
+#define TE_TUP(E,S,C,A0,A1) E,
+#define TE_TUP_END(X) NUM_TRACE_EVENTS };
+#include "trace_events.tup"
+#undef TE_TUP_BEGIN
+#undef TE_TUP
+#undef TE_TUP_END
+
     extern bool enabled;
     extern int sampling_core;
     extern int sampling_memory_partition;
@@ -53,8 +61,45 @@ namespace Trace {
 
     void init();
 
+    // Binary event trace. Each simulator thread appends fixed-size records to
+    // its own single-producer ring buffer; a drain thread empties the rings
+    // into -trace_event_file. Records that do not fit in a full ring are
+    // dropped and counted. src/bench/trace_to_chrome.cc converts the file to
+    // Chrome/Perfetto trace JSON.
+    struct event_record {
+        unsigned long long cycle;
+        unsigned short stream;
+        unsigned short event;
+        unsigned component;
+        unsigned long long arg[2];
+    };
+
+    struct event_info {
+        const char *name;
+        trace_streams_type stream;
+        const char *component;
+        const char *arg[2];
+    };
+
+    extern const event_info trace_events_info[];
+    extern const char* event_file;
+    extern int event_buffer_size;
+    extern const char* event_sampling_str;
+    extern bool events_on; // inside a sampled window
+    extern bool trace_events_enabled[NUM_TRACE_EVENTS];
+
+    void events_cycle( unsigned long long cycle );
+    void record_event( trace_events_type e, unsigned component,
+                       unsigned long long arg0, unsigned long long arg1 );
+    void events_flush();
+
 } // namespace Trace
 
+#define TRACE_EVENT(e, component, arg0, arg1) do {\
+    if (Trace::events_on && Trace::trace_events_enabled[Trace::e])\
+        Trace::record_event( Trace::e, component, arg0, arg1 );\
+} while (0)
+
 
 #if TRACING_ON
 